@@ -9,6 +9,7 @@
 namespace zb {
     class Zb {
     public:
-        static bool Run(NSString *script);
+        // Queued for the script thread; errors go to the log.
+        static void Run(NSString *script);
     };
 }
@@ -0,0 +1,373 @@
+//
+//  bench.cc
+//  zb
+//
+//  Created by  on 12/02/24.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Runs the bridge crossing cases from crossings.js against the in-memory
+//  backend and reports per-crossing time, heap allocation and GC pauses
+//  (plus disposed and pooled wrappers and the time spent finalizing them
+//  for cases that collect), the cost of a further context built from the
+//  runtime's cached templates, and the event loop's cost per timer fired
+//  and per input event in frame-sized batches:
+//
+//    zb_bench [--iterations=N] [--filter=name] benchmarks/crossings.js
+//
+//  Given the V8 harness in front and benchmarks/run.js after, it runs the
+//  same cases as BenchmarkSuites instead and prints their scores:
+//
+//    zb_bench ../../libs/v8/benchmarks/base.js benchmarks/crossings.js benchmarks/run.js
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+#include "memory_backend.h"
+#include "event.h"
+#include "runtime.h"
+
+using namespace v8;
+
+struct GCStats {
+    int count;
+    double total_ns;
+    double max_ns;
+    double started_ns;
+    size_t used_before;
+    size_t collected;
+};
+
+static GCStats gc_stats;
+
+static double Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t UsedHeapSize()
+{
+    v8::HeapStatistics heap;
+    v8::V8::GetHeapStatistics(&heap);
+    return heap.used_heap_size();
+}
+
+static void GCPrologue(v8::GCType type, v8::GCCallbackFlags flags)
+{
+    gc_stats.used_before = UsedHeapSize();
+    gc_stats.started_ns = Now();
+}
+
+static void GCEpilogue(v8::GCType type, v8::GCCallbackFlags flags)
+{
+    double pause = Now() - gc_stats.started_ns;
+    size_t used_after = UsedHeapSize();
+    gc_stats.count++;
+    gc_stats.total_ns += pause;
+    if (pause > gc_stats.max_ns) {
+        gc_stats.max_ns = pause;
+    }
+    if (gc_stats.used_before > used_after) {
+        gc_stats.collected += gc_stats.used_before - used_after;
+    }
+}
+
+static bool ReadFile(const char *name, std::string *out)
+{
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out->append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+// print(...) for the harness scripts: straight to stdout, unlike Print,
+// which goes through the log channel and its rate limiter.
+static v8::Handle<v8::Value> PrintLine(const v8::Arguments &args)
+{
+    for (int i = 0; i < args.Length(); i++) {
+        v8::String::Utf8Value line(args[i]);
+        printf("%s%s", i > 0 ? " " : "", *line ? *line : "");
+    }
+    printf("\n");
+    fflush(stdout);
+    return v8::Undefined();
+}
+
+static void ReportException(v8::TryCatch *try_catch)
+{
+    v8::String::Utf8Value exception(try_catch->Exception());
+    fprintf(stderr, "%s\n", *exception ? *exception : "<string conversion failed>");
+}
+
+static bool RunCase(v8::Handle<v8::Object> test, int iterations, zb::Runtime *runtime, zb::MemoryBackend *backend)
+{
+    v8::HandleScope handle_scope;
+    v8::TryCatch try_catch;
+    v8::String::Utf8Value name(test->Get(v8::String::New("name")));
+    v8::Local<v8::Function> run = v8::Local<v8::Function>::Cast(test->Get(v8::String::New("run")));
+    v8::Local<v8::Value> setup = test->Get(v8::String::New("setup"));
+    bool collect = test->Get(v8::String::New("collect"))->BooleanValue();
+    
+    v8::Handle<v8::Value> args[2];
+    args[1] = v8::Undefined();
+    if (setup->IsFunction()) {
+        args[1] = v8::Local<v8::Function>::Cast(setup)->Call(test, 0, NULL);
+        if (args[1].IsEmpty()) {
+            ReportException(&try_catch);
+            return false;
+        }
+    }
+    
+    args[0] = v8::Integer::New(iterations / 100 + 1);
+    if (run->Call(test, 2, args).IsEmpty()) {
+        ReportException(&try_catch);
+        return false;
+    }
+    v8::V8::LowMemoryNotification();
+    
+    memset(&gc_stats, 0, sizeof(gc_stats));
+    int destroyed = backend->stats().destroyed;
+    int64_t pooled = runtime->view_pool()->stats().hits;
+    double finalize_ms = runtime->finalizer()->stats().total_ms;
+    size_t used = UsedHeapSize();
+    args[0] = v8::Integer::New(iterations);
+    double start = Now();
+    if (run->Call(test, 2, args).IsEmpty()) {
+        ReportException(&try_catch);
+        return false;
+    }
+    if (collect) {
+        v8::V8::LowMemoryNotification();
+        runtime->Idle();
+    }
+    double elapsed = Now() - start;
+    double allocated = static_cast<double>(UsedHeapSize()) - used + gc_stats.collected;
+    
+    printf("%-16s %9.1f ns/op %9.1f bytes/op %5d gcs %9.3f ms gc %8.3f ms max",
+           *name, elapsed / iterations, allocated / iterations,
+           gc_stats.count, gc_stats.total_ns / 1e6, gc_stats.max_ns / 1e6);
+    if (collect) {
+        printf(" %8d disposed %8lld pooled %9.3f ms finalize", backend->stats().destroyed - destroyed,
+               static_cast<long long>(runtime->view_pool()->stats().hits - pooled),
+               runtime->finalizer()->stats().total_ms - finalize_ms);
+    }
+    printf("\n");
+    return true;
+}
+
+static void RunNewContext(zb::Runtime *runtime, int count)
+{
+    double start = Now();
+    for (int i = 0; i < count; i++) {
+        v8::Persistent<v8::Context> context = runtime->NewContext();
+        context.Dispose();
+    }
+    double elapsed = Now() - start;
+    printf("%-16s %9.1f us/op\n", "NewContext", elapsed / count / 1e3);
+}
+
+// Timeouts spread over a second, run a millisecond at a time; then frames
+// of two pointers moving at 60 events each, which onEvents gets as two.
+static bool RunEventLoop(zb::Runtime *runtime, int count)
+{
+    char source[256];
+    snprintf(source, sizeof(source),
+             "var fired = 0, events = 0;"
+             "function tick() { fired++; }"
+             "onEvents = function (batch) { events += batch.length; };"
+             "for (var i = 0; i < %d; i++) setTimeout(tick, i %% 1000);", count);
+    if (!runtime->Run(source)) {
+        return false;
+    }
+    double base = zb::Runtime::Now();
+    double start = Now();
+    int fired = 0;
+    for (int ms = 0; ms <= 1001; ms++) {
+        fired += runtime->RunTimers(base + ms / 1000.0);
+    }
+    double elapsed = Now() - start;
+    printf("%-16s %9.1f ns/op %8d fired\n", "Timers", elapsed / (fired > 0 ? fired : 1), fired);
+    
+    const int kBatch = 120;
+    zb::Event batch[kBatch];
+    for (int i = 0; i < kBatch; i++) {
+        batch[i].type = zb::Event::kTouchMoved;
+        batch[i].pointer = i % 2;
+        batch[i].x = static_cast<float>(i);
+        batch[i].y = static_cast<float>(i);
+        batch[i].timestamp = i;
+        batch[i].animation = 0;
+    }
+    int frames = count / kBatch + 1;
+    start = Now();
+    for (int i = 0; i < frames; i++) {
+        runtime->DispatchEvents(batch, kBatch);
+    }
+    elapsed = Now() - start;
+    printf("%-16s %9.1f ns/op %8d events\n", "Input", elapsed / (frames * kBatch), frames * kBatch);
+    return true;
+}
+
+// Fifty records of six fields plus a 1000-sample series, about what a
+// feed screen hands over at once.
+static void BuildPayload(zb::Variant *payload, std::string *json)
+{
+    *payload = zb::Variant::Object();
+    zb::Variant *items = payload->Set("items");
+    *items = zb::Variant::Array();
+    json->assign("{\"items\":[");
+    for (int i = 0; i < 50; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "item %d", i);
+        zb::Variant *item = items->Append();
+        *item = zb::Variant::Object();
+        *item->Set("id") = zb::Variant(static_cast<double>(i));
+        *item->Set("kind") = zb::Variant("photo");
+        *item->Set("name") = zb::Variant(name);
+        *item->Set("score") = zb::Variant(i + 0.5);
+        *item->Set("visible") = zb::Variant(i % 2 == 0);
+        zb::Variant *tags = item->Set("tags");
+        *tags = zb::Variant::Array();
+        *tags->Append() = zb::Variant("new");
+        *tags->Append() = zb::Variant("shared");
+        char record[160];
+        snprintf(record, sizeof(record), "%s{\"id\":%d,\"kind\":\"photo\",\"name\":\"%s\",\"score\":%g,\"tags\":[\"new\",\"shared\"],\"visible\":%s}",
+                 i > 0 ? "," : "", i, name, i + 0.5, i % 2 == 0 ? "true" : "false");
+        json->append(record);
+    }
+    json->append("],\"series\":[");
+    zb::Variant *series = payload->Set("series");
+    *series = zb::Variant::Numbers();
+    for (int i = 0; i < 1000; i++) {
+        char sample[32];
+        snprintf(sample, sizeof(sample), "%s%g", i > 0 ? "," : "", i * 0.25);
+        json->append(sample);
+        series->mutable_numbers()->push_back(i * 0.25);
+    }
+    json->append("]}");
+}
+
+static void RunMarshal(zb::Runtime *runtime, int count)
+{
+    zb::Variant payload;
+    std::string json;
+    BuildPayload(&payload, &json);
+    zb::Marshaller *marshaller = runtime->marshaller();
+    
+    double start = Now();
+    for (int i = 0; i < count; i++) {
+        v8::HandleScope handle_scope;
+        marshaller->ToV8(&payload);
+    }
+    double elapsed = Now() - start;
+    printf("%-16s %9.1f us/op\n", "Marshal", elapsed / count / 1e3);
+    
+    v8::Local<v8::Object> JSON = runtime->context()->Global()->Get(v8::String::New("JSON"))->ToObject();
+    v8::Local<v8::Function> parse = v8::Local<v8::Function>::Cast(JSON->Get(v8::String::New("parse")));
+    v8::Local<v8::String> text = v8::String::New(json.data(), static_cast<int>(json.size()));
+    start = Now();
+    for (int i = 0; i < count; i++) {
+        v8::HandleScope handle_scope;
+        v8::Handle<v8::Value> argv[] = { text };
+        parse->Call(JSON, 1, argv);
+    }
+    elapsed = Now() - start;
+    printf("%-16s %9.1f us/op\n", "JSON.parse", elapsed / count / 1e3);
+    
+    v8::Handle<v8::Value> value = marshaller->ToV8(&payload);
+    start = Now();
+    for (int i = 0; i < count; i++) {
+        zb::Variant out;
+        marshaller->FromV8(value, &out);
+    }
+    elapsed = Now() - start;
+    printf("%-16s %9.1f us/op\n", "Unmarshal", elapsed / count / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    v8::V8::SetFlagsFromCommandLine(&argc, argv, true);
+    int iterations = 1000000;
+    const char *filter = NULL;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        fprintf(stderr, "usage: %s [--iterations=N] [--filter=name] crossings.js\n"
+                "       %s base.js crossings.js run.js\n", argv[0], argv[0]);
+        return 1;
+    }
+    
+    zb::MemoryBackend backend;
+    zb::Runtime runtime(&backend);
+    v8::Locker locker(runtime.isolate());
+    v8::Isolate::Scope isolate_scope(runtime.isolate());
+    v8::HandleScope handle_scope;
+    v8::Context::Scope context_scope(runtime.context());
+    runtime.context()->Global()->Set(v8::String::New("print"), v8::FunctionTemplate::New(PrintLine)->GetFunction());
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string source;
+        if (!ReadFile(files[i], &source)) {
+            fprintf(stderr, "cannot read %s\n", files[i]);
+            return 1;
+        }
+        if (!runtime.Run(source.c_str())) {
+            return 1;
+        }
+    }
+    // run.js has reported through the harness; it leaves success false
+    // when a suite threw.
+    v8::Local<v8::Object> global = runtime.context()->Global();
+    if (!global->Get(v8::String::New("BenchmarkSuite"))->IsUndefined()) {
+        return global->Get(v8::String::New("success"))->IsFalse() ? 1 : 0;
+    }
+    
+    v8::V8::AddGCPrologueCallback(GCPrologue);
+    v8::V8::AddGCEpilogueCallback(GCEpilogue);
+    
+    v8::Local<v8::Value> cases = global->Get(v8::String::New("BridgeCrossings"));
+    if (!cases->IsArray()) {
+        fprintf(stderr, "%s does not define BridgeCrossings\n", files.back());
+        return 1;
+    }
+    v8::Local<v8::Array> tests = v8::Local<v8::Array>::Cast(cases);
+    bool ok = true;
+    for (uint32_t i = 0; i < tests->Length() && ok; i++) {
+        v8::Local<v8::Object> test = tests->Get(i)->ToObject();
+        if (filter != NULL && strstr(*v8::String::Utf8Value(test->Get(v8::String::New("name"))), filter) == NULL) {
+            continue;
+        }
+        ok = RunCase(test, iterations, &runtime, &backend);
+    }
+    if (ok && (filter == NULL || strstr("NewContext", filter) != NULL)) {
+        RunNewContext(&runtime, iterations / 10000 + 1);
+    }
+    if (ok && (filter == NULL || strstr("Timers Input", filter) != NULL)) {
+        ok = RunEventLoop(&runtime, iterations / 100 + 1);
+    }
+    if (ok && (filter == NULL || strstr("Marshal JSON.parse Unmarshal", filter) != NULL)) {
+        RunMarshal(&runtime, iterations / 1000 + 1);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Bridge crossing microbenchmarks, driven by zb_bench.
+//
+// Each case runs `n` crossings of one kind so the runner can divide its
+// measurements by `n`. Keep the loop bodies free of other allocations:
+// bytes/op is reported against the whole loop.
+//
+// Loaded after libs/v8/benchmarks/base.js, the cases also register as one
+// BenchmarkSuite each, for benchmarks/run.js.
+
+var BridgeCrossings = [
+  {
+    name: 'Invoke.Plus',
+    run: function(n) {
+      var sum = 0;
+      for (var i = 0; i < n; i++) {
+        sum = Plus(sum, 1);
+      }
+      return sum;
+    }
+  },
+  {
+    name: 'View.x get',
+    setup: function() { return new View(); },
+    run: function(n, view) {
+      var x = 0;
+      for (var i = 0; i < n; i++) {
+        x += view.x;
+      }
+      return x;
+    }
+  },
+  {
+    name: 'View.x set',
+    setup: function() { return new View(); },
+    run: function(n, view) {
+      for (var i = 0; i < n; i++) {
+        view.x = i & 1023;
+      }
+    }
+  },
+  {
+    // Fractional values reach the setter as heap numbers.
+    name: 'View.alpha set',
+    setup: function() { return new View(); },
+    run: function(n, view) {
+      for (var i = 0; i < n; i++) {
+        view.alpha = (i & 255) / 256;
+      }
+    }
+  },
+  {
+    // The same write as 'View.x set', through the shared geometry buffer.
+    name: 'Geometry write',
+    setup: function() { return new View(); },
+    run: function(n, view) {
+      var geometry = Geometry;
+      var x = view.slot * geometry.stride + geometry.X;
+      for (var i = 0; i < n; i++) {
+        geometry[x] = i & 1023;
+      }
+      geometry.dirty[view.slot] = 1;
+    }
+  },
+  {
+    name: 'new View',
+    run: function(n) {
+      var view;
+      for (var i = 0; i < n; i++) {
+        view = new View();
+      }
+      return view;
+    }
+  },
+  {
+    // Builds garbage wrappers; the runner forces a full collection after
+    // the loop so the weak callbacks (View::Dispose) land in the numbers.
+    name: 'View dispose',
+    collect: true,
+    run: function(n) {
+      for (var i = 0; i < n; i++) {
+        new View();
+      }
+    }
+  }
+];
+
+// A run is 1000 crossings and the reference 100 us, so a score of 100 is
+// 100 ns a crossing and higher is faster, as in the V8 suite.
+if (typeof BenchmarkSuite != 'undefined') {
+  BridgeCrossings.forEach(function(test) {
+    var state;
+    new BenchmarkSuite(test.name, 100, [
+      new Benchmark(test.name,
+                    function() { test.run(1000, state); },
+                    function() { state = test.setup ? test.setup() : undefined; },
+                    function() { state = undefined; })
+    ]);
+  });
+}
@@ -0,0 +1,31 @@
+// Runs the crossing cases under the V8 benchmark harness, the way
+// libs/v8/benchmarks/run.js runs the V8 suite:
+//
+//   zb_bench ../../libs/v8/benchmarks/base.js benchmarks/crossings.js benchmarks/run.js
+//
+// zb_bench provides print; the score is the geometric mean over cases.
+
+var success = true;
+
+function PrintResult(name, result) {
+  print(name + ': ' + result);
+}
+
+
+function PrintError(name, error) {
+  PrintResult(name, error);
+  success = false;
+}
+
+
+function PrintScore(score) {
+  if (success) {
+    print('----');
+    print('Score (version ' + BenchmarkSuite.version + '): ' + score);
+  }
+}
+
+
+BenchmarkSuite.RunSuites({ NotifyResult: PrintResult,
+                           NotifyError: PrintError,
+                           NotifyScore: PrintScore });
@@ -0,0 +1,56 @@
+//
+//  zb.js
+//  zb
+//
+//  Created by  on 12/03/06.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Pure-JS helpers shared by bridge scripts. Built into the startup
+//  snapshot by zb_mksnapshot, so top-level code here must not touch the
+//  native globals (View, Log, Geometry): they only exist once a runtime
+//  context is created. Keep every function defined at the top level, too;
+//  a closure made inside another function holds on to the snapshot's own
+//  global object and would not see the runtime's globals.
+//
+
+var ZB = {};
+
+ZB.extend = function (target) {
+    for (var i = 1; i < arguments.length; i++) {
+        var source = arguments[i];
+        for (var key in source) {
+            if (source.hasOwnProperty(key)) {
+                target[key] = source[key];
+            }
+        }
+    }
+    return target;
+};
+
+ZB.each = function (array, fn) {
+    for (var i = 0; i < array.length; i++) {
+        fn(array[i], i);
+    }
+};
+
+ZB.clamp = function (value, min, max) {
+    return value < min ? min : (value > max ? max : value);
+};
+
+// Sets a whole frame in one go; each write still only marks the view,
+// so the commit sends a single SetFrame.
+ZB.frame = function (view, x, y, width, height) {
+    view.x = x;
+    view.y = y;
+    view.width = width;
+    view.height = height;
+    return view;
+};
+
+ZB.create = function (parent, x, y, width, height) {
+    var view = ZB.frame(new View(), x, y, width, height);
+    if (parent) {
+        parent.addSubview(view);
+    }
+    return view;
+};
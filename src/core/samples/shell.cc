@@ -0,0 +1,314 @@
+//
+//  shell.cc
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Runs bridge scripts against the in-memory backend and optionally dumps
+//  the resulting view tree:
+//
+//    zb_shell [--dump] [--stats] [--threaded] [--write-preparse] [--histograms[=out.csv]]
+//             [--record=trace.zbr] [--log-level=debug|info|warn|error]
+//             [-f framework.js] [-e source] file.js ...
+//
+//  --stats prints the runtime's script cache hits and misses, what the
+//  shadow tree's layout passes recomputed, the GC work done in idle time,
+//  the event loop's timers, frames and input batches, and how many log
+//  lines were written, dropped or rate limited.
+//  -f bootstraps a framework script, skipping it when the startup snapshot
+//  built by zb_mksnapshot already has it.
+//  --threaded runs the scripts on a ScriptThread and drains its commands
+//  on the main thread, the way the UI thread does on device.
+//  --write-preparse saves preparse data next to each file that has none
+//  or a stale one; files compiled later use it (see zb_preparse).
+//  --record writes what the runtime was given and every bridge call it
+//  made to a trace for zb_replay.
+//  --histograms times every bridge callback and writes the per-binding
+//  histograms and V8's counters as CSV, to stdout or the given file.
+//
+//  Animations, timers and requestAnimationFrame callbacks run to the end on
+//  a simulated 60 Hz clock before the dump, and the shell waits until
+//  workers have no messages left in flight. With --threaded timers run in
+//  real time.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "v8.h"
+#include "animator.h"
+#include "log_channel.h"
+#include "memory_backend.h"
+#include "recorder.h"
+#include "runtime.h"
+#include "script_thread.h"
+#include "trace.h"
+
+static bool ReadFile(const char *name, std::string *out)
+{
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out->append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+struct Framework {
+    std::string name;
+    std::string source;
+};
+
+// A -e source, or a file left unread so it can be mapped at run time.
+struct Script {
+    std::string path;
+    std::string source;
+};
+
+static const char *BaseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static bool ParseLogLevel(const char *name, zb::LogChannel::Level *out)
+{
+    static const char *const kNames[] = { "debug", "info", "warn", "error" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, kNames[i]) == 0) {
+            *out = static_cast<zb::LogChannel::Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static const double kFrameInterval = 1.0 / 60;
+
+static zb::Event AnimationEvent(int id, bool finished)
+{
+    zb::Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = finished ? zb::Event::kAnimationFinished : zb::Event::kAnimationInterrupted;
+    event.animation = id;
+    return event;
+}
+
+// Completions can arrive while a script is running, so on a single thread
+// they wait until the runtime is free again.
+static void CollectCompletion(void *data, int id, bool finished)
+{
+    static_cast<std::vector<zb::Event> *>(data)->push_back(AnimationEvent(id, finished));
+}
+
+static void PostCompletion(void *data, int id, bool finished)
+{
+    static_cast<zb::ScriptThread *>(data)->PostEvent(AnimationEvent(id, finished));
+}
+
+static bool RunThreaded(const std::vector<Framework> &frameworks, const std::vector<Script> &sources, zb::Animator *animator)
+{
+    zb::ScriptThread thread;
+    animator->SetCompletion(PostCompletion, &thread);
+    thread.Start();
+    for (size_t i = 0; i < frameworks.size(); i++) {
+        thread.Post(frameworks[i].source.c_str());
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i].path.empty()) {
+            thread.Post(sources[i].source.c_str());
+            continue;
+        }
+        thread.PostFile(sources[i].path);
+    }
+    int commands = 0;
+    double now = 0;
+    for (;;) {
+        commands += thread.Drain(animator);
+        now += kFrameInterval;
+        animator->Tick(now);
+        // Commands left by the last batch may still start animations or
+        // interrupt some, which posts more events.
+        if (thread.IsIdle()) {
+            commands += thread.Drain(animator);
+            if (!animator->active() && thread.IsIdle()) {
+                if (!thread.HasTimers()) {
+                    break;
+                }
+                // Only timers left; they run in real time.
+                std::this_thread::sleep_for(std::chrono::duration<double>(kFrameInterval));
+            }
+        }
+        std::this_thread::yield();
+    }
+    thread.Stop();
+    commands += thread.Drain(animator);
+    fprintf(stderr, "%d commands, %lld producer stalls\n", commands, static_cast<long long>(thread.command_stalls()));
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    v8::V8::SetFlagsFromCommandLine(&argc, argv, true);
+    
+    bool dump = false;
+    bool stats = false;
+    bool threaded = false;
+    bool write_preparse = false;
+    const char *trace = NULL;
+    const char *record = NULL;
+    std::vector<Framework> frameworks;
+    std::vector<Script> sources;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--threaded") == 0) {
+            threaded = true;
+        } else if (strcmp(argv[i], "--write-preparse") == 0) {
+            write_preparse = true;
+        } else if (strncmp(argv[i], "--record=", 9) == 0) {
+            record = argv[i] + 9;
+        } else if (strcmp(argv[i], "--histograms") == 0) {
+            trace = "";
+        } else if (strncmp(argv[i], "--histograms=", 13) == 0) {
+            trace = argv[i] + 13;
+        } else if (strncmp(argv[i], "--log-level=", 12) == 0) {
+            zb::LogChannel::Level level;
+            if (!ParseLogLevel(argv[i] + 12, &level)) {
+                fprintf(stderr, "Unknown log level '%s'\n", argv[i] + 12);
+                return 1;
+            }
+            zb::LogChannel::Shared()->set_level(level);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            Framework framework;
+            framework.name = BaseName(argv[++i]);
+            if (!ReadFile(argv[i], &framework.source)) {
+                fprintf(stderr, "Error reading '%s'\n", argv[i]);
+                return 1;
+            }
+            frameworks.push_back(framework);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            Script script;
+            script.source = argv[++i];
+            sources.push_back(script);
+        } else {
+            Script script;
+            script.path = argv[i];
+            sources.push_back(script);
+        }
+    }
+    
+    if (trace != NULL) {
+        zb::Tracer::Enable();
+    }
+    if (record != NULL && !zb::Recorder::Start(record)) {
+        fprintf(stderr, "Error writing '%s'\n", record);
+        return 1;
+    }
+    zb::MemoryBackend backend;
+    zb::Animator animator(&backend);
+    bool ok = true;
+    if (threaded) {
+        ok = RunThreaded(frameworks, sources, &animator);
+    } else {
+        std::vector<zb::Event> completions;
+        animator.SetCompletion(CollectCompletion, &completions);
+        zb::Runtime runtime(&animator);
+        runtime.set_write_preparse(write_preparse);
+        for (size_t i = 0; i < frameworks.size() && ok; i++) {
+            ok = runtime.Bootstrap(frameworks[i].name.c_str(), frameworks[i].source.c_str());
+        }
+        for (size_t i = 0; i < sources.size() && ok; i++) {
+            if (sources[i].path.empty()) {
+                ok = runtime.Run(sources[i].source.c_str());
+            } else {
+                ok = runtime.RunFile(sources[i].path.c_str());
+            }
+        }
+        // Timers run on simulated time too: when they are all that is
+        // left, the clock skips ahead to the next one.
+        double now = 0;
+        double clock = zb::Runtime::Now();
+        while (animator.active() || !completions.empty() || runtime.worker_inbox()->busy() ||
+               runtime.NextTimer() != HUGE_VAL || runtime.HasFrameCallbacks()) {
+            now += kFrameInterval;
+            clock += kFrameInterval;
+            if (!animator.active() && completions.empty() && !runtime.worker_inbox()->busy() && !runtime.HasFrameCallbacks()) {
+                clock = std::max(clock, runtime.NextTimer());
+            }
+            animator.Tick(now);
+            std::vector<zb::Event> events;
+            events.swap(completions);
+            if (!events.empty()) {
+                runtime.DispatchEvents(&events[0], static_cast<int>(events.size()));
+            }
+            runtime.DeliverWorkerMessages();
+            runtime.RunTimers(clock);
+            runtime.RunFrame(clock);
+            runtime.Commit();
+            std::this_thread::yield();
+        }
+        // One frame's worth of idle time, as the script thread would get.
+        runtime.Idle(zb::Runtime::Now() + kFrameInterval);
+        if (stats) {
+            const zb::ScriptCache::Stats &cache = runtime.script_cache()->stats();
+            fprintf(stderr, "script cache: %lld hits, %lld misses, %lld evictions\n",
+                    static_cast<long long>(cache.hits), static_cast<long long>(cache.misses), static_cast<long long>(cache.evictions));
+            const zb::LayoutEngine::Stats &layout = runtime.shadow_tree()->layout_stats();
+            fprintf(stderr, "layout: %lld passes, %lld containers, %lld frames\n",
+                    static_cast<long long>(layout.passes), static_cast<long long>(layout.containers), static_cast<long long>(layout.frames));
+            const zb::Runtime::IdleStats &idle = runtime.idle_stats();
+            fprintf(stderr, "idle gc: %lld periods, %lld steps, %lld rounds, %.2f ms\n",
+                    static_cast<long long>(idle.periods), static_cast<long long>(idle.steps),
+                    static_cast<long long>(idle.rounds), idle.time * 1000);
+            const zb::EventLoop::Stats &loop = runtime.event_loop()->stats();
+            fprintf(stderr, "event loop: %lld timers, %lld frames, %lld events, %lld coalesced, %lld batches, %lld entries\n",
+                    static_cast<long long>(loop.timers), static_cast<long long>(loop.frames), static_cast<long long>(loop.events),
+                    static_cast<long long>(loop.coalesced), static_cast<long long>(loop.batches), static_cast<long long>(loop.entries));
+        }
+    }
+    zb::Recorder::Stop();
+    // Script output is written in the background; get all of it out
+    // before anything else goes to stdout.
+    zb::LogChannel::Shared()->Flush();
+    if (stats) {
+        zb::LogChannel::Stats log = zb::LogChannel::Shared()->stats();
+        fprintf(stderr, "log: %lld written, %lld dropped, %lld rate limited, %lld batches\n",
+                static_cast<long long>(log.written), static_cast<long long>(log.dropped),
+                static_cast<long long>(log.suppressed), static_cast<long long>(log.batches));
+        const zb::Animator::Stats &animations = animator.stats();
+        fprintf(stderr, "animations: %lld started, %lld finished, %lld interrupted, %lld ticks\n",
+                static_cast<long long>(animations.started), static_cast<long long>(animations.finished),
+                static_cast<long long>(animations.interrupted), static_cast<long long>(animations.ticks));
+    }
+    if (dump) {
+        backend.Dump(stdout);
+    }
+    if (trace != NULL) {
+        FILE *out = *trace ? fopen(trace, "w") : stdout;
+        if (out == NULL) {
+            fprintf(stderr, "Error writing '%s'\n", trace);
+            return 1;
+        }
+        zb::Tracer::WriteCSV(out);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+    return ok ? 0 : 1;
+}
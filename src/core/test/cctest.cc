@@ -0,0 +1,79 @@
+//
+//  cctest.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cctest.h"
+
+CcTest *CcTest::last_ = NULL;
+
+// Tests are known by the base name of their file, without extension.
+CcTest::CcTest(TestFunction callback, const char *file, const char *name)
+    : callback_(callback), name_(name), prev_(last_)
+{
+    const char *basename = strrchr(file, '/');
+    basename = basename != NULL ? basename + 1 : file;
+    const char *extension = strrchr(basename, '.');
+    size_t length = extension != NULL ? static_cast<size_t>(extension - basename) : strlen(basename);
+    char *copy = new char[length + 1];
+    memcpy(copy, basename, length);
+    copy[length] = '\0';
+    file_ = copy;
+    last_ = this;
+}
+
+void CcTest::Fail(const char *file, int line, const char *message)
+{
+    fprintf(stderr, "%s:%d: %s\n", file, line, message);
+    fflush(stderr);
+    abort();
+}
+
+namespace {
+    bool Matches(const CcTest *test, const char *filter)
+    {
+        const char *slash = strchr(filter, '/');
+        if (slash != NULL) {
+            return std::string(filter, slash - filter) == test->file() && strcmp(slash + 1, test->name()) == 0;
+        }
+        return strcmp(filter, test->file()) == 0 || strcmp(filter, test->name()) == 0;
+    }
+}
+
+// zb_cctest [--list] [file | name | file/name ...]
+int main(int argc, char *argv[])
+{
+    v8::V8::SetFlagsFromCommandLine(&argc, argv, true);
+    std::vector<CcTest *> tests;
+    for (CcTest *test = CcTest::last(); test != NULL; test = test->prev()) {
+        tests.insert(tests.begin(), test);
+    }
+    bool list = argc > 1 && strcmp(argv[1], "--list") == 0;
+    int run = 0;
+    for (size_t i = 0; i < tests.size(); i++) {
+        bool selected = argc <= (list ? 2 : 1);
+        for (int j = list ? 2 : 1; j < argc && !selected; j++) {
+            selected = Matches(tests[i], argv[j]);
+        }
+        if (!selected) {
+            continue;
+        }
+        printf("%s/%s\n", tests[i]->file(), tests[i]->name());
+        fflush(stdout);
+        if (!list) {
+            tests[i]->Run();
+            run++;
+        }
+    }
+    if (!list) {
+        printf("Ran %d tests.\n", run);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+//
+//  cctest.h
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  A small test harness in the style of V8's test/cctest: each TEST
+//  registers itself, and zb_cctest runs them all, or only those whose
+//  file or name matches an argument ("test-ring" or "test-ring/Wraps").
+//
+
+#ifndef ZB_CCTEST_H_
+#define ZB_CCTEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "v8.h"
+#include "memory_backend.h"
+#include "runtime.h"
+
+#define TEST(Name)                                              \
+    static void Test##Name();                                   \
+    static CcTest register_test_##Name(Test##Name, __FILE__, #Name); \
+    static void Test##Name()
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            CcTest::Fail(__FILE__, __LINE__, "CHECK(" #condition ") failed");     \
+        }                                                                         \
+    } while (false)
+
+#define CHECK_EQ(expected, actual) CHECK((expected) == (actual))
+
+class CcTest {
+public:
+    typedef void (*TestFunction)();
+    
+    CcTest(TestFunction callback, const char *file, const char *name);
+    void Run() { callback_(); }
+    const char *file() const { return file_; }
+    const char *name() const { return name_; }
+    CcTest *prev() const { return prev_; }
+    
+    static CcTest *last() { return last_; }
+    static void Fail(const char *file, int line, const char *message);
+private:
+    TestFunction callback_;
+    const char *file_;
+    const char *name_;
+    CcTest *prev_;
+    
+    static CcTest *last_;
+};
+
+// A headless runtime with its isolate and context entered for the length
+// of a test, for code that works on script values.
+class RuntimeScope {
+public:
+    RuntimeScope()
+        : runtime_(&backend_), locker_(runtime_.isolate()), isolate_scope_(runtime_.isolate()),
+          context_scope_(runtime_.context())
+    {
+    }
+    
+    zb::Runtime *runtime() { return &runtime_; }
+    zb::MemoryBackend *backend() { return &backend_; }
+    
+    // Runs |source| in the runtime's context and returns its value.
+    v8::Local<v8::Value> Eval(const char *source)
+    {
+        v8::Local<v8::Script> script = v8::Script::Compile(v8::String::New(source));
+        CHECK(!script.IsEmpty());
+        return script->Run();
+    }
+private:
+    zb::MemoryBackend backend_;
+    zb::Runtime runtime_;
+    v8::Locker locker_;
+    v8::Isolate::Scope isolate_scope_;
+    v8::HandleScope handle_scope_;
+    v8::Context::Scope context_scope_;
+};
+
+#endif  // ZB_CCTEST_H_
@@ -0,0 +1,161 @@
+//
+//  test-animator.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <utility>
+#include <vector>
+
+#include "cctest.h"
+#include "animator.h"
+#include "memory_backend.h"
+
+using zb::Animation;
+using zb::Animator;
+using zb::Frame;
+using zb::MemoryBackend;
+using zb::NativeView;
+
+namespace {
+    typedef std::vector<std::pair<int, bool> > Reports;
+
+    void Completed(void *data, int id, bool finished)
+    {
+        static_cast<Reports *>(data)->push_back(std::make_pair(id, finished));
+    }
+
+    Animation MakeAnimation(int id, int fields, float value, double duration)
+    {
+        Animation animation;
+        animation.id = id;
+        animation.fields = fields;
+        animation.frame.x = value;
+        animation.frame.y = value;
+        animation.frame.width = value;
+        animation.frame.height = value;
+        animation.alpha = value;
+        animation.duration = duration;
+        animation.delay = 0;
+        animation.curve = Animation::kLinear;
+        return animation;
+    }
+
+    // A headless backend with one 10x10 view behind an animator.
+    class AnimatorScope {
+    public:
+        AnimatorScope() : backend_(NULL), animator_(&backend_)
+        {
+            animator_.SetCompletion(Completed, &reports_);
+            view_ = animator_.CreateView();
+            Frame frame = { 0, 0, 10, 10 };
+            animator_.SetFrame(view_, frame);
+        }
+
+        Animator *animator() { return &animator_; }
+        NativeView view() { return view_; }
+        const Reports &reports() { return reports_; }
+        Frame frame() { return animator_.GetFrame(view_); }
+        float alpha() { return animator_.GetAlpha(view_); }
+    private:
+        MemoryBackend backend_;
+        Animator animator_;
+        NativeView view_;
+        Reports reports_;
+    };
+}
+
+TEST(AnimatorInterpolatesOwnedFields)
+{
+    AnimatorScope scope;
+    Animator *animator = scope.animator();
+    animator->Animate(scope.view(), MakeAnimation(1, Animation::kX, 100, 1));
+
+    // The first tick starts the clock.
+    CHECK(animator->Tick(10));
+    CHECK_EQ(0, scope.frame().x);
+    CHECK(animator->Tick(10.25));
+    CHECK_EQ(25, scope.frame().x);
+    CHECK_EQ(1, scope.alpha());
+    CHECK_EQ(10, scope.frame().width);
+
+    Animation eased = MakeAnimation(2, Animation::kWidth, 30, 1);
+    eased.curve = Animation::kEaseIn;
+    animator->Animate(scope.view(), eased);
+    CHECK(animator->Tick(10.5));
+    CHECK(animator->Tick(11));
+    CHECK_EQ(10 + 20 * 0.25f, scope.frame().width);
+    CHECK_EQ(100, scope.frame().x);
+}
+
+TEST(AnimatorReportsCompletionAfterItsDelay)
+{
+    AnimatorScope scope;
+    Animator *animator = scope.animator();
+    Animation animation = MakeAnimation(7, Animation::kY, 40, 0.5);
+    animation.delay = 1;
+    animator->Animate(scope.view(), animation);
+    animator->Animate(scope.view(), MakeAnimation(0, Animation::kAlpha, 0, 0.25));
+
+    CHECK(animator->Tick(0));
+    CHECK(animator->Tick(0.75));
+    CHECK_EQ(0, scope.frame().y);
+    CHECK_EQ(0, scope.alpha());
+    // Id 0 asked for no report.
+    CHECK(scope.reports().empty());
+    CHECK(animator->Tick(1.25));
+    CHECK_EQ(20, scope.frame().y);
+
+    CHECK(!animator->Tick(1.5));
+    CHECK_EQ(40, scope.frame().y);
+    CHECK_EQ(1u, scope.reports().size());
+    CHECK(scope.reports()[0] == std::make_pair(7, true));
+    CHECK(!animator->active());
+    CHECK_EQ(2, animator->stats().finished);
+    CHECK_EQ(0, animator->stats().interrupted);
+}
+
+// A later animation on the same field takes it over from where the screen
+// is; the earlier one keeps its other fields and is only interrupted once
+// it has none left.
+TEST(AnimatorHandsOverSharedFields)
+{
+    AnimatorScope scope;
+    Animator *animator = scope.animator();
+    Animation first = MakeAnimation(1, Animation::kX | Animation::kAlpha, 0, 1);
+    first.frame.x = 100;
+    animator->Animate(scope.view(), first);
+    animator->Tick(0);
+    animator->Tick(0.5);
+    CHECK_EQ(50, scope.frame().x);
+    CHECK_EQ(0.5f, scope.alpha());
+
+    // A frame write takes x; 1 goes on with the alpha alone.
+    Frame frame = scope.frame();
+    frame.x = 80;
+    animator->SetFrame(scope.view(), frame);
+    animator->Tick(0.75);
+    CHECK_EQ(80, scope.frame().x);
+    CHECK_EQ(0.25f, scope.alpha());
+    CHECK(scope.reports().empty());
+
+    animator->Animate(scope.view(), MakeAnimation(2, Animation::kAlpha, 1, 1));
+    CHECK_EQ(1u, scope.reports().size());
+    CHECK(scope.reports()[0] == std::make_pair(1, false));
+
+    // Starts from the 0.25 on screen, not from where 1 began.
+    animator->Tick(1);
+    animator->Tick(1.5);
+    CHECK_EQ(0.625f, scope.alpha());
+    CHECK_EQ(80, scope.frame().x);
+
+    // A plain write ends it too.
+    animator->SetAlpha(scope.view(), 0.2f);
+    CHECK(!animator->active());
+    CHECK_EQ(2u, scope.reports().size());
+    CHECK(scope.reports()[1] == std::make_pair(2, false));
+    CHECK_EQ(2, animator->stats().interrupted);
+    CHECK_EQ(0.2f, scope.alpha());
+}
@@ -0,0 +1,101 @@
+//
+//  test-event-loop.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <math.h>
+
+#include "cctest.h"
+#include "runtime.h"
+
+namespace {
+    double now;
+    
+    double Clock(void *data)
+    {
+        return now;
+    }
+    
+    // Timers count from |now|, which the test moves by hand. The loop
+    // works in whole milliseconds; starting a quarter into one keeps the
+    // steps below from landing on a boundary.
+    void UseClock(RuntimeScope *scope)
+    {
+        now = (floor(zb::Runtime::Now() * 1000) + 0.25) / 1000;
+        scope->runtime()->SetClock(Clock, NULL);
+    }
+    
+    int RunTimers(RuntimeScope *scope, double ms)
+    {
+        now += ms / 1000;
+        return scope->runtime()->RunTimers(now);
+    }
+}
+
+TEST(TimersRunInExpiryOrder)
+{
+    RuntimeScope scope;
+    UseClock(&scope);
+    scope.Eval("var log = [];"
+               "setTimeout(function (x) { log.push(x); }, 10, 'c');"
+               "setTimeout(function () { log.push('a'); }, 1);"
+               "setTimeout(function () { log.push('b'); throw 1; }, 5);");
+    CHECK_EQ(0, RunTimers(&scope, 0.5));
+    CHECK_EQ(3, RunTimers(&scope, 20));
+    CHECK(scope.Eval("log.join() === 'a,b,c'")->IsTrue());
+}
+
+// All three are due in one batch; the first clears the other two.
+TEST(TimersClearedInTheirBatchDoNotRun)
+{
+    RuntimeScope scope;
+    UseClock(&scope);
+    scope.Eval("var log = [], b, c;"
+               "setTimeout(function () { log.push('a'); clearTimeout(b); clearInterval(c); }, 5);"
+               "b = setTimeout(function () { log.push('b'); }, 5);"
+               "c = setInterval(function () { log.push('c'); }, 5);");
+    CHECK_EQ(3, RunTimers(&scope, 10));
+    CHECK_EQ(0, RunTimers(&scope, 10));
+    CHECK(scope.Eval("log.join() === 'a'")->IsTrue());
+}
+
+TEST(IntervalClearedByATimeoutStops)
+{
+    RuntimeScope scope;
+    UseClock(&scope);
+    scope.Eval("var ticks = 0, interval;"
+               "setTimeout(function () { clearInterval(interval); }, 50);"
+               "interval = setInterval(function () { ticks++; }, 20);");
+    for (int i = 0; i < 10; i++) {
+        RunTimers(&scope, 10);
+    }
+    CHECK(scope.Eval("ticks === 2")->IsTrue());
+}
+
+// Timer and frame ids are counted separately; cancelling a frame callback
+// from a timer leaves the timer with the same id alone.
+TEST(ClearingTheOtherKindKeepsTheBatch)
+{
+    RuntimeScope scope;
+    UseClock(&scope);
+    scope.Eval("var log = [];"
+               "setTimeout(function () { log.push(1); cancelAnimationFrame(2); }, 1);"
+               "setTimeout(function () { log.push(2); }, 1);");
+    CHECK_EQ(2, RunTimers(&scope, 5));
+    CHECK(scope.Eval("log.join() === '1,2'")->IsTrue());
+}
+
+TEST(FrameCallbacksCancelledInTheirFrameDoNotRun)
+{
+    RuntimeScope scope;
+    scope.Eval("var log = [], second;"
+               "requestAnimationFrame(function (t) { log.push(t); cancelAnimationFrame(second); requestAnimationFrame(function () { log.push('next'); }); });"
+               "second = requestAnimationFrame(function () { log.push('second'); });");
+    CHECK_EQ(2, scope.runtime()->RunFrame(1.5));
+    CHECK(scope.Eval("log.join() === '1500'")->IsTrue());
+    CHECK_EQ(1, scope.runtime()->RunFrame(1.6));
+    CHECK(scope.Eval("log.join() === '1500,next'")->IsTrue());
+}
@@ -0,0 +1,61 @@
+//
+//  test-finalization.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "runtime.h"
+
+using zb::FinalizationRegistry;
+
+namespace {
+    // Leaves |count| dead View wrappers for the next collection.
+    void DropViews(RuntimeScope *scope, int count)
+    {
+        v8::HandleScope handle_scope;
+        v8::Local<v8::Function> drop = v8::Local<v8::Function>::Cast(
+            scope->Eval("(function (n) { for (var i = 0; i < n; i++) { new View(); } })"));
+        v8::Handle<v8::Value> argv[] = { v8::Integer::New(count) };
+        drop->Call(v8::Context::GetCurrent()->Global(), 1, argv);
+    }
+}
+
+// The collection only defers; the natives go in Flush.
+TEST(FinalizerDefersToFlush)
+{
+    RuntimeScope scope;
+    FinalizationRegistry *finalizer = scope.runtime()->finalizer();
+    DropViews(&scope, 10);
+    v8::V8::LowMemoryNotification();
+    CHECK_EQ(10u, finalizer->pending());
+    CHECK_EQ(10, scope.backend()->live_views());
+    
+    // Too few to hold up a commit; they wait for idle time.
+    scope.runtime()->Commit();
+    CHECK_EQ(10u, finalizer->pending());
+    scope.runtime()->Idle();
+    CHECK_EQ(0u, finalizer->pending());
+    CHECK_EQ(10, finalizer->stats().finalized);
+    CHECK_EQ(1, finalizer->stats().batches);
+}
+
+// A host that never calls Idle must not pile up dead wrappers.
+TEST(FinalizerDrainsWithoutIdle)
+{
+    RuntimeScope scope;
+    FinalizationRegistry *finalizer = scope.runtime()->finalizer();
+    for (int round = 0; round < 5; round++) {
+        DropViews(&scope, 1000);
+        v8::V8::LowMemoryNotification();
+        CHECK(finalizer->pending() >= 1000);
+        scope.runtime()->Commit();
+        CHECK_EQ(0u, finalizer->pending());
+    }
+    CHECK_EQ(5000, finalizer->stats().finalized);
+    // What is left of the natives is what the pool keeps for reuse.
+    CHECK(static_cast<size_t>(scope.backend()->live_views()) <= scope.runtime()->view_pool()->budget());
+}
@@ -0,0 +1,113 @@
+//
+//  test-geometry.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "runtime.h"
+
+using zb::MemoryBackend;
+
+namespace {
+    const MemoryBackend::Stats &Stats(RuntimeScope *scope)
+    {
+        return scope->backend()->stats();
+    }
+}
+
+// Setter writes wait for the commit, which sends each view at most one
+// frame and one alpha write, all in one backend commit.
+TEST(GeometryCommitsOneWritePerView)
+{
+    RuntimeScope scope;
+    scope.Eval("var a = new View(), b = new View();");
+    int commits = Stats(&scope).commits;
+    scope.Eval("a.x = 1; a.y = 2; a.width = 3; a.x = 4; a.alpha = 0.5; a.alpha = 0.25; b.height = 7;");
+    CHECK_EQ(0, Stats(&scope).frame_writes);
+    CHECK_EQ(0, Stats(&scope).alpha_writes);
+
+    scope.runtime()->Commit();
+    CHECK_EQ(commits + 1, Stats(&scope).commits);
+    CHECK_EQ(2, Stats(&scope).frame_writes);
+    CHECK_EQ(1, Stats(&scope).alpha_writes);
+    CHECK(scope.Eval("a.x === 4 && a.y === 2 && a.width === 3 && a.alpha === 0.25 && b.height === 7")->IsTrue());
+}
+
+// Nothing changed, nothing sent: not even an empty backend commit.
+TEST(GeometrySkipsUnchangedViews)
+{
+    RuntimeScope scope;
+    scope.Eval("var view = new View(); view.x = 10;");
+    scope.runtime()->Commit();
+    int commits = Stats(&scope).commits;
+    int frames = Stats(&scope).frame_writes;
+
+    scope.runtime()->Commit();
+    CHECK_EQ(commits, Stats(&scope).commits);
+    scope.Eval("view.x = 20; view.x = 10; view.alpha = 1;");
+    scope.runtime()->Commit();
+    CHECK_EQ(frames, Stats(&scope).frame_writes);
+    CHECK_EQ(0, Stats(&scope).alpha_writes);
+}
+
+// Scripts and setters share one model; the buffer shows setter writes and
+// setters read script writes.
+TEST(GeometryBufferSharesTheModel)
+{
+    RuntimeScope scope;
+    scope.Eval("var view = new View(); view.x = 5;"
+               "var x = view.slot * Geometry.stride + Geometry.X;");
+    CHECK(scope.Eval("Geometry[x] === 5")->IsTrue());
+    scope.Eval("Geometry[x] = 12; Geometry[x + Geometry.ALPHA - Geometry.X] = 0.5; Geometry.dirty[view.slot] = 1;");
+    CHECK(scope.Eval("view.x === 12 && view.alpha === 0.5")->IsTrue());
+
+    scope.runtime()->Commit();
+    CHECK_EQ(1, Stats(&scope).frame_writes);
+    CHECK_EQ(1, Stats(&scope).alpha_writes);
+    CHECK(scope.Eval("Geometry.dirty[view.slot] === 0")->IsTrue());
+}
+
+// Commits visit only marked slots, from setters or scripts, and skip
+// the backend altogether when none are.
+TEST(GeometryCommitsOnlyMarkedSlots)
+{
+    RuntimeScope scope;
+    scope.Eval("var views = [], g = Geometry;"
+               "for (var i = 0; i < 100; i++) { views.push(new View()); }"
+               "function x(view) { return view.slot * g.stride + g.X; }");
+    int commits = Stats(&scope).commits;
+    scope.runtime()->Commit();
+    CHECK_EQ(commits, Stats(&scope).commits);
+
+    scope.Eval("g[x(views[3])] = 1; g[x(views[70])] = 2; g[x(views[99])] = 3;"
+               "g.dirty[views[3].slot] = 1; g.dirty[views[99].slot] = 1; views[50].y = 4;");
+    scope.runtime()->Commit();
+    CHECK_EQ(commits + 1, Stats(&scope).commits);
+    CHECK_EQ(3, Stats(&scope).frame_writes);
+
+    // The unmarked write waits for its mark.
+    scope.runtime()->Commit();
+    CHECK_EQ(3, Stats(&scope).frame_writes);
+    scope.Eval("g.dirty[views[70].slot] = 1;");
+    scope.runtime()->Commit();
+    CHECK_EQ(4, Stats(&scope).frame_writes);
+}
+
+// Growing moves the storage under the same script objects.
+TEST(GeometryKeepsItsObjectsAcrossGrowth)
+{
+    RuntimeScope scope;
+    scope.Eval("var g = Geometry, length = g.length, views = [];"
+               "for (var i = 0; i < 200; i++) { views.push(new View()); }"
+               "var last = views[199]; last.width = 9;");
+    CHECK(scope.Eval("g === Geometry && g.length > length && g.dirty.length * g.stride === g.length")->IsTrue());
+    CHECK(scope.Eval("g[last.slot * g.stride + g.WIDTH] === 9 && g.dirty[last.slot] === 1")->IsTrue());
+    scope.Eval("g[last.slot * g.stride + g.HEIGHT] = 3; g.dirty[last.slot] = 1;");
+    scope.runtime()->Commit();
+    CHECK_EQ(1, Stats(&scope).frame_writes);
+    CHECK(scope.Eval("last.height === 3")->IsTrue());
+}
@@ -0,0 +1,130 @@
+//
+//  test-layout.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "runtime.h"
+#include "shadow_tree.h"
+
+using zb::Frame;
+using zb::LayoutEngine;
+using zb::MemoryView;
+using zb::ShadowNode;
+
+namespace {
+    // The node at |path|, child indexes from the root, checking that the
+    // backend got the same frame the node holds.
+    const ShadowNode *Node(RuntimeScope *scope, const char *path)
+    {
+        const ShadowNode *node = scope->runtime()->shadow_tree()->root();
+        for (const char *p = path; *p; p++) {
+            node = node->children[*p - '0'];
+        }
+        CHECK(zb::SameFrame(node->frame, static_cast<const MemoryView *>(node->native)->frame));
+        return node;
+    }
+
+    bool HasFrame(RuntimeScope *scope, const char *path, float x, float y, float width, float height)
+    {
+        Frame frame = { x, y, width, height };
+        return zb::SameFrame(Node(scope, path)->frame, frame);
+    }
+
+    const LayoutEngine::Stats &Stats(RuntimeScope *scope)
+    {
+        return scope->runtime()->shadow_tree()->layout_stats();
+    }
+}
+
+// Fixed heights come off first; flex children share the rest by weight
+// and stretch across.
+TEST(LayoutColumnSharesSpaceAfterFixedChildren)
+{
+    RuntimeScope scope;
+    scope.Eval(
+        "Render({ width: 100, height: 200, flexDirection: 'column', children: ["
+        "    { height: 50 }, { flex: 1 }, { flex: 3 }, { width: 40, height: 10 }"
+        "] });");
+    CHECK(HasFrame(&scope, "0", 0, 0, 100, 50));
+    CHECK(HasFrame(&scope, "1", 0, 50, 100, 35));
+    CHECK(HasFrame(&scope, "2", 0, 85, 100, 105));
+    CHECK(HasFrame(&scope, "3", 0, 190, 40, 10));
+    CHECK_EQ(1, Stats(&scope).containers);
+}
+
+TEST(LayoutPaddingAndMarginsInsetChildren)
+{
+    RuntimeScope scope;
+    scope.Eval(
+        "Render({ width: 100, height: 50, flexDirection: 'row', padding: 10, children: ["
+        "    { width: 20 }, { flex: 1, margin: 5 }"
+        "] });");
+    CHECK(HasFrame(&scope, "0", 10, 10, 20, 30));
+    CHECK(HasFrame(&scope, "1", 35, 15, 50, 20));
+
+    // Without flex, justifyContent places the leftover space.
+    scope.Eval(
+        "Render({ width: 100, height: 50, flexDirection: 'row', padding: 10, justifyContent: 'flex-end',"
+        "    alignItems: 'center', children: [{ width: 20, height: 10 }, { width: 30, height: 20 }] });");
+    CHECK(HasFrame(&scope, "0", 40, 20, 20, 10));
+    CHECK(HasFrame(&scope, "1", 60, 15, 30, 20));
+}
+
+// Restyling one leaf lays out its parent again and nothing else.
+TEST(LayoutRevisitsOnlyTheRestyledSubtree)
+{
+    RuntimeScope scope;
+    scope.Eval(
+        "function render(width) {"
+        "    Render({ width: 100, height: 100, flexDirection: 'column', children: ["
+        "        { key: 'top', flex: 1, flexDirection: 'row', children: [{ width: 30 }, { flex: 1 }] },"
+        "        { key: 'bottom', flex: 1, flexDirection: 'row', children: [{ width: width }, { flex: 1 }] }"
+        "    ] });"
+        "}"
+        "render(30);");
+    CHECK_EQ(3, Stats(&scope).containers);
+    CHECK(HasFrame(&scope, "11", 30, 0, 70, 50));
+
+    int64_t containers = Stats(&scope).containers;
+    int64_t frames = Stats(&scope).frames;
+    scope.Eval("render(30)");
+    CHECK_EQ(containers, Stats(&scope).containers);
+    CHECK_EQ(frames, Stats(&scope).frames);
+
+    scope.Eval("render(60)");
+    CHECK_EQ(containers + 1, Stats(&scope).containers);
+    CHECK_EQ(frames + 2, Stats(&scope).frames);
+    CHECK(HasFrame(&scope, "10", 0, 0, 60, 50));
+    CHECK(HasFrame(&scope, "11", 60, 0, 40, 50));
+    CHECK(HasFrame(&scope, "01", 30, 0, 70, 50));
+}
+
+// A new root size flows down to the containers whose size it changes.
+TEST(LayoutFollowsAContainerResize)
+{
+    RuntimeScope scope;
+    scope.Eval(
+        "function render(height) {"
+        "    Render({ width: 100, height: height, flexDirection: 'column', children: ["
+        "        { flex: 1, flexDirection: 'row', children: [{ flex: 1 }] },"
+        "        { height: 20, flexDirection: 'row', children: [{ flex: 1 }] }"
+        "    ] });"
+        "}"
+        "render(100);");
+    CHECK(HasFrame(&scope, "00", 0, 0, 100, 80));
+    CHECK(HasFrame(&scope, "1", 0, 80, 100, 20));
+
+    int64_t containers = Stats(&scope).containers;
+    scope.Eval("render(200)");
+    // The root and the flexible row; the fixed row only moved.
+    CHECK_EQ(containers + 2, Stats(&scope).containers);
+    CHECK(HasFrame(&scope, "0", 0, 0, 100, 180));
+    CHECK(HasFrame(&scope, "00", 0, 0, 100, 180));
+    CHECK(HasFrame(&scope, "1", 0, 180, 100, 20));
+    CHECK(HasFrame(&scope, "10", 0, 0, 100, 20));
+}
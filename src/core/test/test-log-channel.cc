@@ -0,0 +1,146 @@
+//
+//  test-log-channel.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "cctest.h"
+#include "log_channel.h"
+#include "runtime.h"
+
+using zb::LogChannel;
+using zb::LogRateLimiter;
+
+namespace {
+    struct Output {
+        std::string text;
+        size_t largest;
+        int calls;
+    };
+    
+    void Collect(void *data, const char *text, size_t length)
+    {
+        Output *output = static_cast<Output *>(data);
+        output->text.append(text, length);
+        output->largest = length > output->largest ? length : output->largest;
+        output->calls++;
+    }
+    
+    void Attach(LogChannel *channel, Output *output)
+    {
+        output->largest = 0;
+        output->calls = 0;
+        channel->SetSink(Collect, output);
+    }
+}
+
+TEST(LogChannelCountsDrops)
+{
+    LogChannel channel(4);
+    Output output;
+    Attach(&channel, &output);
+    for (int i = 0; i < 6; i++) {
+        char message[16];
+        snprintf(message, sizeof(message), "m%d", i);
+        CHECK_EQ(i < 4, channel.Write(LogChannel::kInfo, message, strlen(message)));
+    }
+    channel.set_level(LogChannel::kWarning);
+    CHECK(!channel.Write(LogChannel::kInfo, "filtered", 8));
+    // Passes the level, but the ring is still full.
+    CHECK(!channel.Write(LogChannel::kError, "late", 4));
+    channel.Flush();
+    CHECK(output.text == "m0\nm1\nm2\nm3\n[log] 3 dropped, 0 rate limited\n");
+    CHECK_EQ(4, channel.stats().written);
+    CHECK_EQ(3, channel.stats().dropped);
+    
+    // Drops are reported once.
+    output.text.clear();
+    channel.CountSuppressed(2);
+    channel.Flush();
+    CHECK(output.text == "[log] 0 dropped, 2 rate limited\n");
+    output.text.clear();
+    channel.Flush();
+    CHECK(output.text.empty());
+}
+
+// A batch that leaves less room than the drop report needs is written out
+// before the report, which must not run past the buffer.
+TEST(LogChannelReportFitsTheBuffer)
+{
+    const size_t kBufferSize = 64 * 1024;
+    LogChannel channel(512);
+    Output output;
+    Attach(&channel, &output);
+    std::string full(LogChannel::kMaxMessage, 'x');
+    size_t used = 0;
+    while (used + full.size() + 1 <= kBufferSize - 4) {
+        CHECK(channel.Write(LogChannel::kInfo, full.data(), full.size()));
+        used += full.size() + 1;
+    }
+    std::string rest(kBufferSize - 4 - used - 1, 'y');
+    CHECK(channel.Write(LogChannel::kInfo, rest.data(), rest.size()));
+    channel.CountSuppressed(1);
+    channel.Flush();
+    CHECK_EQ(2, output.calls);
+    CHECK_EQ(kBufferSize - 4, output.largest);
+    CHECK(output.text.size() == kBufferSize - 4 + strlen("[log] 0 dropped, 1 rate limited\n"));
+}
+
+TEST(LogRateLimiterLimitsEachSite)
+{
+    LogRateLimiter limiter(3, 0.001);
+    for (int i = 0; i < 3; i++) {
+        CHECK(limiter.AllowAny());
+        CHECK(limiter.Allow(1));
+    }
+    CHECK(!limiter.AllowAny());
+    CHECK(!limiter.Allow(1));
+    // Another site has a bucket of its own.
+    CHECK(limiter.Allow(2));
+    
+    limiter.Configure(1, 0);
+    CHECK(!limiter.enabled());
+    for (int i = 0; i < 10; i++) {
+        CHECK(limiter.AllowAny());
+        CHECK(limiter.Allow(1));
+    }
+}
+
+TEST(LogRateLimiterRefills)
+{
+    LogRateLimiter limiter(1, 1000);
+    CHECK(limiter.Allow(1));
+    CHECK(!limiter.Allow(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(limiter.Allow(1));
+}
+
+// Print and Log join their arguments the same way and answer to the same
+// per-site limits.
+TEST(LogPrintAndLogShareTheLimiter)
+{
+    RuntimeScope scope;
+    LogChannel *log = LogChannel::Shared();
+    log->Flush();
+    Output output;
+    Attach(log, &output);
+    int64_t suppressed = log->stats().suppressed;
+    scope.runtime()->log_limiter()->Configure(2, 0.001);
+    
+    scope.Eval("Print('a', 1, true); Log.warn('b', null);");
+    // The shared bucket is dry; each loop is a site with a burst of two.
+    scope.Eval("for (var i = 0; i < 5; i++) { Print('p', i); }\n"
+               "for (var i = 0; i < 5; i++) { Log('l', i); }");
+    log->Flush();
+    log->SetSink(NULL, NULL);
+    CHECK_EQ(6, log->stats().suppressed - suppressed);
+    std::string expected = "a 1 true\n[warning] b null\np 0\np 1\nl 0\nl 1\n[log] ";
+    CHECK(output.text.compare(0, expected.size(), expected) == 0);
+}
@@ -0,0 +1,171 @@
+//
+//  test-marshal.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+#include <string>
+
+#include "cctest.h"
+#include "marshal.h"
+
+using zb::Marshaller;
+using zb::Variant;
+
+namespace {
+    bool Same(const Variant &a, const Variant &b)
+    {
+        if (a.type() != b.type()) {
+            return false;
+        }
+        switch (a.type()) {
+            case Variant::kUndefined:
+            case Variant::kNull:
+                return true;
+            case Variant::kBoolean:
+                return a.boolean() == b.boolean();
+            case Variant::kNumber:
+                return a.number() == b.number();
+            case Variant::kString:
+                return a.string() == b.string();
+            case Variant::kArray:
+                if (a.items().size() != b.items().size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < a.items().size(); i++) {
+                    if (!Same(a.items()[i], b.items()[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            case Variant::kObject:
+                if (a.fields().size() != b.fields().size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < a.fields().size(); i++) {
+                    if (a.fields()[i].first != b.fields()[i].first || !Same(a.fields()[i].second, b.fields()[i].second)) {
+                        return false;
+                    }
+                }
+                return true;
+            case Variant::kNumbers:
+                return a.numbers() == b.numbers();
+        }
+        return false;
+    }
+    
+    // Marshals a copy of |value| into the context as the global "value"
+    // and back.
+    bool RoundTrip(RuntimeScope *scope, const Variant &value, Variant *out)
+    {
+        Variant copy = value;
+        Marshaller *marshaller = scope->runtime()->marshaller();
+        v8::Handle<v8::Value> script_value = marshaller->ToV8(&copy);
+        CHECK(!script_value.IsEmpty());
+        v8::Context::GetCurrent()->Global()->Set(v8::String::New("value"), script_value);
+        return marshaller->FromV8(script_value, out);
+    }
+    
+    Variant ObjectWithKey(const std::string &key)
+    {
+        Variant object = Variant::Object();
+        *object.Set(key) = Variant(1.0);
+        *object.Set("plain") = Variant("x");
+        return object;
+    }
+}
+
+TEST(MarshalRoundTrip)
+{
+    RuntimeScope scope;
+    Variant value = Variant::Object();
+    *value.Set("flag") = Variant(true);
+    *value.Set("nothing") = Variant::Null();
+    *value.Set("pi") = Variant(3.25);
+    *value.Set("name") = Variant("caf\xc3\xa9");
+    *value.Set("long") = Variant(std::string(Marshaller::kExternalLength + 10, 'a'));
+    Variant *list = value.Set("list");
+    *list = Variant::Array();
+    *list->Append() = Variant(1.0);
+    *list->Append() = Variant::Object();
+    *list->Append() = Variant("two");
+    Variant *numbers = value.Set("numbers");
+    *numbers = Variant::Numbers();
+    numbers->mutable_numbers()->push_back(0.5);
+    numbers->mutable_numbers()->push_back(-2);
+    
+    Variant out;
+    CHECK(RoundTrip(&scope, value, &out));
+    CHECK(Same(value, out));
+    CHECK(scope.Eval("value.list[2] === 'two' && value.numbers[1] === -2 && value.name.length === 4")->IsTrue());
+    CHECK_EQ(1, scope.runtime()->marshaller()->stats().external_strings);
+}
+
+TEST(MarshalSharesShapes)
+{
+    RuntimeScope scope;
+    Marshaller *marshaller = scope.runtime()->marshaller();
+    Variant out;
+    CHECK(RoundTrip(&scope, ObjectWithKey("a"), &out));
+    int64_t hits = marshaller->stats().shape_hits;
+    CHECK(RoundTrip(&scope, ObjectWithKey("a"), &out));
+    CHECK_EQ(hits + 1, marshaller->stats().shape_hits);
+    CHECK(RoundTrip(&scope, ObjectWithKey("b"), &out));
+    CHECK_EQ(hits + 1, marshaller->stats().shape_hits);
+}
+
+// Keys are spliced into a literal's source; none of them may break it.
+TEST(MarshalEscapesKeys)
+{
+    RuntimeScope scope;
+    const char *keys[] = {
+        "quote\"", "back\\slash", "new\nline", "nul", "tab\t", "\x1f",
+        "line\xe2\x80\xa8separator", "paragraph\xe2\x80\xa9separator", "\xe2\x80\xa8", "}); throw 1; ({"
+    };
+    std::string nul("a\0b", 3);
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        std::string key = strcmp(keys[i], "nul") == 0 ? nul : keys[i];
+        Variant value = ObjectWithKey(key);
+        Variant out;
+        CHECK(RoundTrip(&scope, value, &out));
+        CHECK(Same(value, out));
+    }
+}
+
+// "__proto__" is an own property like any other key, and leaves the
+// prototype alone, whether the object comes from a factory or not.
+TEST(MarshalKeepsProtoKeyOwn)
+{
+    RuntimeScope scope;
+    Variant value = Variant::Object();
+    Variant *proto = value.Set("__proto__");
+    *proto = Variant::Object();
+    *proto->Set("evil") = Variant(1.0);
+    *value.Set("name") = Variant("n");
+    Variant out;
+    CHECK(RoundTrip(&scope, value, &out));
+    CHECK(Same(value, out));
+    CHECK(scope.Eval("Object.getPrototypeOf(value) === Object.prototype && value.evil === undefined")->IsTrue());
+    CHECK(scope.Eval("Object.keys(value).join() === '__proto__,name'")->IsTrue());
+}
+
+TEST(MarshalRefusesUnsendableValues)
+{
+    RuntimeScope scope;
+    Marshaller *marshaller = scope.runtime()->marshaller();
+    Variant out;
+    CHECK(!marshaller->FromV8(scope.Eval("({ f: function () {} })"), &out));
+    CHECK(strstr(marshaller->error(), "functions") != NULL);
+    CHECK(!marshaller->FromV8(scope.Eval("var a = {}; a.self = a; a"), &out));
+    CHECK(strstr(marshaller->error(), "cyclic") != NULL);
+    CHECK(!marshaller->FromV8(scope.Eval("var d = []; for (var i = 0; i < 200; i++) { d = [d]; } d"), &out));
+    CHECK(strstr(marshaller->error(), "deeply") != NULL);
+    // A getter that throws leaves the exception to the caller.
+    v8::TryCatch try_catch;
+    CHECK(!marshaller->FromV8(scope.Eval("({ get x() { throw 1; } })"), &out));
+    CHECK(marshaller->error() == NULL);
+    CHECK(try_catch.HasCaught());
+}
@@ -0,0 +1,167 @@
+//
+//  test-recorder.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "cctest.h"
+#include "recorder.h"
+
+using zb::Record;
+using zb::Recorder;
+using zb::TraceReader;
+using zb::Variant;
+
+namespace {
+    std::string TempPath(const char *name)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "/tmp/zb_cctest_%d_%s", static_cast<int>(getpid()), name);
+        return path;
+    }
+    
+    std::string ReadAll(const std::string &path)
+    {
+        std::string data;
+        FILE *file = fopen(path.c_str(), "rb");
+        CHECK(file != NULL);
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.append(buffer, read);
+        }
+        fclose(file);
+        return data;
+    }
+    
+    void WriteAll(const std::string &path, const std::string &data)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        CHECK(file != NULL);
+        CHECK_EQ(data.size(), fwrite(data.data(), 1, data.size(), file));
+        fclose(file);
+    }
+    
+    // One record of each kind the host side produces, without a runtime.
+    void RecordSample()
+    {
+        Recorder::RecordRun(Record::kRun, "Log(1)", 6);
+        Variant argument = Variant::Object();
+        *argument.Set("k") = Variant("v");
+        Recorder::RecordCall("handle", &argument, true);
+        zb::Event events[2];
+        memset(events, 0, sizeof(events));
+        events[0].type = zb::Event::kTouchBegan;
+        events[0].x = 3;
+        events[1].type = zb::Event::kTouchMoved;
+        events[1].pointer = 2;
+        Recorder::RecordEvents(events, 2);
+        Recorder::RecordTime(Record::kIdle, 0.004);
+        Recorder::RecordRunFile("/bundle.js", 77);
+        Recorder::RecordInput(Record::kLowMemory);
+    }
+    
+    // Reads the trace until Next stops; returns how many records it gave.
+    int ReadRecords(const std::string &path, std::vector<Record> *records, const char **error)
+    {
+        TraceReader reader;
+        if (!reader.Open(path.c_str())) {
+            *error = reader.error();
+            return -1;
+        }
+        Record record;
+        while (reader.Next(&record)) {
+            records->push_back(record);
+        }
+        *error = reader.error();
+        return static_cast<int>(records->size());
+    }
+}
+
+TEST(TraceReadsBackRecords)
+{
+    std::string path = TempPath("full.zbr");
+    CHECK(Recorder::Start(path.c_str()));
+    RecordSample();
+    Recorder::Stop();
+    
+    std::vector<Record> records;
+    const char *error;
+    CHECK_EQ(6, ReadRecords(path, &records, &error));
+    CHECK(error == NULL);
+    CHECK_EQ(Record::kRun, records[0].type);
+    CHECK(records[0].text == "Log(1)");
+    CHECK_EQ(Record::kCall, records[1].type);
+    CHECK(records[1].text == "handle" && records[1].flag);
+    CHECK(records[1].argument.Get("k") != NULL && records[1].argument.Get("k")->string() == "v");
+    CHECK_EQ(Record::kEvents, records[2].type);
+    CHECK_EQ(2u, records[2].events.size());
+    CHECK_EQ(zb::Event::kTouchMoved, records[2].events[1].type);
+    CHECK_EQ(2, records[2].events[1].pointer);
+    CHECK_EQ(3.0f, records[2].events[0].x);
+    CHECK_EQ(Record::kIdle, records[3].type);
+    CHECK(records[3].value > 0.0039 && records[3].value < 0.0041);
+    CHECK_EQ(Record::kRunFile, records[4].type);
+    CHECK(records[4].text == "/bundle.js" && records[4].hash == 77);
+    CHECK_EQ(Record::kLowMemory, records[5].type);
+    for (size_t i = 1; i < records.size(); i++) {
+        CHECK(records[i].time >= records[i - 1].time);
+    }
+    unlink(path.c_str());
+}
+
+// Cut anywhere, a trace gives back the records that fit whole and then
+// reports itself truncated; cut inside the header it does not open.
+TEST(TraceReadsBackTruncatedFiles)
+{
+    std::string path = TempPath("cut.zbr");
+    CHECK(Recorder::Start(path.c_str()));
+    RecordSample();
+    Recorder::Stop();
+    std::string data = ReadAll(path);
+    
+    std::vector<Record> full;
+    const char *error;
+    CHECK_EQ(6, ReadRecords(path, &full, &error));
+    const size_t kHeader = 4 + 4 + 8;
+    int previous = 0;
+    for (size_t length = 0; length < data.size(); length++) {
+        WriteAll(path, data.substr(0, length));
+        std::vector<Record> records;
+        int count = ReadRecords(path, &records, &error);
+        if (length < kHeader) {
+            CHECK_EQ(-1, count);
+            CHECK(error != NULL);
+            continue;
+        }
+        CHECK(count >= previous && count < 6);
+        for (int i = 0; i < count; i++) {
+            CHECK_EQ(full[i].type, records[i].type);
+            CHECK(full[i].text == records[i].text);
+        }
+        // Only a cut right between records reads as a clean end.
+        CHECK(error != NULL || length == kHeader || count > previous);
+        previous = count;
+    }
+    unlink(path.c_str());
+}
+
+TEST(TraceRejectsOtherFiles)
+{
+    std::string path = TempPath("other.zbr");
+    WriteAll(path, "ZBRX0000000000000000");
+    TraceReader reader;
+    CHECK(!reader.Open(path.c_str()));
+    CHECK(reader.error() != NULL);
+    unlink(path.c_str());
+    TraceReader missing;
+    CHECK(!missing.Open(path.c_str()));
+}
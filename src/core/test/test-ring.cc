@@ -0,0 +1,136 @@
+//
+//  test-ring.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <thread>
+#include <vector>
+
+#include "cctest.h"
+#include "ring.h"
+
+using zb::MpscRing;
+using zb::SpscRing;
+
+TEST(SpscRoundsCapacityUp)
+{
+    SpscRing<int> ring(5);
+    CHECK_EQ(8u, ring.capacity());
+    for (int i = 0; i < 8; i++) {
+        CHECK(ring.Push(i));
+    }
+    CHECK(!ring.Push(8));
+    CHECK_EQ(8u, ring.size());
+}
+
+// Keeps the ring nearly full while the indices run many times round it.
+TEST(SpscWrapsAround)
+{
+    SpscRing<int> ring(4);
+    int next_in = 0;
+    int next_out = 0;
+    for (int i = 0; i < 3; i++) {
+        CHECK(ring.Push(next_in++));
+    }
+    for (int round = 0; round < 1000; round++) {
+        CHECK(ring.Push(next_in++));
+        CHECK(!ring.Push(-1));
+        int item = -1;
+        CHECK(ring.Pop(&item));
+        CHECK_EQ(next_out++, item);
+        CHECK_EQ(3u, ring.size());
+    }
+    int item = -1;
+    while (ring.Pop(&item)) {
+        CHECK_EQ(next_out++, item);
+    }
+    CHECK_EQ(next_in, next_out);
+    CHECK(!ring.Pop(&item));
+}
+
+TEST(SpscAcrossThreads)
+{
+    const int kItems = 200000;
+    SpscRing<int> ring(64);
+    std::thread producer([&ring] {
+        for (int i = 0; i < kItems; i++) {
+            while (!ring.Push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (int expected = 0; expected < kItems;) {
+        int item = -1;
+        if (ring.Pop(&item)) {
+            CHECK_EQ(expected, item);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK_EQ(0u, ring.size());
+}
+
+TEST(MpscWrapsAround)
+{
+    MpscRing<int> ring(3);
+    CHECK_EQ(4u, ring.capacity());
+    int next_in = 0;
+    int next_out = 0;
+    for (int round = 0; round < 1000; round++) {
+        while (ring.Push(next_in)) {
+            next_in++;
+        }
+        CHECK_EQ(4u, ring.size());
+        int item = -1;
+        for (int i = 0; i < 1 + round % 4; i++) {
+            CHECK(ring.Pop(&item));
+            CHECK_EQ(next_out++, item);
+        }
+    }
+    int item = -1;
+    while (ring.Pop(&item)) {
+        CHECK_EQ(next_out++, item);
+    }
+    CHECK_EQ(next_in, next_out);
+}
+
+// Every item arrives once, and each producer's items in the order it
+// pushed them.
+TEST(MpscAcrossThreads)
+{
+    const int kProducers = 4;
+    const int kItems = 50000;
+    MpscRing<int> ring(128);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.push_back(std::thread([&ring, p] {
+            for (int i = 0; i < kItems; i++) {
+                while (!ring.Push(p * kItems + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    std::vector<int> next(kProducers, 0);
+    for (int received = 0; received < kProducers * kItems;) {
+        int item = -1;
+        if (!ring.Pop(&item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int producer = item / kItems;
+        CHECK(producer >= 0 && producer < kProducers);
+        CHECK_EQ(next[producer], item % kItems);
+        next[producer]++;
+        received++;
+    }
+    for (size_t i = 0; i < producers.size(); i++) {
+        producers[i].join();
+    }
+    CHECK_EQ(0u, ring.size());
+}
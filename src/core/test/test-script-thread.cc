@@ -0,0 +1,49 @@
+//
+//  test-script-thread.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "script_thread.h"
+
+using zb::MemoryBackend;
+using zb::ScriptThread;
+
+namespace {
+    // Far more commands than the ring holds, with nothing draining until
+    // Stop.
+    const char kManyViews[] =
+        "var keep = [];"
+        "for (var i = 0; i < 200; i++) {"
+        "    var view = new View();"
+        "    view.x = i;"
+        "    keep.push(view);"
+        "}";
+}
+
+TEST(StopDrainsAFullCommandRing)
+{
+    MemoryBackend backend(NULL);
+    ScriptThread thread(8);
+    thread.Start();
+    thread.Post(kManyViews);
+    thread.Stop(&backend);
+    CHECK_EQ(200, backend.stats().created);
+    CHECK(thread.command_stalls() > 0);
+}
+
+TEST(StopWithoutATargetDiscards)
+{
+    ScriptThread thread(8);
+    thread.Start();
+    thread.Post(kManyViews);
+    thread.Stop();
+    CHECK(thread.command_stalls() > 0);
+    CHECK(thread.IsIdle());
+}
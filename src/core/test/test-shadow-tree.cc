@@ -0,0 +1,174 @@
+//
+//  test-shadow-tree.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string>
+#include <vector>
+
+#include "cctest.h"
+#include "binding.h"
+#include "memory_backend.h"
+#include "runtime.h"
+#include "shadow_tree.h"
+#include "view.h"
+
+using zb::MemoryView;
+using zb::ShadowNode;
+using zb::ShadowTree;
+
+namespace {
+    // Keys of the root's children, and checks the native subviews are the
+    // children's natives in the same order.
+    std::string Children(RuntimeScope *scope)
+    {
+        const ShadowNode *root = scope->runtime()->shadow_tree()->root();
+        CHECK(root != NULL);
+        const MemoryView *native = static_cast<const MemoryView *>(root->native);
+        CHECK_EQ(root->children.size(), native->children.size());
+        std::string keys;
+        for (size_t i = 0; i < root->children.size(); i++) {
+            CHECK(native->children[i] == root->children[i]->native);
+            keys += (i > 0 ? "," : "") + root->children[i]->key;
+        }
+        return keys;
+    }
+    
+    std::vector<zb::NativeView> Natives(RuntimeScope *scope)
+    {
+        std::vector<zb::NativeView> natives;
+        const ShadowNode *root = scope->runtime()->shadow_tree()->root();
+        for (size_t i = 0; i < root->children.size(); i++) {
+            natives.push_back(root->children[i]->native);
+        }
+        return natives;
+    }
+    
+    const ShadowTree::Stats &Stats(RuntimeScope *scope)
+    {
+        return scope->runtime()->shadow_tree()->stats();
+    }
+    
+    const char kRender[] =
+        "function render(keys) {"
+        "    Render({ key: 'root', width: 100, height: 100, children: keys.map(function (key, i) {"
+        "        return { key: key, y: i * 10, width: 100, height: 10 };"
+        "    }) });"
+        "}";
+}
+
+TEST(ShadowTreeInsertsAndRemovesKeyedChildren)
+{
+    RuntimeScope scope;
+    scope.Eval(kRender);
+    scope.Eval("render(['a', 'b', 'c'])");
+    CHECK(Children(&scope) == "a,b,c");
+    CHECK_EQ(4, Stats(&scope).created);
+    std::vector<zb::NativeView> before = Natives(&scope);
+    
+    scope.Eval("render(['a', 'x', 'b', 'c'])");
+    CHECK(Children(&scope) == "a,x,b,c");
+    CHECK_EQ(5, Stats(&scope).created);
+    std::vector<zb::NativeView> after = Natives(&scope);
+    CHECK(after[0] == before[0] && after[2] == before[1] && after[3] == before[2]);
+    
+    scope.Eval("render(['a', 'x', 'c'])");
+    CHECK(Children(&scope) == "a,x,c");
+    CHECK_EQ(1, Stats(&scope).removed);
+    CHECK_EQ(1, scope.backend()->stats().destroyed);
+    CHECK_EQ(5, scope.backend()->stats().created);
+}
+
+// Only the nodes that changed place are moved; all keep their views.
+TEST(ShadowTreeReordersKeyedChildren)
+{
+    RuntimeScope scope;
+    scope.Eval(kRender);
+    scope.Eval("render(['a', 'b', 'c', 'd'])");
+    std::vector<zb::NativeView> before = Natives(&scope);
+    
+    scope.Eval("render(['a', 'b', 'd', 'c'])");
+    CHECK(Children(&scope) == "a,b,d,c");
+    CHECK_EQ(1, Stats(&scope).moved);
+    
+    scope.Eval("render(['d', 'c', 'b', 'a'])");
+    CHECK(Children(&scope) == "d,c,b,a");
+    std::vector<zb::NativeView> after = Natives(&scope);
+    CHECK(after[0] == before[3] && after[1] == before[2] && after[2] == before[1] && after[3] == before[0]);
+    CHECK_EQ(5, Stats(&scope).created);
+    CHECK_EQ(0, Stats(&scope).removed);
+    CHECK_EQ(0, scope.backend()->stats().destroyed);
+}
+
+TEST(ShadowTreeReplacesANodeWhoseKeyChanged)
+{
+    RuntimeScope scope;
+    scope.Eval(kRender);
+    scope.Eval("render(['a', 'b'])");
+    std::vector<zb::NativeView> before = Natives(&scope);
+    scope.Eval("render(['a', 'z'])");
+    CHECK(Children(&scope) == "a,z");
+    std::vector<zb::NativeView> after = Natives(&scope);
+    CHECK(after[0] == before[0]);
+    CHECK(after[1] != before[1]);
+    CHECK_EQ(4, Stats(&scope).created);
+    CHECK_EQ(1, Stats(&scope).removed);
+    
+    // A new root key replaces the whole tree.
+    scope.Eval("Render({ key: 'other' })");
+    CHECK_EQ(5, Stats(&scope).created);
+    CHECK_EQ(4, Stats(&scope).removed);
+    CHECK_EQ(1, scope.backend()->live_views());
+}
+
+TEST(ShadowTreeMatchesUnkeyedChildrenByPosition)
+{
+    RuntimeScope scope;
+    scope.Eval("Render({ children: [{ width: 1 }, { width: 2 }, { width: 3 }] })");
+    std::vector<zb::NativeView> before = Natives(&scope);
+    int64_t updated = Stats(&scope).updated;
+    
+    scope.Eval("Render({ children: [{ width: 1 }, { width: 5 }, { width: 3 }] })");
+    CHECK(Natives(&scope) == before);
+    CHECK_EQ(updated + 1, Stats(&scope).updated);
+    CHECK_EQ(5.0f, static_cast<const MemoryView *>(before[1])->frame.width);
+    
+    scope.Eval("Render({ children: [{ width: 1 }, { width: 5 }] })");
+    CHECK_EQ(2u, Natives(&scope).size());
+    CHECK(Natives(&scope)[1] == before[1]);
+    CHECK_EQ(1, Stats(&scope).removed);
+}
+
+// A collected container could otherwise come back from the pool with the
+// same native view, which Render would take for the one it rendered into.
+TEST(ShadowTreeHoldsItsContainer)
+{
+    RuntimeScope scope;
+    scope.Eval("(function () { Render({ key: 'root' }, new View()); })()");
+    const MemoryView *root = static_cast<const MemoryView *>(scope.runtime()->shadow_tree()->root()->native);
+    const MemoryView *container = root->parent;
+    CHECK(container != NULL);
+    v8::V8::LowMemoryNotification();
+    scope.runtime()->finalizer()->Flush();
+    CHECK_EQ(0, scope.backend()->stats().recycled);
+    
+    const MemoryView *next;
+    {
+        v8::HandleScope handle_scope;
+        v8::Local<v8::Value> view = scope.Eval("var next = new View(); Render({ key: 'root' }, next); next");
+        next = static_cast<const MemoryView *>(zb::Unwrap<zb::View>(view->ToObject())->native());
+    }
+    CHECK(next != container);
+    CHECK(root->parent == next);
+    CHECK_EQ(1, Stats(&scope).moved);
+    
+    // Both are let go of once nothing is rendered into them.
+    scope.Eval("Render({ key: 'root' }); next = null;");
+    CHECK(root->parent == NULL);
+    v8::V8::LowMemoryNotification();
+    scope.runtime()->finalizer()->Flush();
+    CHECK_EQ(2, scope.backend()->stats().recycled);
+}
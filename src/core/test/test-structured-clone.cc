@@ -0,0 +1,118 @@
+//
+//  test-structured-clone.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "structured_clone.h"
+
+using zb::SerializedValue;
+
+namespace {
+    // Writes what |source| evaluates to and reads it back as the global
+    // "copy", next to the original as "value".
+    void Clone(RuntimeScope *scope, const char *source)
+    {
+        v8::Local<v8::Value> value = scope->Eval(source);
+        v8::Context::GetCurrent()->Global()->Set(v8::String::New("value"), value);
+        SerializedValue serialized;
+        CHECK(serialized.Write(value, v8::Handle<v8::Value>()));
+        CHECK(serialized.size() > 0);
+        v8::Context::GetCurrent()->Global()->Set(v8::String::New("copy"), serialized.Read());
+    }
+    
+    // write(value, transfer) for script. Write throws like postMessage
+    // does, and only a call from script hands the exception to a TryCatch.
+    v8::Handle<v8::Value> WriteCallback(const v8::Arguments &args)
+    {
+        SerializedValue serialized;
+        return v8::Boolean::New(serialized.Write(args[0], args[1]));
+    }
+    
+    void InstallWrite()
+    {
+        v8::Context::GetCurrent()->Global()->Set(v8::String::New("write"),
+                                                 v8::FunctionTemplate::New(WriteCallback)->GetFunction());
+    }
+}
+
+TEST(CloneRoundTrip)
+{
+    RuntimeScope scope;
+    Clone(&scope, "({ a: [1, -2.5, 'caf\\u00e9', null, undefined, true], d: new Date(1000), o: { nested: { deep: 'x' } } })");
+    CHECK(scope.Eval("copy !== value && JSON.stringify(copy) === JSON.stringify(value)")->IsTrue());
+    CHECK(scope.Eval("copy.d instanceof Date && copy.d.getTime() === 1000")->IsTrue());
+    CHECK(scope.Eval("copy.a.length === 6 && copy.a[4] === undefined && 4 in copy.a")->IsTrue());
+}
+
+// A value reached twice is copied twice; the copies are not shared.
+TEST(CloneKeepsSharedReferences)
+{
+    RuntimeScope scope;
+    Clone(&scope, "var shared = { n: 1 }, list = [shared]; ({ a: shared, b: shared, c: [list, list], d: list })");
+    CHECK(scope.Eval("copy.a.n === 1 && copy.a === copy.b && copy.a !== shared")->IsTrue());
+    CHECK(scope.Eval("copy.c[0] === copy.c[1] && copy.c[0] === copy.d && copy.d[0] === copy.a")->IsTrue());
+    
+    // A Buffer sent twice is copied, or moved, once.
+    Clone(&scope, "var b = new Buffer(2); [b, { b: b }]");
+    CHECK(scope.Eval("copy[0] === copy[1].b && copy[0] !== b")->IsTrue());
+    v8::Local<v8::Value> value = scope.Eval("var t = new Buffer(2); t[0] = 3; [t, t]");
+    SerializedValue serialized;
+    CHECK(serialized.Write(value, scope.Eval("[t]")));
+    v8::Context::GetCurrent()->Global()->Set(v8::String::New("moved"), serialized.Read());
+    CHECK(scope.Eval("moved[0] === moved[1] && moved[0][0] === 3 && t.length === 0")->IsTrue());
+}
+
+TEST(CloneCopiesBuffersUnlessTransferred)
+{
+    RuntimeScope scope;
+    Clone(&scope, "var b = new Buffer(3, 'int16'); b[0] = 7; b[2] = -9; b");
+    CHECK(scope.Eval("copy.length === 3 && copy[0] === 7 && copy[2] === -9 && value.length === 3")->IsTrue());
+    
+    v8::Local<v8::Value> buffer = scope.Eval("var t = new Buffer(2); t[1] = 0.5; t");
+    SerializedValue serialized;
+    CHECK(serialized.Write(buffer, scope.Eval("[t]")));
+    CHECK(scope.Eval("t.length === 0")->IsTrue());
+    v8::Context::GetCurrent()->Global()->Set(v8::String::New("moved"), serialized.Read());
+    CHECK(scope.Eval("moved.length === 2 && moved[1] === 0.5")->IsTrue());
+}
+
+TEST(CloneRefusesUnsendableValues)
+{
+    RuntimeScope scope;
+    InstallWrite();
+    const char *sources[] = {
+        "write(function () {})",
+        "var c = []; c.push(c); write(c)",
+        "write({ deep: { f: Math.max } })",
+        "write(new Buffer(1), {})",
+        "write(1, [{}])",
+        "var twice = new Buffer(1); write([twice, twice], [twice, twice])"
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        v8::TryCatch try_catch;
+        scope.Eval(sources[i]);
+        CHECK(try_catch.HasCaught());
+        CHECK(try_catch.Exception()->IsObject());
+    }
+    // Nothing is moved when the write fails.
+    CHECK(scope.Eval("var kept = new Buffer(4);"
+                     "try { write([kept, function () {}], [kept]); } catch (e) {}"
+                     "kept.length === 4")->IsTrue());
+}
+
+// The point of the format: what one isolate wrote another one reads.
+TEST(CloneAcrossIsolates)
+{
+    SerializedValue serialized;
+    {
+        RuntimeScope sender;
+        CHECK(serialized.Write(sender.Eval("({ list: [1, 2, 3], text: 'hi' })"), v8::Handle<v8::Value>()));
+    }
+    RuntimeScope receiver;
+    v8::Context::GetCurrent()->Global()->Set(v8::String::New("copy"), serialized.Read());
+    CHECK(receiver.Eval("copy.list.join() === '1,2,3' && copy.text === 'hi'")->IsTrue());
+}
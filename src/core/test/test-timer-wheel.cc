@@ -0,0 +1,152 @@
+//
+//  test-timer-wheel.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <vector>
+
+#include "cctest.h"
+#include "timer_wheel.h"
+
+using zb::TimerWheel;
+
+namespace {
+    struct TestTimer : public TimerWheel::Timer {
+        uint64_t due;
+    };
+    
+    const uint64_t kLevel1 = 64;
+    const uint64_t kLevel2 = 64 * 64;
+    const uint64_t kLevel3 = 64 * 64 * 64;
+    const uint64_t kRange = kLevel3 * 64;
+    
+    // Advances one tick at a time and returns the tick |timer| fired on.
+    uint64_t StepUntilFired(TimerWheel *wheel, TestTimer *timer, uint64_t limit)
+    {
+        std::vector<TimerWheel::Timer *> expired;
+        while (wheel->now() < limit) {
+            wheel->Advance(wheel->now() + 1, &expired);
+            for (size_t i = 0; i < expired.size(); i++) {
+                if (expired[i] == timer) {
+                    return wheel->now();
+                }
+            }
+            expired.clear();
+        }
+        return 0;
+    }
+}
+
+TEST(FiresOnItsTick)
+{
+    TimerWheel wheel(1000);
+    TestTimer timer;
+    wheel.Add(&timer, 1010);
+    CHECK(timer.scheduled());
+    CHECK_EQ(1010u, StepUntilFired(&wheel, &timer, 2000));
+    CHECK(!timer.scheduled());
+    CHECK_EQ(0u, wheel.size());
+}
+
+TEST(PastExpiryBecomesNextTick)
+{
+    TimerWheel wheel(500);
+    TestTimer timer;
+    wheel.Add(&timer, 100);
+    CHECK_EQ(501u, timer.expiry);
+    CHECK_EQ(501u, StepUntilFired(&wheel, &timer, 600));
+}
+
+// Timers filed on each coarser level are moved down as the wheel turns
+// and still fire exactly when due, stepping tick by tick.
+TEST(CascadesDownEveryLevel)
+{
+    const uint64_t start = 12345;
+    const uint64_t delays[] = { 63, kLevel1, kLevel1 + 7, kLevel2 - 1, kLevel2 + 130, kLevel3 + 4100 };
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        TimerWheel wheel(start);
+        TestTimer timer;
+        wheel.Add(&timer, start + delays[i]);
+        CHECK_EQ(start + delays[i], StepUntilFired(&wheel, &timer, start + delays[i] + 1));
+    }
+}
+
+// Past the last level the timer is parked and filed again when its slot
+// comes round; jumping straight over it still returns it once.
+TEST(ParksDelaysPastTheRange)
+{
+    TimerWheel wheel(7);
+    TestTimer timer;
+    uint64_t due = 7 + kRange + 12345;
+    wheel.Add(&timer, due);
+    std::vector<TimerWheel::Timer *> expired;
+    wheel.Advance(due - 1, &expired);
+    CHECK(expired.empty());
+    CHECK(timer.scheduled());
+    wheel.Advance(due, &expired);
+    CHECK_EQ(1u, expired.size());
+    CHECK(expired[0] == &timer);
+}
+
+TEST(RemoveUnschedules)
+{
+    TimerWheel wheel;
+    TestTimer kept;
+    TestTimer removed;
+    wheel.Add(&kept, kLevel2 + 3);
+    wheel.Add(&removed, kLevel2 + 3);
+    wheel.Remove(&removed);
+    CHECK(!removed.scheduled());
+    CHECK_EQ(1u, wheel.size());
+    std::vector<TimerWheel::Timer *> expired;
+    wheel.Advance(kLevel3, &expired);
+    CHECK_EQ(1u, expired.size());
+    CHECK(expired[0] == &kept);
+}
+
+TEST(NextExpiryIsALowerBound)
+{
+    TimerWheel wheel(100);
+    CHECK_EQ(UINT64_MAX, wheel.NextExpiry());
+    TestTimer near;
+    TestTimer far;
+    wheel.Add(&far, 100 + kLevel2 + 50);
+    CHECK(wheel.NextExpiry() <= far.expiry);
+    CHECK(wheel.NextExpiry() > 100);
+    wheel.Add(&near, 140);
+    CHECK_EQ(140u, wheel.NextExpiry());
+}
+
+// Random timers, advanced in random jumps: each comes back once, in the
+// first Advance that passes its expiry, and each batch is in expiry order.
+TEST(RandomJumpsMatchExpiries)
+{
+    srand(42);
+    const int kTimers = 2000;
+    std::vector<TestTimer> timers(kTimers);
+    TimerWheel wheel(rand() % 1000);
+    for (int i = 0; i < kTimers; i++) {
+        uint64_t delay = static_cast<uint64_t>(rand()) % (i % 4 == 0 ? kLevel3 * 2 : kLevel2);
+        timers[i].due = wheel.now() + 1 + delay;
+        wheel.Add(&timers[i], timers[i].due);
+    }
+    std::vector<TimerWheel::Timer *> expired;
+    size_t fired = 0;
+    while (wheel.size() > 0) {
+        uint64_t before = wheel.now();
+        uint64_t now = before + 1 + static_cast<uint64_t>(rand()) % (kLevel1 * 5);
+        expired.clear();
+        wheel.Advance(now, &expired);
+        for (size_t i = 0; i < expired.size(); i++) {
+            TestTimer *timer = static_cast<TestTimer *>(expired[i]);
+            CHECK(timer->due > before && timer->due <= now);
+            CHECK(i == 0 || static_cast<TestTimer *>(expired[i - 1])->due <= timer->due);
+        }
+        fired += expired.size();
+    }
+    CHECK_EQ(static_cast<size_t>(kTimers), fired);
+}
@@ -0,0 +1,85 @@
+//
+//  test-view-pool.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "runtime.h"
+#include "view.h"
+
+using zb::View;
+using zb::WrapperPool;
+
+namespace {
+    // Collects the views scripts let go of and files them in the pool.
+    void Collect(RuntimeScope *scope)
+    {
+        v8::V8::LowMemoryNotification();
+        scope->runtime()->finalizer()->Flush();
+    }
+}
+
+TEST(ViewPoolReusesDeadWrappers)
+{
+    RuntimeScope scope;
+    WrapperPool<View> *pool = scope.runtime()->view_pool();
+    scope.Eval("(function () { for (var i = 0; i < 10; i++) { var view = new View(); view.x = 5; view.alpha = 0.5; } })()");
+    CHECK_EQ(10, pool->stats().misses);
+    Collect(&scope);
+    CHECK_EQ(10u, pool->size());
+
+    scope.Eval("var views = []; for (var i = 0; i < 10; i++) { views.push(new View()); }");
+    CHECK_EQ(10, pool->stats().hits);
+    CHECK_EQ(10, pool->stats().misses);
+    CHECK_EQ(0u, pool->size());
+    // No new natives, and the geometry starts over.
+    CHECK_EQ(10, scope.backend()->live_views());
+    CHECK(scope.Eval("views.every(function (view) { return view.x === 0 && view.alpha === 1; })")->IsTrue());
+}
+
+TEST(ViewPoolEvictsOverBudget)
+{
+    RuntimeScope scope;
+    WrapperPool<View> *pool = scope.runtime()->view_pool();
+    pool->set_budget(4);
+    scope.Eval("(function () { for (var i = 0; i < 10; i++) { new View(); } })()");
+    Collect(&scope);
+    CHECK_EQ(4u, pool->size());
+    CHECK_EQ(6, pool->stats().evictions);
+    CHECK_EQ(4, scope.backend()->live_views());
+
+    // Shrinking the budget lets go of what no longer fits.
+    pool->set_budget(1);
+    CHECK_EQ(1u, pool->size());
+    CHECK_EQ(9, pool->stats().evictions);
+    CHECK_EQ(1, scope.backend()->live_views());
+}
+
+// Wrappers scripts reshaped are not handed out again.
+TEST(ViewPoolRejectsReshapedWrappers)
+{
+    RuntimeScope scope;
+    WrapperPool<View> *pool = scope.runtime()->view_pool();
+    scope.Eval(
+        "var kept = [new View(), new View(), new View(), new View(), new View()];\n"
+        "kept[0].label = 'extra';\n"
+        "Object.preventExtensions(kept[1]);\n"
+        "kept[2].__proto__ = {};\n"
+        "kept[3][0] = 'indexed';\n"
+        "Object.defineProperty(kept[4], 'x', { get: function () { return 1; } });\n"
+        "kept = null;");
+    Collect(&scope);
+    CHECK_EQ(5u, pool->size());
+
+    scope.Eval("var view = new View();");
+    CHECK_EQ(0, pool->stats().hits);
+    CHECK_EQ(5, pool->stats().rejections);
+    CHECK_EQ(6, pool->stats().misses);
+    CHECK_EQ(0u, pool->size());
+    CHECK_EQ(1, scope.backend()->live_views());
+    CHECK(scope.Eval("view.x === 0 && !('label' in view) && Object.isExtensible(view) && !(0 in view)")->IsTrue());
+}
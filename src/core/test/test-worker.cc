@@ -0,0 +1,28 @@
+//
+//  test-worker.cc
+//  zb
+//
+//  Created by  on 12/03/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "cctest.h"
+#include "memory_backend.h"
+#include "runtime.h"
+
+// Every Worker object is on the runtime's books until the collector or
+// the runtime deletes it; terminating one does not take it off.
+TEST(WorkerObjectsStayOnTheRuntimesBooks)
+{
+    RuntimeScope scope;
+    std::set<zb::Worker *> *workers = scope.runtime()->worker_objects();
+    scope.Eval("var kept = new Worker(''); (function () { new Worker('').terminate(); })();");
+    CHECK_EQ(2u, workers->size());
+
+    v8::V8::LowMemoryNotification();
+    CHECK_EQ(1u, workers->size());
+    // The running one is held by the runtime and left for its destructor.
+    scope.Eval("kept = null;");
+    v8::V8::LowMemoryNotification();
+    CHECK_EQ(1u, workers->size());
+}
@@ -0,0 +1,208 @@
+//
+//  mksnapshot.cc
+//  zb
+//
+//  Created by  on 12/03/06.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Builds V8's startup snapshot with the bridge's JS framework already
+//  evaluated in the snapshotted context:
+//
+//    zb_mksnapshot [v8 flags] snapshot.cc framework.js ...
+//
+//  Link the generated file in place of V8's snapshot.cc and every context
+//  the runtime creates starts with the framework's globals deserialized
+//  instead of compiling and running it again. Native templates (View, Log,
+//  Geometry) cannot be serialized; the runtime's global template still
+//  installs them on the new global, next to the transferred framework.
+//
+//  The sinks follow libs/v8/src/mksnapshot.cc, which is
+//  Copyright 2006-2008 the V8 project authors and BSD licensed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "v8.h"
+
+#include "bootstrapper.h"
+#include "natives.h"
+#include "platform.h"
+#include "serialize.h"
+#include "list.h"
+
+using namespace v8;
+
+// Name of the hidden global listing the framework files in the snapshot;
+// Runtime::Bootstrap reads it back to skip them.
+static const char kPreloadedName[] = "__zbPreloaded__";
+
+class PartialSnapshotSink : public i::SnapshotByteSink {
+public:
+    PartialSnapshotSink() : data_() { }
+    virtual ~PartialSnapshotSink() { data_.Free(); }
+    virtual void Put(int byte, const char* description) { data_.Add(byte); }
+    virtual int Position() { return data_.length(); }
+    void Print(FILE* fp)
+    {
+        int length = Position();
+        for (int j = 0; j < length; j++) {
+            if ((j & 0x1f) == 0x1f) {
+                fprintf(fp, "\n");
+            }
+            if (j != 0) {
+                fprintf(fp, ",");
+            }
+            fprintf(fp, "%u", static_cast<unsigned char>(data_[j]));
+        }
+    }
+
+private:
+    i::List<char> data_;
+};
+
+class CppByteSink : public PartialSnapshotSink {
+public:
+    explicit CppByteSink(const char* snapshot_file)
+    {
+        fp_ = i::OS::FOpen(snapshot_file, "wb");
+        if (fp_ == NULL) {
+            fprintf(stderr, "Unable to write to snapshot file \"%s\"\n", snapshot_file);
+            exit(1);
+        }
+        fprintf(fp_, "// Autogenerated by zb_mksnapshot. Do not edit.\n\n");
+        fprintf(fp_, "#include \"v8.h\"\n");
+        fprintf(fp_, "#include \"platform.h\"\n\n");
+        fprintf(fp_, "#include \"snapshot.h\"\n\n");
+        fprintf(fp_, "namespace v8 {\nnamespace internal {\n\n");
+        fprintf(fp_, "const byte Snapshot::data_[] = {");
+    }
+
+    virtual ~CppByteSink()
+    {
+        fprintf(fp_, "const int Snapshot::size_ = %d;\n", Position());
+        fprintf(fp_, "const byte* Snapshot::raw_data_ = Snapshot::data_;\n");
+        fprintf(fp_, "const int Snapshot::raw_size_ = Snapshot::size_;\n\n");
+        fprintf(fp_, "} }  // namespace v8::internal\n");
+        fclose(fp_);
+    }
+
+    void WriteSpaceUsed(i::PartialSerializer *ser)
+    {
+        fprintf(fp_, "const int Snapshot::new_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::NEW_SPACE));
+        fprintf(fp_, "const int Snapshot::pointer_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::OLD_POINTER_SPACE));
+        fprintf(fp_, "const int Snapshot::data_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::OLD_DATA_SPACE));
+        fprintf(fp_, "const int Snapshot::code_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::CODE_SPACE));
+        fprintf(fp_, "const int Snapshot::map_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::MAP_SPACE));
+        fprintf(fp_, "const int Snapshot::cell_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::CELL_SPACE));
+        fprintf(fp_, "const int Snapshot::large_space_used_ = %d;\n", ser->CurrentAllocationAddress(i::LO_SPACE));
+    }
+
+    void WritePartialSnapshot()
+    {
+        fprintf(fp_, "};\n\n");
+        fprintf(fp_, "const int Snapshot::context_size_ = %d;\n", partial_sink_.Position());
+        fprintf(fp_, "const int Snapshot::context_raw_size_ = Snapshot::context_size_;\n");
+        fprintf(fp_, "const byte Snapshot::context_data_[] = {\n");
+        partial_sink_.Print(fp_);
+        fprintf(fp_, "};\n\n");
+        fprintf(fp_, "const byte* Snapshot::context_raw_data_ = Snapshot::context_data_;\n");
+    }
+
+    void WriteSnapshot() { Print(fp_); }
+    PartialSnapshotSink* partial_sink() { return &partial_sink_; }
+
+private:
+    FILE* fp_;
+    PartialSnapshotSink partial_sink_;
+};
+
+static bool ReadFile(const char *name, std::string *out)
+{
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out->append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+static const char *BaseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Evaluates the framework files in order and records their names, so a
+// runtime built on this snapshot knows which bootstrap scripts to skip.
+static bool Preload(Handle<Context> context, int count, char **files)
+{
+    HandleScope handle_scope;
+    Context::Scope context_scope(context);
+    Local<Array> preloaded = Array::New(count);
+    for (int i = 0; i < count; i++) {
+        std::string source;
+        if (!ReadFile(files[i], &source)) {
+            fprintf(stderr, "Error reading '%s'\n", files[i]);
+            return false;
+        }
+        TryCatch try_catch;
+        Handle<Script> script = Script::Compile(String::New(source.data(), static_cast<int>(source.size())), String::New(files[i]));
+        if (script.IsEmpty() || script->Run().IsEmpty()) {
+            String::Utf8Value exception(try_catch.Exception());
+            fprintf(stderr, "%s: %s\n", files[i], *exception ? *exception : "<string conversion failed>");
+            return false;
+        }
+        preloaded->Set(i, String::New(BaseName(files[i])));
+    }
+    context->Global()->Set(String::NewSymbol(kPreloadedName), preloaded, DontEnum);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    i::FLAG_log_code = true;
+
+    int result = i::FlagList::SetFlagsFromCommandLine(&argc, argv, true);
+    if (result > 0 || argc < 2 || i::FLAG_help) {
+        printf("Usage: %s [flag] ... outfile [framework.js ...]\n", argv[0]);
+        i::FlagList::PrintHelp();
+        return !i::FLAG_help;
+    }
+    i::Serializer::Enable();
+    Persistent<Context> context = Context::New();
+    ASSERT(!context.IsEmpty());
+    if (!Preload(context, argc - 2, argv + 2)) {
+        return 1;
+    }
+    { HandleScope scope;
+        for (int i = 0; i < i::Natives::GetBuiltinsCount(); i++) {
+            i::Isolate::Current()->bootstrapper()->NativesSourceLookup(i);
+        }
+    }
+    // Drop the compilation cache and anything else only the tool kept alive
+    // before the context is walked.
+    HEAP->CollectAllGarbage(i::Heap::kNoGCFlags, "zb_mksnapshot");
+    i::Object* raw_context = *(v8::Utils::OpenHandle(*context));
+    context.Dispose();
+    CppByteSink sink(argv[1]);
+    i::StartupSerializer ser(&sink);
+    ser.SerializeStrongReferences();
+
+    i::PartialSerializer partial_ser(&ser, sink.partial_sink());
+    partial_ser.Serialize(&raw_context);
+
+    ser.SerializeWeakReferences();
+
+    sink.WriteSnapshot();
+    sink.WritePartialSnapshot();
+    sink.WriteSpaceUsed(&partial_ser);
+    return 0;
+}
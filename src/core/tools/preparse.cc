@@ -0,0 +1,91 @@
+//
+//  preparse.cc
+//  zb
+//
+//  Created by  on 12/03/18.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Writes V8 preparse data next to script bundles, for the runtime to pick
+//  up when it runs them:
+//
+//    zb_preparse [--check] bundle.js ...
+//
+//  Run it as a build step after the bundles are final; any later change to
+//  a bundle makes its data stale and the runtime then ignores it. Bundles
+//  too short for V8 to preparse are skipped. --check writes nothing and
+//  fails if any bundle's data is missing or stale.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <string>
+
+#include "v8.h"
+#include "preparse_data.h"
+
+static bool ReadFile(const char *name, std::string *out)
+{
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out->append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    v8::V8::SetFlagsFromCommandLine(&argc, argv, true);
+    bool check = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+        check = true;
+        first = 2;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [--check] bundle.js ...\n", argv[0]);
+        return 1;
+    }
+    v8::V8::Initialize();
+    int failures = 0;
+    for (int i = first; i < argc; i++) {
+        std::string source;
+        if (!ReadFile(argv[i], &source)) {
+            fprintf(stderr, "Error reading '%s'\n", argv[i]);
+            failures++;
+            continue;
+        }
+        if (source.size() < zb::PreparseData::kMinLength) {
+            printf("%s: too short, skipped\n", argv[i]);
+            continue;
+        }
+        std::string path = zb::PreparseData::PathFor(argv[i]);
+        if (check) {
+            std::unique_ptr<zb::PreparseData> data(zb::PreparseData::Load(path.c_str(), source.data(), source.size()));
+            if (data.get() == NULL) {
+                fprintf(stderr, "%s: missing or stale\n", path.c_str());
+                failures++;
+            }
+            continue;
+        }
+        std::unique_ptr<zb::PreparseData> data(zb::PreparseData::Create(source.data(), source.size()));
+        if (data.get() == NULL) {
+            fprintf(stderr, "%s: syntax error\n", argv[i]);
+            failures++;
+            continue;
+        }
+        if (!data->Write(path.c_str())) {
+            fprintf(stderr, "Error writing '%s'\n", path.c_str());
+            failures++;
+            continue;
+        }
+        printf("%s: %zu bytes of preparse data for %zu bytes of source\n", path.c_str(), data->size(), source.size());
+    }
+    return failures > 0 ? 1 : 0;
+}
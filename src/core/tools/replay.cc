@@ -0,0 +1,356 @@
+//
+//  replay.cc
+//  zb
+//
+//  Created by  on 12/03/19.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+//  Runs a trace recorded by Recorder (zb_shell --record, or
+//  Zb::StartRecording on device) again, on the in-memory backend:
+//
+//    zb_replay [--csv] [--log-level=debug|info|warn|error] trace.zbr
+//
+//  The whole trace is read first, then its inputs run back to back, as
+//  fast as the runtime takes them. Timer runs, frames and the clock
+//  readings timers were scheduled from keep their recorded times, shifted
+//  by a whole number of milliseconds so they land on the same timer ticks.
+//  Files are run from their recorded paths; one whose contents changed
+//  since is reported, since the replay no longer measures the same code.
+//
+//  Reports how long the replay took, latency percentiles per kind of
+//  input, the time V8 spent in GC and, per binding, how many calls the
+//  recording and the replay made. Scripts that read Date or Math.random,
+//  or workers answering in another order, can make those diverge. --csv
+//  prints the same numbers as CSV, for comparing runs.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "v8.h"
+#include "log_channel.h"
+#include "memory_backend.h"
+#include "recorder.h"
+#include "runtime.h"
+#include "script_cache.h"
+#include "trace.h"
+
+// A recorded UTF-16 source; V8 deletes it with the string.
+class RecordedUTF16Source : public v8::String::ExternalStringResource {
+public:
+    explicit RecordedUTF16Source(const std::string &bytes) : data_(bytes.size() / sizeof(uint16_t))
+    {
+        memcpy(data_.data(), bytes.data(), data_.size() * sizeof(uint16_t));
+    }
+    virtual const uint16_t *data() const { return data_.data(); }
+    virtual size_t length() const { return data_.size(); }
+private:
+    std::vector<uint16_t> data_;
+};
+
+// Hands the runtime the recorded clock readings in order. Should the
+// replay read the clock more often than the recording did, later readings
+// fall back to the time of the input running.
+struct ReplayClock {
+    const std::vector<zb::Record> *records;
+    size_t next;
+    double base;
+    double current;
+
+    static double Now(void *data)
+    {
+        ReplayClock *clock = static_cast<ReplayClock *>(data);
+        const std::vector<zb::Record> &records = *clock->records;
+        while (clock->next < records.size() && records[clock->next].type != zb::Record::kClock) {
+            clock->next++;
+        }
+        if (clock->next == records.size()) {
+            return clock->current;
+        }
+        return clock->base + records[clock->next++].value;
+    }
+};
+
+struct InputStats {
+    const char *name;
+    std::vector<double> latencies;
+    double total;
+};
+
+static double gc_start = 0;
+static double gc_time = 0;
+static int gc_count = 0;
+
+static void OnGCPrologue(v8::GCType type, v8::GCCallbackFlags flags)
+{
+    gc_start = zb::Runtime::Now();
+}
+
+static void OnGCEpilogue(v8::GCType type, v8::GCCallbackFlags flags)
+{
+    gc_time += zb::Runtime::Now() - gc_start;
+    gc_count++;
+}
+
+static bool ParseLogLevel(const char *name, zb::LogChannel::Level *out)
+{
+    static const char *const kNames[] = { "debug", "info", "warn", "error" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, kNames[i]) == 0) {
+            *out = static_cast<zb::LogChannel::Level>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool HashFile(const char *path, uint64_t *hash)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    std::string source;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        source.append(buffer, read);
+    }
+    fclose(file);
+    *hash = zb::ScriptCache::Hash(source.data(), source.size());
+    return true;
+}
+
+// Exact, from the sorted samples.
+static double Percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(ceil(fraction * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(index, 1)) - 1];
+}
+
+int main(int argc, char *argv[])
+{
+    v8::V8::SetFlagsFromCommandLine(&argc, argv, true);
+    bool csv = false;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else if (strncmp(argv[i], "--log-level=", 12) == 0) {
+            zb::LogChannel::Level level;
+            if (!ParseLogLevel(argv[i] + 12, &level)) {
+                fprintf(stderr, "Unknown log level '%s'\n", argv[i] + 12);
+                return 1;
+            }
+            zb::LogChannel::Shared()->set_level(level);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s [--csv] [--log-level=debug|info|warn|error] trace.zbr\n", argv[0]);
+        return 1;
+    }
+
+    zb::TraceReader reader;
+    if (!reader.Open(path)) {
+        fprintf(stderr, "%s: %s\n", path, reader.error());
+        return 1;
+    }
+    std::vector<zb::Record> records;
+    zb::Record record;
+    while (reader.Next(&record)) {
+        records.push_back(record);
+    }
+    if (reader.error() != NULL) {
+        fprintf(stderr, "%s: %s after %zu records; replaying those\n", path, reader.error(), records.size());
+    }
+
+    // Binding calls are counted through the tracer's histograms.
+    zb::Tracer::Enable();
+    zb::MemoryBackend backend;
+    zb::Runtime runtime(&backend);
+    {
+        v8::Locker locker(runtime.isolate());
+        v8::Isolate::Scope isolate_scope(runtime.isolate());
+        v8::V8::AddGCPrologueCallback(OnGCPrologue);
+        v8::V8::AddGCEpilogueCallback(OnGCEpilogue);
+    }
+    ReplayClock clock = { &records, 0, 0, 0 };
+    double shift = ceil((zb::Runtime::Now() - reader.start()) * 1000) / 1000;
+    clock.base = reader.start() + shift;
+    runtime.SetClock(ReplayClock::Now, &clock);
+
+    InputStats inputs[] = {
+        { "run", std::vector<double>(), 0 },
+        { "call", std::vector<double>(), 0 },
+        { "events", std::vector<double>(), 0 },
+        { "timers", std::vector<double>(), 0 },
+        { "frame", std::vector<double>(), 0 },
+        { "messages", std::vector<double>(), 0 },
+        { "idle", std::vector<double>(), 0 },
+        { "low memory", std::vector<double>(), 0 }
+    };
+    std::map<int, std::string> names;
+    std::map<int, int64_t> recorded;
+    int64_t bindings = 0;
+    int changed = 0;
+
+    double start = zb::Runtime::Now();
+    for (size_t i = 0; i < records.size(); i++) {
+        const zb::Record &input = records[i];
+        if (input.type == zb::Record::kBindingName) {
+            names[input.binding] = input.text;
+            continue;
+        }
+        if (input.type == zb::Record::kBinding) {
+            recorded[input.binding]++;
+            bindings++;
+            continue;
+        }
+        if (input.type == zb::Record::kClock) {
+            continue;
+        }
+        clock.current = clock.base + input.time;
+        double begin = zb::Runtime::Now();
+        InputStats *stats = NULL;
+        switch (input.type) {
+            case zb::Record::kRun:
+                runtime.Run(input.text.c_str());
+                stats = &inputs[0];
+                break;
+            case zb::Record::kRunUtf16:
+                runtime.Run(new RecordedUTF16Source(input.text));
+                stats = &inputs[0];
+                break;
+            case zb::Record::kRunFile: {
+                uint64_t hash;
+                if (!HashFile(input.text.c_str(), &hash) || hash != input.hash) {
+                    fprintf(stderr, "%s: missing or changed since the recording\n", input.text.c_str());
+                    changed++;
+                }
+                begin = zb::Runtime::Now();
+                runtime.RunFile(input.text.c_str());
+                stats = &inputs[0];
+                break;
+            }
+            case zb::Record::kCall: {
+                zb::Variant argument = input.argument;
+                zb::Variant result;
+                runtime.Call(input.text.c_str(), &argument, input.flag ? &result : NULL);
+                stats = &inputs[1];
+                break;
+            }
+            case zb::Record::kEvents:
+                runtime.DispatchEvents(input.events.data(), static_cast<int>(input.events.size()));
+                runtime.Commit();
+                stats = &inputs[2];
+                break;
+            case zb::Record::kTimers:
+                runtime.RunTimers(clock.base + input.value);
+                runtime.Commit();
+                stats = &inputs[3];
+                break;
+            case zb::Record::kFrame:
+                runtime.RunFrame(clock.base + input.value);
+                runtime.Commit();
+                stats = &inputs[4];
+                break;
+            case zb::Record::kMessages:
+                // Workers run on their own; wait for what they post.
+                while (runtime.DeliverWorkerMessages() == 0 && runtime.worker_inbox()->busy()) {
+                    std::this_thread::yield();
+                }
+                runtime.Commit();
+                stats = &inputs[5];
+                break;
+            case zb::Record::kIdle:
+                runtime.Idle(zb::Runtime::Now() + input.value);
+                stats = &inputs[6];
+                break;
+            case zb::Record::kLowMemory:
+                runtime.LowMemory();
+                stats = &inputs[7];
+                break;
+            default:
+                break;
+        }
+        if (stats != NULL) {
+            double latency = zb::Runtime::Now() - begin;
+            stats->latencies.push_back(latency);
+            stats->total += latency;
+        }
+    }
+    double elapsed = zb::Runtime::Now() - start;
+    zb::LogChannel::Shared()->Flush();
+
+    int64_t count = 0;
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        std::sort(inputs[i].latencies.begin(), inputs[i].latencies.end());
+        count += inputs[i].latencies.size();
+    }
+    int64_t replayed = 0;
+    for (std::map<int, std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+        replayed += zb::Tracer::Binding(it->second.c_str())->count();
+    }
+    double recorded_time = records.empty() ? 0 : records.back().time;
+
+    if (csv) {
+        printf("type,name,count,total_ms,p50_us,p90_us,p99_us,max_us\n");
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+            const std::vector<double> &latencies = inputs[i].latencies;
+            if (latencies.empty()) {
+                continue;
+            }
+            printf("input,%s,%zu,%.3f,%.1f,%.1f,%.1f,%.1f\n", inputs[i].name, latencies.size(), inputs[i].total * 1e3,
+                   Percentile(latencies, 0.5) * 1e6, Percentile(latencies, 0.9) * 1e6,
+                   Percentile(latencies, 0.99) * 1e6, latencies.back() * 1e6);
+        }
+        printf("total,inputs,%lld,%.3f,,,,\n", static_cast<long long>(count), elapsed * 1e3);
+        printf("gc,collections,%d,%.3f,,,,\n", gc_count, gc_time * 1e3);
+        for (std::map<int, std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+            printf("binding,%s,%lld,,,,,\n", it->second.c_str(), static_cast<long long>(zb::Tracer::Binding(it->second.c_str())->count()));
+        }
+        return changed > 0 ? 1 : 0;
+    }
+
+    printf("%s: %.2f s recorded, replayed in %.2f ms\n", path, recorded_time, elapsed * 1e3);
+    printf("%lld inputs (%.0f/s), %lld binding calls (%.0f/s)\n",
+           static_cast<long long>(count), count / elapsed, static_cast<long long>(replayed), replayed / elapsed);
+    printf("%-12s %8s %10s %9s %9s %9s %9s\n", "input", "count", "total ms", "p50 us", "p90 us", "p99 us", "max us");
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        const std::vector<double> &latencies = inputs[i].latencies;
+        if (latencies.empty()) {
+            continue;
+        }
+        printf("%-12s %8zu %10.3f %9.1f %9.1f %9.1f %9.1f\n", inputs[i].name, latencies.size(), inputs[i].total * 1e3,
+               Percentile(latencies, 0.5) * 1e6, Percentile(latencies, 0.9) * 1e6,
+               Percentile(latencies, 0.99) * 1e6, latencies.back() * 1e6);
+    }
+    printf("gc: %d collections, %.3f ms (%.1f%% of the replay)\n", gc_count, gc_time * 1e3, elapsed > 0 ? gc_time / elapsed * 100 : 0);
+    if (replayed == bindings) {
+        printf("bindings: %lld calls, as recorded\n", static_cast<long long>(bindings));
+    } else {
+        printf("bindings: %lld calls recorded, %lld replayed\n", static_cast<long long>(bindings), static_cast<long long>(replayed));
+        for (std::map<int, std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+            int64_t calls = zb::Tracer::Binding(it->second.c_str())->count();
+            if (calls != recorded[it->first]) {
+                printf("  %-24s %8lld recorded %8lld replayed\n", it->second.c_str(),
+                       static_cast<long long>(recorded[it->first]), static_cast<long long>(calls));
+            }
+        }
+    }
+    if (changed > 0) {
+        printf("%d files changed since the recording\n", changed);
+    }
+    return changed > 0 ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+# Platform-neutral bridge core. Builds against the vendored V8 so the
+# bridge can be run, profiled and benchmarked without UIKit. From the
+# repository root, with gyp fetched by `make -C libs/v8 dependencies`:
+#
+#   libs/v8/build/gyp/gyp --depth=. -Ilibs/v8/build/standalone.gypi \
+#       -Dtarget_arch=x64 src/core/zb.gyp
+#   make -C src/core
+#
+# Add -Dzb_use_snapshot=1 to link V8 against a startup snapshot that has
+# framework/*.js already evaluated (see tools/mksnapshot.cc).
+#
+# Unit tests are in test/, cctest style: out/Default/zb_cctest runs them
+# all, `zb_cctest test-ring` one file, `zb_cctest --list` names them.
+#
+{
+  'includes': ['../../libs/v8/build/common.gypi'],
+  'variables': {
+    'zb_use_snapshot%': 0,
+    'zb_framework_files': [
+      'framework/zb.js',
+    ],
+  },
+  'target_defaults': {
+    'include_dirs': [
+      '../../libs/v8/include',
+      'zb',
+    ],
+    # The script thread and its rings need C++11 atomics and threads; V8
+    # itself keeps building as C++98.
+    'cflags!': ['-ansi'],
+    'cflags_cc': ['-std=gnu++0x'],
+    'xcode_settings': {
+      'CLANG_CXX_LANGUAGE_STANDARD': 'gnu++0x',
+      'CLANG_CXX_LIBRARY': 'libc++',
+    },
+  },
+  'targets': [
+    {
+      'target_name': 'zb_core',
+      'type': 'static_library',
+      'conditions': [
+        ['zb_use_snapshot==1', {
+          'dependencies': [
+            '../../libs/v8/tools/gyp/v8.gyp:v8_base',
+            'zb_snapshot',
+          ],
+        }, {
+          'dependencies': [
+            '../../libs/v8/tools/gyp/v8.gyp:v8',
+          ],
+          'export_dependent_settings': [
+            '../../libs/v8/tools/gyp/v8.gyp:v8',
+          ],
+        }],
+      ],
+      'direct_dependent_settings': {
+        'include_dirs': [
+          '../../libs/v8/include',
+          'zb',
+        ],
+      },
+      'sources': [
+        'zb/animator.cc',
+        'zb/animator.h',
+        'zb/backend.h',
+        'zb/binding.h',
+        'zb/command_queue.cc',
+        'zb/command_queue.h',
+        'zb/event.h',
+        'zb/event_loop.cc',
+        'zb/event_loop.h',
+        'zb/finalization.cc',
+        'zb/finalization.h',
+        'zb/geometry.cc',
+        'zb/geometry.h',
+        'zb/invoke.cc',
+        'zb/invoke.h',
+        'zb/layout.cc',
+        'zb/layout.h',
+        'zb/log_channel.cc',
+        'zb/log_channel.h',
+        'zb/marshal.cc',
+        'zb/marshal.h',
+        'zb/mapped_source.cc',
+        'zb/mapped_source.h',
+        'zb/memory_backend.cc',
+        'zb/memory_backend.h',
+        'zb/preparse_data.cc',
+        'zb/preparse_data.h',
+        'zb/recorder.cc',
+        'zb/recorder.h',
+        'zb/ring.h',
+        'zb/runtime.cc',
+        'zb/runtime.h',
+        'zb/script_cache.cc',
+        'zb/script_cache.h',
+        'zb/script_thread.cc',
+        'zb/script_thread.h',
+        'zb/shadow_tree.cc',
+        'zb/shadow_tree.h',
+        'zb/structured_clone.cc',
+        'zb/structured_clone.h',
+        'zb/template_cache.cc',
+        'zb/template_cache.h',
+        'zb/timer_wheel.cc',
+        'zb/timer_wheel.h',
+        'zb/trace.cc',
+        'zb/trace.h',
+        'zb/transaction.cc',
+        'zb/transaction.h',
+        'zb/view.cc',
+        'zb/view.h',
+        'zb/worker.cc',
+        'zb/worker.h',
+        'zb/wrapper_pool.h',
+      ],
+    },
+    {
+      'target_name': 'zb_shell',
+      'type': 'executable',
+      'dependencies': [
+        'zb_core',
+      ],
+      'sources': [
+        'samples/shell.cc',
+      ],
+    },
+    {
+      'target_name': 'zb_bench',
+      'type': 'executable',
+      'dependencies': [
+        'zb_core',
+      ],
+      'sources': [
+        'benchmarks/bench.cc',
+      ],
+    },
+    {
+      'target_name': 'zb_preparse',
+      'type': 'executable',
+      'dependencies': [
+        'zb_core',
+      ],
+      'sources': [
+        'tools/preparse.cc',
+      ],
+    },
+    {
+      'target_name': 'zb_replay',
+      'type': 'executable',
+      'dependencies': [
+        'zb_core',
+      ],
+      'sources': [
+        'tools/replay.cc',
+      ],
+    },
+    {
+      'target_name': 'zb_cctest',
+      'type': 'executable',
+      'dependencies': [
+        'zb_core',
+      ],
+      'include_dirs': [
+        'test',
+      ],
+      'sources': [
+        'test/cctest.cc',
+        'test/cctest.h',
+        'test/test-animator.cc',
+        'test/test-event-loop.cc',
+        'test/test-finalization.cc',
+        'test/test-geometry.cc',
+        'test/test-layout.cc',
+        'test/test-log-channel.cc',
+        'test/test-marshal.cc',
+        'test/test-recorder.cc',
+        'test/test-ring.cc',
+        'test/test-script-thread.cc',
+        'test/test-shadow-tree.cc',
+        'test/test-structured-clone.cc',
+        'test/test-timer-wheel.cc',
+        'test/test-view-pool.cc',
+        'test/test-worker.cc',
+      ],
+    },
+    {
+      'target_name': 'zb_mksnapshot',
+      'type': 'executable',
+      'dependencies': [
+        '../../libs/v8/tools/gyp/v8.gyp:v8_base',
+        '../../libs/v8/tools/gyp/v8.gyp:v8_nosnapshot',
+      ],
+      # Prepended so "v8.h" resolves to V8's internal header, not the
+      # public one from target_defaults.
+      'include_dirs+': [
+        '../../libs/v8/src',
+      ],
+      'sources': [
+        'tools/mksnapshot.cc',
+      ],
+    },
+    {
+      # Stands in for V8's own v8_snapshot library.
+      'target_name': 'zb_snapshot',
+      'type': 'static_library',
+      'dependencies': [
+        '../../libs/v8/tools/gyp/v8.gyp:js2c',
+        '../../libs/v8/tools/gyp/v8.gyp:v8_base',
+        'zb_mksnapshot',
+      ],
+      # Prepended so "v8.h" resolves to V8's internal header, not the
+      # public one from target_defaults.
+      'include_dirs+': [
+        '../../libs/v8/src',
+      ],
+      'sources': [
+        '<(SHARED_INTERMEDIATE_DIR)/libraries.cc',
+        '<(SHARED_INTERMEDIATE_DIR)/experimental-libraries.cc',
+        '<(INTERMEDIATE_DIR)/snapshot.cc',
+      ],
+      'actions': [
+        {
+          'action_name': 'run_zb_mksnapshot',
+          'inputs': [
+            '<(PRODUCT_DIR)/<(EXECUTABLE_PREFIX)zb_mksnapshot<(EXECUTABLE_SUFFIX)',
+            '<@(zb_framework_files)',
+          ],
+          'outputs': [
+            '<(INTERMEDIATE_DIR)/snapshot.cc',
+          ],
+          'action': [
+            '<(PRODUCT_DIR)/<(EXECUTABLE_PREFIX)zb_mksnapshot<(EXECUTABLE_SUFFIX)',
+            '<@(_outputs)',
+            '<@(zb_framework_files)',
+          ],
+        },
+      ],
+    },
+  ],
+}
@@ -0,0 +1,209 @@
+//
+//  animator.cc
+//  zb
+//
+//  Created by  on 12/03/11.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+
+#include "animator.h"
+
+namespace {
+    const double kNotStarted = -1;
+    
+    float Ease(zb::Animation::Curve curve, float t)
+    {
+        switch (curve) {
+            case zb::Animation::kEaseIn:
+                return t * t;
+            case zb::Animation::kEaseOut:
+                return 1 - (1 - t) * (1 - t);
+            case zb::Animation::kEaseInOut:
+                return t < 0.5f ? 2 * t * t : 1 - 2 * (1 - t) * (1 - t);
+            default:
+                return t;
+        }
+    }
+    
+    float Mix(float from, float to, float t)
+    {
+        return from + (to - from) * t;
+    }
+}
+
+zb::Animator::Animator(Backend *target)
+    : target_(target), completion_(NULL), completion_data_(NULL)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+void zb::Animator::SetCompletion(Completion completion, void *data)
+{
+    completion_ = completion;
+    completion_data_ = data;
+}
+
+// Advances every running animation to |now| (seconds, any monotonic
+// clock) inside one commit. Animations start on the first tick after they
+// arrive, so their delay counts from there. Returns whether any are left.
+bool zb::Animator::Tick(double now)
+{
+    if (running_.empty()) {
+        return false;
+    }
+    stats_.ticks++;
+    target_->BeginCommit();
+    size_t kept = 0;
+    for (size_t i = 0; i < running_.size(); i++) {
+        Running &running = running_[i];
+        const Animation &animation = running.animation;
+        if (running.start == kNotStarted) {
+            running.start = now + animation.delay;
+        }
+        if (now < running.start) {
+            running_[kept++] = running;
+            continue;
+        }
+        float t = animation.duration > 0 ? static_cast<float>((now - running.start) / animation.duration) : 1;
+        bool done = t >= 1;
+        float eased = done ? 1 : Ease(animation.curve, t);
+        if (animation.fields & Animation::kFrame) {
+            const Frame &from = running.from_frame;
+            Frame to = animation.EndFrame(from);
+            Frame frame = { Mix(from.x, to.x, eased), Mix(from.y, to.y, eased),
+                Mix(from.width, to.width, eased), Mix(from.height, to.height, eased) };
+            // Fields this animation does not own keep whatever another
+            // animation or a commit put there.
+            Frame current = target_->GetFrame(running.view);
+            Animation mask = animation;
+            mask.frame = frame;
+            target_->SetFrame(running.view, mask.EndFrame(current));
+        }
+        if (animation.fields & Animation::kAlpha) {
+            target_->SetAlpha(running.view, Mix(running.from_alpha, animation.alpha, eased));
+        }
+        if (done) {
+            stats_.finished++;
+            Report(animation.id, true);
+        } else {
+            running_[kept++] = running;
+        }
+    }
+    running_.resize(kept);
+    target_->EndCommit();
+    return !running_.empty();
+}
+
+void zb::Animator::Animate(NativeView view, const Animation &animation)
+{
+    Interrupt(view, animation.fields);
+    Running running;
+    running.view = view;
+    running.animation = animation;
+    running.from_frame = target_->GetFrame(view);
+    running.from_alpha = target_->GetAlpha(view);
+    running.start = kNotStarted;
+    running_.push_back(running);
+    stats_.started++;
+}
+
+// Takes |fields| away from the animations running on |view|; one left with
+// nothing to animate is over.
+void zb::Animator::Interrupt(NativeView view, int fields)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < running_.size(); i++) {
+        Running &running = running_[i];
+        if (running.view == view) {
+            running.animation.fields &= ~fields;
+            if (running.animation.fields == 0) {
+                stats_.interrupted++;
+                Report(running.animation.id, false);
+                continue;
+            }
+        }
+        running_[kept++] = running;
+    }
+    running_.resize(kept);
+}
+
+void zb::Animator::Report(int id, bool finished)
+{
+    if (id != 0 && completion_ != NULL) {
+        completion_(completion_data_, id, finished);
+    }
+}
+
+void zb::Animator::BeginCommit()
+{
+    target_->BeginCommit();
+}
+
+void zb::Animator::EndCommit()
+{
+    target_->EndCommit();
+}
+
+zb::NativeView zb::Animator::CreateView()
+{
+    return target_->CreateView();
+}
+
+void zb::Animator::DestroyView(NativeView view)
+{
+    if (!running_.empty()) {
+        Interrupt(view, Animation::kFrame | Animation::kAlpha);
+    }
+    target_->DestroyView(view);
+}
+
+void zb::Animator::RecycleView(NativeView view)
+{
+    if (!running_.empty()) {
+        Interrupt(view, Animation::kFrame | Animation::kAlpha);
+    }
+    target_->RecycleView(view);
+}
+
+zb::Frame zb::Animator::GetFrame(NativeView view)
+{
+    return target_->GetFrame(view);
+}
+
+void zb::Animator::SetFrame(NativeView view, const Frame &frame)
+{
+    if (!running_.empty()) {
+        Interrupt(view, Animation::kFrame);
+    }
+    target_->SetFrame(view, frame);
+}
+
+float zb::Animator::GetAlpha(NativeView view)
+{
+    return target_->GetAlpha(view);
+}
+
+void zb::Animator::SetAlpha(NativeView view, float alpha)
+{
+    if (!running_.empty()) {
+        Interrupt(view, Animation::kAlpha);
+    }
+    target_->SetAlpha(view, alpha);
+}
+
+void zb::Animator::AddSubview(NativeView parent, NativeView child)
+{
+    target_->AddSubview(parent, child);
+}
+
+void zb::Animator::RemoveFromSuperview(NativeView view)
+{
+    target_->RemoveFromSuperview(view);
+}
+
+void zb::Animator::Log(const char *message)
+{
+    target_->Log(message);
+}
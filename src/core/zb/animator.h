@@ -0,0 +1,80 @@
+//
+//  animator.h
+//  zb
+//
+//  Created by  on 12/03/11.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_ANIMATOR_H_
+#define ZB_ANIMATOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "backend.h"
+
+namespace zb {
+    // Runs animations on the UI thread. It sits in front of the real
+    // backend (the target of CommandQueue::Drain, or the runtime's backend
+    // on a single thread) and forwards everything, keeping the Animate
+    // calls for itself. The host calls Tick once per display frame; scripts
+    // are only involved again when an animation finishes or is interrupted.
+    //
+    // A new animation takes over the fields it shares with running ones on
+    // the same view, starting from what is on screen. A plain frame write
+    // interrupts the frame fields, an alpha write the alpha, and destroying
+    // or recycling a view interrupts everything on it.
+    class Animator : public Backend {
+    public:
+        // Called with the id of a reporting animation and whether it ran
+        // to the end. It must not call back into the animator.
+        typedef void (*Completion)(void *data, int id, bool finished);
+        
+        struct Stats {
+            int64_t started;
+            int64_t finished;
+            int64_t interrupted;
+            int64_t ticks;
+        };
+        
+        explicit Animator(Backend *target);
+        void SetCompletion(Completion completion, void *data);
+        bool Tick(double now);
+        bool active() const { return !running_.empty(); }
+        const Stats &stats() const { return stats_; }
+        
+        virtual void BeginCommit();
+        virtual void EndCommit();
+        virtual NativeView CreateView();
+        virtual void DestroyView(NativeView view);
+        virtual void RecycleView(NativeView view);
+        virtual Frame GetFrame(NativeView view);
+        virtual void SetFrame(NativeView view, const Frame &frame);
+        virtual float GetAlpha(NativeView view);
+        virtual void SetAlpha(NativeView view, float alpha);
+        virtual void AddSubview(NativeView parent, NativeView child);
+        virtual void RemoveFromSuperview(NativeView view);
+        virtual void Log(const char *message);
+        virtual void Animate(NativeView view, const Animation &animation);
+    private:
+        struct Running {
+            NativeView view;
+            Animation animation;
+            Frame from_frame;
+            float from_alpha;
+            double start;
+        };
+        
+        void Interrupt(NativeView view, int fields);
+        void Report(int id, bool finished);
+        
+        Backend *target_;
+        std::vector<Running> running_;
+        Completion completion_;
+        void *completion_data_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_ANIMATOR_H_
@@ -0,0 +1,107 @@
+//
+//  backend.h
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_BACKEND_H_
+#define ZB_BACKEND_H_
+
+namespace zb {
+    typedef void *NativeView;
+    
+    struct Frame {
+        float x;
+        float y;
+        float width;
+        float height;
+    };
+    
+    // Target state and timing for Backend::Animate. Only the fields named
+    // in |fields| animate; times are in seconds. Animations with a nonzero
+    // id report back to the script when they finish or are interrupted.
+    struct Animation {
+        enum Field {
+            kX = 1 << 0,
+            kY = 1 << 1,
+            kWidth = 1 << 2,
+            kHeight = 1 << 3,
+            kAlpha = 1 << 4,
+            kFrame = kX | kY | kWidth | kHeight
+        };
+        
+        enum Curve {
+            kLinear,
+            kEaseIn,
+            kEaseOut,
+            kEaseInOut
+        };
+        
+        int id;
+        int fields;
+        Frame frame;
+        float alpha;
+        double duration;
+        double delay;
+        Curve curve;
+        
+        // |from| with the animated frame fields replaced by their targets.
+        Frame EndFrame(const Frame &from) const
+        {
+            Frame end = from;
+            if (fields & kX) {
+                end.x = frame.x;
+            }
+            if (fields & kY) {
+                end.y = frame.y;
+            }
+            if (fields & kWidth) {
+                end.width = frame.width;
+            }
+            if (fields & kHeight) {
+                end.height = frame.height;
+            }
+            return end;
+        }
+    };
+    
+    // Everything the bridge needs from the platform's view system. UIKit
+    // implements it on iOS, MemoryBackend on headless builds. Frame and
+    // alpha writes only arrive between BeginCommit and EndCommit.
+    // RecycleView puts a view back in the state CreateView returns it in
+    // (detached, no subviews, zero frame, alpha 1) so it can be reused.
+    // Animate is called outside commits; it jumps straight to the end
+    // state unless an Animator sits in front of the backend.
+    class Backend {
+    public:
+        virtual ~Backend() {}
+        virtual void BeginCommit() {}
+        virtual void EndCommit() {}
+        virtual NativeView CreateView() = 0;
+        virtual void DestroyView(NativeView view) = 0;
+        virtual void RecycleView(NativeView view) = 0;
+        virtual Frame GetFrame(NativeView view) = 0;
+        virtual void SetFrame(NativeView view, const Frame &frame) = 0;
+        virtual float GetAlpha(NativeView view) = 0;
+        virtual void SetAlpha(NativeView view, float alpha) = 0;
+        virtual void AddSubview(NativeView parent, NativeView child) = 0;
+        virtual void RemoveFromSuperview(NativeView view) = 0;
+        virtual void Log(const char *message) = 0;
+        
+        virtual void Animate(NativeView view, const Animation &animation)
+        {
+            BeginCommit();
+            if (animation.fields & Animation::kFrame) {
+                SetFrame(view, animation.EndFrame(GetFrame(view)));
+            }
+            if (animation.fields & Animation::kAlpha) {
+                SetAlpha(view, animation.alpha);
+            }
+            EndCommit();
+        }
+    };
+}
+
+#endif  // ZB_BACKEND_H_
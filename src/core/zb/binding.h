@@ -0,0 +1,453 @@
+//
+//  binding.h
+//  zb
+//
+//  Created by  on 12/03/02.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_BINDING_H_
+#define ZB_BINDING_H_
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "v8.h"
+#include "v8stdint.h"
+#include "trace.h"
+
+namespace zb {
+    // Wrapped objects keep the native pointer in internal field 0 and a
+    // per-class tag in field 1, so typed arguments can be checked without
+    // holding on to the class's FunctionTemplate.
+    enum {
+        kWrappedPointerField,
+        kWrappedClassField,
+        kWrappedFieldCount
+    };
+    
+    template <class C>
+    struct ClassTag {
+        static char id;
+    };
+    
+    template <class C>
+    char ClassTag<C>::id;
+    
+    template <class C>
+    inline void Wrap(v8::Handle<v8::Object> object, C *native)
+    {
+        object->SetPointerInInternalField(kWrappedPointerField, native);
+        object->SetPointerInInternalField(kWrappedClassField, &ClassTag<C>::id);
+    }
+    
+    template <class C>
+    inline C *Unwrap(v8::Handle<v8::Object> holder)
+    {
+        return static_cast<C *>(holder->GetPointerFromInternalField(kWrappedPointerField));
+    }
+    
+    template <class C>
+    inline C *UnwrapChecked(v8::Handle<v8::Value> value)
+    {
+        if (!value->IsObject()) {
+            return NULL;
+        }
+        v8::Handle<v8::Object> object = v8::Handle<v8::Object>::Cast(value);
+        if (object->InternalFieldCount() != kWrappedFieldCount ||
+            object->GetPointerFromInternalField(kWrappedClassField) != &ClassTag<C>::id) {
+            return NULL;
+        }
+        return Unwrap<C>(object);
+    }
+    
+    // Inline reads of V8's tagged values, so the common argument types are
+    // converted without an API call. Constants missing from v8.h's
+    // Internals mirror libs/v8/src/objects.h and must follow it on upgrade.
+    namespace tagged {
+        typedef v8::internal::Internals Internals;
+        
+        const int kHeapNumberType = 0x84;
+        const int kHeapNumberValueOffset = v8::internal::kApiPointerSize;
+        const int kStringEncodingMask = 0x04;
+        const int kAsciiStringTag = 0x04;
+        
+        inline v8::internal::Object *Raw(v8::Handle<v8::Value> value)
+        {
+            return *reinterpret_cast<v8::internal::Object **>(*value);
+        }
+        
+        inline bool IsSmi(v8::internal::Object *raw) { return Internals::HasSmiTag(raw); }
+        inline int SmiValue(v8::internal::Object *raw) { return Internals::SmiValue(raw); }
+        
+        inline bool IsHeapNumber(v8::internal::Object *raw)
+        {
+            return !Internals::HasSmiTag(raw) && Internals::GetInstanceType(raw) == kHeapNumberType;
+        }
+        
+        inline double HeapNumberValue(v8::internal::Object *raw)
+        {
+            double value;
+            memcpy(&value, reinterpret_cast<char *>(raw) + kHeapNumberValueOffset - v8::internal::kHeapObjectTag, sizeof(value));
+            return value;
+        }
+        
+        // Sequential, cons or external strings whose characters are all ASCII.
+        inline bool IsAsciiString(v8::internal::Object *raw)
+        {
+            if (Internals::HasSmiTag(raw)) {
+                return false;
+            }
+            int type = Internals::GetInstanceType(raw);
+            return type < Internals::kFirstNonstringType && (type & kStringEncodingMask) == kAsciiStringTag;
+        }
+        
+        // JSObject::kElementsOffset: map, properties, then elements.
+        const int kJSObjectElementsOffset = 2 * v8::internal::kApiPointerSize;
+
+        // True when both objects have the same hidden class and share one
+        // elements store. The map covers the prototype, every named own
+        // property (hidden ones too) with its attributes, and
+        // extensibility; objects without indexed properties all point to
+        // the heap's empty array.
+        inline bool SameShape(v8::Handle<v8::Object> a, v8::Handle<v8::Object> b)
+        {
+            typedef v8::internal::Object O;
+            O *x = Raw(a);
+            O *y = Raw(b);
+            return Internals::ReadField<O *>(x, Internals::kHeapObjectMapOffset) == Internals::ReadField<O *>(y, Internals::kHeapObjectMapOffset) &&
+                   Internals::ReadField<O *>(x, kJSObjectElementsOffset) == Internals::ReadField<O *>(y, kJSObjectElementsOffset);
+        }
+
+        // ECMAScript ToInt32 for a number already in hand.
+        inline int32_t DoubleToInt32(double value)
+        {
+            if (value >= -2147483648.0 && value <= 2147483647.0) {
+                return static_cast<int32_t>(value);
+            }
+            if (value != value || value == HUGE_VAL || value == -HUGE_VAL) {
+                return 0;
+            }
+            double modulo = fmod(value < 0 ? ceil(value) : floor(value), 4294967296.0);
+            if (modulo < 0) {
+                modulo += 4294967296.0;
+            }
+            return static_cast<int32_t>(static_cast<uint32_t>(modulo));
+        }
+    }
+    
+    // Typed conversions used by the generated callbacks. FromV8 returns
+    // false when the value cannot become a T. Each checks the common
+    // representations inline and only calls into V8, which may run
+    // valueOf or toString, for everything else.
+    template <typename T>
+    struct Converter;
+    
+    template <>
+    struct Converter<bool> {
+        static v8::Handle<v8::Value> ToV8(bool value) { return v8::Boolean::New(value); }
+        static bool FromV8(v8::Handle<v8::Value> value, bool *out)
+        {
+            v8::internal::Object *raw = tagged::Raw(value);
+            if (tagged::IsSmi(raw)) {
+                *out = tagged::SmiValue(raw) != 0;
+            } else if (tagged::IsHeapNumber(raw)) {
+                double number = tagged::HeapNumberValue(raw);
+                *out = number != 0 && number == number;
+            } else {
+                *out = value->BooleanValue();
+            }
+            return true;
+        }
+    };
+    
+    template <>
+    struct Converter<int32_t> {
+        static v8::Handle<v8::Value> ToV8(int32_t value) { return v8::Integer::New(value); }
+        static bool FromV8(v8::Handle<v8::Value> value, int32_t *out)
+        {
+            v8::internal::Object *raw = tagged::Raw(value);
+            if (tagged::IsSmi(raw)) {
+                *out = tagged::SmiValue(raw);
+            } else if (tagged::IsHeapNumber(raw)) {
+                *out = tagged::DoubleToInt32(tagged::HeapNumberValue(raw));
+            } else {
+                *out = value->Int32Value();
+            }
+            return true;
+        }
+    };
+    
+    template <>
+    struct Converter<uint32_t> {
+        static v8::Handle<v8::Value> ToV8(uint32_t value) { return v8::Integer::NewFromUnsigned(value); }
+        static bool FromV8(v8::Handle<v8::Value> value, uint32_t *out)
+        {
+            v8::internal::Object *raw = tagged::Raw(value);
+            if (tagged::IsSmi(raw)) {
+                *out = static_cast<uint32_t>(tagged::SmiValue(raw));
+            } else if (tagged::IsHeapNumber(raw)) {
+                *out = static_cast<uint32_t>(tagged::DoubleToInt32(tagged::HeapNumberValue(raw)));
+            } else {
+                *out = value->Uint32Value();
+            }
+            return true;
+        }
+    };
+    
+    template <>
+    struct Converter<double> {
+        // Integral results come back as Smis instead of new heap numbers.
+        static v8::Handle<v8::Value> ToV8(double value)
+        {
+            if (value >= -2147483648.0 && value <= 2147483647.0) {
+                int32_t integer = static_cast<int32_t>(value);
+                if (integer == value && (integer != 0 || !signbit(value))) {
+                    return v8::Integer::New(integer);
+                }
+            }
+            return v8::Number::New(value);
+        }
+        
+        static bool FromV8(v8::Handle<v8::Value> value, double *out)
+        {
+            v8::internal::Object *raw = tagged::Raw(value);
+            if (tagged::IsSmi(raw)) {
+                *out = tagged::SmiValue(raw);
+            } else if (tagged::IsHeapNumber(raw)) {
+                *out = tagged::HeapNumberValue(raw);
+            } else {
+                *out = value->NumberValue();
+            }
+            return true;
+        }
+    };
+    
+    // Geometry is stored as float but converted as double, so a value is
+    // rounded once, on the way into the buffer.
+    template <>
+    struct Converter<float> {
+        static v8::Handle<v8::Value> ToV8(float value) { return Converter<double>::ToV8(value); }
+        static bool FromV8(v8::Handle<v8::Value> value, float *out)
+        {
+            double number;
+            Converter<double>::FromV8(value, &number);
+            *out = static_cast<float>(number);
+            return true;
+        }
+    };
+    
+    // ASCII strings are copied out as they are; anything else goes through
+    // ToString and UTF-8 encoding. WriteUtf8 rather than WriteAscii, which
+    // turns NULs into spaces.
+    template <>
+    struct Converter<std::string> {
+        static v8::Handle<v8::Value> ToV8(const std::string &value)
+        {
+            return v8::String::New(value.data(), static_cast<int>(value.size()));
+        }
+        
+        static bool FromV8(v8::Handle<v8::Value> value, std::string *out)
+        {
+            if (tagged::IsAsciiString(tagged::Raw(value))) {
+                v8::Handle<v8::String> string = v8::Handle<v8::String>::Cast(value);
+                out->resize(string->Length());
+                if (!out->empty()) {
+                    string->WriteUtf8(&(*out)[0], static_cast<int>(out->size()), NULL, v8::String::NO_NULL_TERMINATION);
+                }
+                return true;
+            }
+            v8::String::Utf8Value utf8(value);
+            if (*utf8 == NULL) {
+                return false;
+            }
+            out->assign(*utf8, utf8.length());
+            return true;
+        }
+    };
+    
+    template <class C>
+    struct Converter<C *> {
+        static bool FromV8(v8::Handle<v8::Value> value, C **out)
+        {
+            *out = UnwrapChecked<C>(value);
+            return *out != NULL;
+        }
+    };
+    
+    inline v8::Handle<v8::Value> ThrowArgumentError(int index)
+    {
+        char message[64];
+        snprintf(message, sizeof(message), "argument %d has the wrong type", index + 1);
+        return v8::ThrowException(v8::Exception::TypeError(v8::String::New(message)));
+    }
+    
+    template <class C, typename T, T (C::*Getter)() const, void (C::*Setter)(T)>
+    struct Accessor {
+        static v8::Handle<v8::Value> Get(v8::Local<v8::String> propertyName, const v8::AccessorInfo& info)
+        {
+            return Converter<T>::ToV8((Unwrap<C>(info.Holder())->*Getter)());
+        }
+        
+        static void Set(v8::Local<v8::String> propertyName, v8::Local<v8::Value> value, const v8::AccessorInfo& info)
+        {
+            T native;
+            if (!Converter<T>::FromV8(value, &native)) {
+                ThrowArgumentError(0);
+                return;
+            }
+            (Unwrap<C>(info.Holder())->*Setter)(native);
+        }
+    };
+    
+    template <class C, typename T, T (C::*Getter)() const>
+    struct ReadOnlyAccessor {
+        static v8::Handle<v8::Value> Get(v8::Local<v8::String> propertyName, const v8::AccessorInfo& info)
+        {
+            return Converter<T>::ToV8((Unwrap<C>(info.Holder())->*Getter)());
+        }
+    };
+    
+    template <class C, typename R, R (C::*M)()>
+    struct Method0 {
+        static v8::Handle<v8::Value> Call(const v8::Arguments& args)
+        {
+            return Converter<R>::ToV8((Unwrap<C>(args.Holder())->*M)());
+        }
+    };
+    
+    template <class C, void (C::*M)()>
+    struct Method0<C, void, M> {
+        static v8::Handle<v8::Value> Call(const v8::Arguments& args)
+        {
+            (Unwrap<C>(args.Holder())->*M)();
+            return args.This();
+        }
+    };
+    
+    template <class C, typename R, typename A1, R (C::*M)(A1)>
+    struct Method1 {
+        static v8::Handle<v8::Value> Call(const v8::Arguments& args)
+        {
+            A1 a1;
+            if (!Converter<A1>::FromV8(args[0], &a1)) {
+                return ThrowArgumentError(0);
+            }
+            return Converter<R>::ToV8((Unwrap<C>(args.Holder())->*M)(a1));
+        }
+    };
+    
+    template <class C, typename A1, void (C::*M)(A1)>
+    struct Method1<C, void, A1, M> {
+        static v8::Handle<v8::Value> Call(const v8::Arguments& args)
+        {
+            A1 a1;
+            if (!Converter<A1>::FromV8(args[0], &a1)) {
+                return ThrowArgumentError(0);
+            }
+            (Unwrap<C>(args.Holder())->*M)(a1);
+            return args.This();
+        }
+    };
+    
+    template <typename R, typename A1, typename A2, R (*F)(A1, A2)>
+    struct Function2 {
+        static v8::Handle<v8::Value> Call(const v8::Arguments& args)
+        {
+            A1 a1;
+            A2 a2;
+            if (!Converter<A1>::FromV8(args[0], &a1)) {
+                return ThrowArgumentError(0);
+            }
+            if (!Converter<A2>::FromV8(args[1], &a2)) {
+                return ThrowArgumentError(1);
+            }
+            return Converter<R>::ToV8(F(a1, a2));
+        }
+    };
+    
+    // Builds the FunctionTemplate for a wrapped class. Each Property or
+    // Method call instantiates callbacks specialized for that member, so
+    // the glue is typed and has no per-call dispatch:
+    //
+    //   ClassBinding<View> binding("View", View::New, data);
+    //   binding.Property<float, &View::x, &View::set_x>("x");
+    //   binding.Method<void, View *, &View::AddSubview>("addSubview");
+    //
+    // With tracing enabled each of them is timed as "View.x", "View.x=" or
+    // "View.addSubview"; see trace.h.
+    template <class C>
+    class ClassBinding {
+    public:
+        ClassBinding(const char *name, v8::InvocationCallback constructor, v8::Handle<v8::Value> data)
+            : name_(name)
+        {
+            klass_ = v8::FunctionTemplate::New(constructor, data);
+            klass_->SetClassName(v8::String::NewSymbol(name));
+            klass_->InstanceTemplate()->SetInternalFieldCount(kWrappedFieldCount);
+            signature_ = v8::Signature::New(klass_);
+        }
+        
+        template <typename T, T (C::*Getter)() const, void (C::*Setter)(T)>
+        ClassBinding &Property(const char *name)
+        {
+            klass_->InstanceTemplate()->SetAccessor(v8::String::NewSymbol(name),
+                                                    TraceGetter<Accessor<C, T, Getter, Setter>::Get>(Qualify(name).c_str()),
+                                                    TraceSetter<Accessor<C, T, Getter, Setter>::Set>(Qualify(name, "=").c_str()));
+            return *this;
+        }
+        
+        template <typename T, T (C::*Getter)() const>
+        ClassBinding &ReadOnlyProperty(const char *name)
+        {
+            klass_->InstanceTemplate()->SetAccessor(v8::String::NewSymbol(name),
+                                                    TraceGetter<ReadOnlyAccessor<C, T, Getter>::Get>(Qualify(name).c_str()),
+                                                    NULL, v8::Handle<v8::Value>(), v8::DEFAULT, v8::ReadOnly);
+            return *this;
+        }
+        
+        template <typename R, R (C::*M)()>
+        ClassBinding &Method(const char *name)
+        {
+            return SetMethod(name, Trace<Method0<C, R, M>::Call>(Qualify(name).c_str()));
+        }
+        
+        template <typename R, typename A1, R (C::*M)(A1)>
+        ClassBinding &Method(const char *name)
+        {
+            return SetMethod(name, Trace<Method1<C, R, A1, M>::Call>(Qualify(name).c_str()));
+        }
+        
+        // For methods that take the raw arguments; the signature still
+        // guarantees the receiver is a C.
+        template <v8::InvocationCallback F>
+        ClassBinding &Method(const char *name)
+        {
+            return SetMethod(name, Trace<F>(Qualify(name).c_str()));
+        }
+        
+        v8::Local<v8::FunctionTemplate> klass() const { return klass_; }
+    private:
+        // Trace names: "View.x" for a method or getter, "View.x=" for a
+        // setter.
+        std::string Qualify(const char *name, const char *suffix = "") const
+        {
+            return name_ + "." + name + suffix;
+        }
+        
+        ClassBinding &SetMethod(const char *name, v8::InvocationCallback callback)
+        {
+            klass_->PrototypeTemplate()->Set(v8::String::NewSymbol(name),
+                                             v8::FunctionTemplate::New(callback, v8::Handle<v8::Value>(), signature_));
+            return *this;
+        }
+        
+        std::string name_;
+        v8::Local<v8::FunctionTemplate> klass_;
+        v8::Local<v8::Signature> signature_;
+    };
+}
+
+#endif  // ZB_BINDING_H_
@@ -0,0 +1,247 @@
+//
+//  command_queue.cc
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "command_queue.h"
+
+namespace zb {
+    // What the script thread holds instead of a native view. |native| is
+    // only read and written on the UI thread; the links, which list the
+    // proxies not yet destroyed, only on the script thread.
+    struct ProxyView {
+        NativeView native;
+        ProxyView *prev;
+        ProxyView *next;
+    };
+}
+
+namespace {
+    zb::NativeView Resolve(zb::NativeView proxy)
+    {
+        return static_cast<zb::ProxyView *>(proxy)->native;
+    }
+}
+
+zb::CommandQueue::CommandQueue(size_t capacity)
+    : ring_(capacity), stalls_(0)
+{
+}
+
+zb::CommandQueue::~CommandQueue()
+{
+    Discard();
+}
+
+// Drops what is queued without applying it, freeing what the commands
+// own. Called on the UI thread, when there is nothing to drain into.
+void zb::CommandQueue::Discard()
+{
+    Command command;
+    while (ring_.Pop(&command)) {
+        if (command.type == Command::kLog) {
+            free(command.message);
+        } else if (command.type == Command::kAnimate) {
+            delete command.animation;
+        } else if (command.type == Command::kDestroyView) {
+            delete static_cast<ProxyView *>(command.view);
+        }
+    }
+}
+
+// Called on the script thread. A full ring means the UI thread is behind;
+// the script thread yields rather than dropping mutations.
+void zb::CommandQueue::Push(const Command &command)
+{
+    while (!ring_.Push(command)) {
+        stalls_.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+}
+
+// Called on the UI thread, typically once per frame. Returns the number of
+// commands applied.
+int zb::CommandQueue::Drain(Backend *target)
+{
+    int count = 0;
+    Command command;
+    while (ring_.Pop(&command)) {
+        switch (command.type) {
+            case Command::kCreateView:
+                static_cast<ProxyView *>(command.view)->native = target->CreateView();
+                break;
+            case Command::kDestroyView:
+                target->DestroyView(Resolve(command.view));
+                delete static_cast<ProxyView *>(command.view);
+                break;
+            case Command::kRecycleView:
+                target->RecycleView(Resolve(command.view));
+                break;
+            case Command::kSetFrame:
+                target->SetFrame(Resolve(command.view), command.frame);
+                break;
+            case Command::kSetAlpha:
+                target->SetAlpha(Resolve(command.view), command.alpha);
+                break;
+            case Command::kAddSubview:
+                target->AddSubview(Resolve(command.view), Resolve(command.other));
+                break;
+            case Command::kRemoveFromSuperview:
+                target->RemoveFromSuperview(Resolve(command.view));
+                break;
+            case Command::kBeginCommit:
+                target->BeginCommit();
+                break;
+            case Command::kEndCommit:
+                target->EndCommit();
+                break;
+            case Command::kLog:
+                target->Log(command.message);
+                free(command.message);
+                break;
+            case Command::kAnimate:
+                target->Animate(Resolve(command.view), *command.animation);
+                delete command.animation;
+                break;
+        }
+        count++;
+    }
+    return count;
+}
+
+zb::QueuedBackend::QueuedBackend(CommandQueue *queue)
+    : queue_(queue), proxies_(NULL)
+{
+}
+
+zb::QueuedBackend::~QueuedBackend()
+{
+    while (proxies_ != NULL) {
+        ProxyView *next = proxies_->next;
+        delete proxies_;
+        proxies_ = next;
+    }
+}
+
+void zb::QueuedBackend::Push(Command::Type type, NativeView view, NativeView other)
+{
+    Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.view = view;
+    command.other = other;
+    queue_->Push(command);
+}
+
+void zb::QueuedBackend::BeginCommit()
+{
+    Push(Command::kBeginCommit, NULL);
+}
+
+void zb::QueuedBackend::EndCommit()
+{
+    Push(Command::kEndCommit, NULL);
+}
+
+zb::NativeView zb::QueuedBackend::CreateView()
+{
+    ProxyView *proxy = new ProxyView();
+    proxy->native = NULL;
+    proxy->prev = NULL;
+    proxy->next = proxies_;
+    if (proxies_ != NULL) {
+        proxies_->prev = proxy;
+    }
+    proxies_ = proxy;
+    Push(Command::kCreateView, proxy);
+    return proxy;
+}
+
+// From here on the proxy belongs to the command, which frees it.
+void zb::QueuedBackend::DestroyView(NativeView view)
+{
+    ProxyView *proxy = static_cast<ProxyView *>(view);
+    if (proxy->prev != NULL) {
+        proxy->prev->next = proxy->next;
+    } else {
+        proxies_ = proxy->next;
+    }
+    if (proxy->next != NULL) {
+        proxy->next->prev = proxy->prev;
+    }
+    Push(Command::kDestroyView, view);
+}
+
+void zb::QueuedBackend::RecycleView(NativeView view)
+{
+    Push(Command::kRecycleView, view);
+}
+
+zb::Frame zb::QueuedBackend::GetFrame(NativeView view)
+{
+    Frame frame = { 0, 0, 0, 0 };
+    return frame;
+}
+
+void zb::QueuedBackend::SetFrame(NativeView view, const Frame &frame)
+{
+    Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = Command::kSetFrame;
+    command.view = view;
+    command.frame = frame;
+    queue_->Push(command);
+}
+
+float zb::QueuedBackend::GetAlpha(NativeView view)
+{
+    return 1;
+}
+
+void zb::QueuedBackend::SetAlpha(NativeView view, float alpha)
+{
+    Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = Command::kSetAlpha;
+    command.view = view;
+    command.alpha = alpha;
+    queue_->Push(command);
+}
+
+void zb::QueuedBackend::AddSubview(NativeView parent, NativeView child)
+{
+    Push(Command::kAddSubview, parent, child);
+}
+
+void zb::QueuedBackend::RemoveFromSuperview(NativeView view)
+{
+    Push(Command::kRemoveFromSuperview, view);
+}
+
+void zb::QueuedBackend::Log(const char *message)
+{
+    Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = Command::kLog;
+    command.message = strdup(message);
+    queue_->Push(command);
+}
+
+// Animations are rare next to frame writes, so they travel out of line
+// rather than growing every command.
+void zb::QueuedBackend::Animate(NativeView view, const Animation &animation)
+{
+    Command command;
+    memset(&command, 0, sizeof(command));
+    command.type = Command::kAnimate;
+    command.view = view;
+    command.animation = new Animation(animation);
+    queue_->Push(command);
+}
@@ -0,0 +1,92 @@
+//
+//  command_queue.h
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_COMMAND_QUEUE_H_
+#define ZB_COMMAND_QUEUE_H_
+
+#include <stdint.h>
+
+#include "backend.h"
+#include "ring.h"
+
+namespace zb {
+    struct ProxyView;
+    
+    struct Command {
+        enum Type {
+            kCreateView,
+            kDestroyView,
+            kRecycleView,
+            kSetFrame,
+            kSetAlpha,
+            kAddSubview,
+            kRemoveFromSuperview,
+            kBeginCommit,
+            kEndCommit,
+            kLog,
+            kAnimate
+        };
+        
+        Type type;
+        NativeView view;
+        NativeView other;
+        Frame frame;
+        float alpha;
+        char *message;
+        Animation *animation;
+    };
+    
+    // Native mutations recorded on the script thread and replayed on the
+    // UI thread. The script side only ever sees proxies; Drain creates the
+    // real views and resolves proxies as commands arrive, so the script
+    // thread never waits on UI work.
+    class CommandQueue {
+    public:
+        explicit CommandQueue(size_t capacity = 16384);
+        ~CommandQueue();
+        void Push(const Command &command);
+        int Drain(Backend *target);
+        void Discard();
+        size_t pending() const { return ring_.size(); }
+        int64_t stalls() const { return stalls_.load(std::memory_order_relaxed); }
+    private:
+        SpscRing<Command> ring_;
+        std::atomic<int64_t> stalls_;
+    };
+    
+    // Backend for a runtime living on the script thread: every call becomes
+    // a command for the UI thread. New views start with a zero frame and
+    // alpha 1, since the real view does not exist yet. Proxies of views
+    // never destroyed are freed with the backend, once the script thread
+    // is gone.
+    class QueuedBackend : public Backend {
+    public:
+        explicit QueuedBackend(CommandQueue *queue);
+        virtual ~QueuedBackend();
+        virtual void BeginCommit();
+        virtual void EndCommit();
+        virtual NativeView CreateView();
+        virtual void DestroyView(NativeView view);
+        virtual void RecycleView(NativeView view);
+        virtual Frame GetFrame(NativeView view);
+        virtual void SetFrame(NativeView view, const Frame &frame);
+        virtual float GetAlpha(NativeView view);
+        virtual void SetAlpha(NativeView view, float alpha);
+        virtual void AddSubview(NativeView parent, NativeView child);
+        virtual void RemoveFromSuperview(NativeView view);
+        virtual void Log(const char *message);
+        virtual void Animate(NativeView view, const Animation &animation);
+    private:
+        void Push(Command::Type type, NativeView view, NativeView other = NULL);
+        
+        CommandQueue *queue_;
+        ProxyView *proxies_;
+    };
+}
+
+#endif  // ZB_COMMAND_QUEUE_H_
@@ -0,0 +1,34 @@
+//
+//  event.h
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_EVENT_H_
+#define ZB_EVENT_H_
+
+namespace zb {
+    // Input sent from the UI thread to scripts. Animation events carry
+    // the id of the animation that ended and nothing else.
+    struct Event {
+        enum Type {
+            kTouchBegan,
+            kTouchMoved,
+            kTouchEnded,
+            kTouchCancelled,
+            kAnimationFinished,
+            kAnimationInterrupted
+        };
+        
+        Type type;
+        int pointer;
+        float x;
+        float y;
+        double timestamp;
+        int animation;
+    };
+}
+
+#endif  // ZB_EVENT_H_
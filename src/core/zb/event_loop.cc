@@ -0,0 +1,383 @@
+//
+//  event_loop.cc
+//  zb
+//
+//  Created by  on 12/03/16.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "event_loop.h"
+#include "binding.h"
+#include "log_channel.h"
+#include "runtime.h"
+#include "template_cache.h"
+#include "trace.h"
+
+namespace {
+    // Runs callbacks[i] with the arguments in args[i], skipping those whose
+    // ids[i] an earlier callback put in |cleared|. Errors are collected
+    // rather than thrown so one bad callback does not cost the others.
+    const char kTrampolineSource[] =
+        "(function (callbacks, args, ids, cleared) {\n"
+        "    var errors;\n"
+        "    for (var i = 0; i < callbacks.length; i++) {\n"
+        "        if (ids && cleared[ids[i]]) {\n"
+        "            continue;\n"
+        "        }\n"
+        "        try {\n"
+        "            callbacks[i].apply(this, args[i]);\n"
+        "        } catch (e) {\n"
+        "            (errors || (errors = [])).push(e);\n"
+        "        }\n"
+        "    }\n"
+        "    return errors;\n"
+        "})";
+
+    void ReportError(v8::Handle<v8::Value> error)
+    {
+        v8::String::Utf8Value exception(error);
+        const char *message = *exception ? *exception : "<string conversion failed>";
+        zb::LogChannel::Shared()->Write(zb::LogChannel::kError, message, strlen(message));
+    }
+
+    zb::Runtime *RuntimeFor(const v8::Arguments &args)
+    {
+        return static_cast<zb::Runtime *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    }
+}
+
+zb::EventLoop::EventLoop(Runtime *runtime)
+    : runtime_(runtime), wheel_(Tick(Runtime::Now())), next_timer_(1), next_frame_callback_(1),
+      running_frame_(false)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+zb::EventLoop::~EventLoop()
+{
+}
+
+void zb::EventLoop::Dispose()
+{
+    for (TimerMap::iterator it = timers_.begin(); it != timers_.end(); ++it) {
+        wheel_.Remove(it->second);
+        DisposeTimer(it->second);
+    }
+    timers_.clear();
+    for (size_t i = 0; i < frame_callbacks_.size(); i++) {
+        frame_callbacks_[i].second.Dispose();
+    }
+    frame_callbacks_.clear();
+    trampoline_.Dispose();
+    trampoline_.Clear();
+}
+
+uint64_t zb::EventLoop::Tick(double time) const
+{
+    return static_cast<uint64_t>(time * 1000);
+}
+
+double zb::EventLoop::NextTimer() const
+{
+    uint64_t expiry = wheel_.NextExpiry();
+    return expiry == UINT64_MAX ? HUGE_VAL : expiry / 1000.0;
+}
+
+void zb::EventLoop::DisposeTimer(ScriptTimer *timer)
+{
+    timer->callback.Dispose();
+    timer->arguments.Dispose();
+    delete timer;
+}
+
+// Moves only coalesce with the pending move of the same pointer, so a
+// begin or end in between keeps both sides. The later move takes the
+// earlier one's place in the batch.
+void zb::EventLoop::DispatchInput(const Event *events, int count)
+{
+    if (count == 0) {
+        return;
+    }
+    stats_.events += count;
+    batch_.clear();
+    std::vector<std::pair<int, size_t> > moves;
+    for (int i = 0; i < count; i++) {
+        const Event &event = events[i];
+        size_t pending = 0;
+        bool found = false;
+        for (size_t j = 0; j < moves.size(); j++) {
+            if (moves[j].first == event.pointer) {
+                pending = moves[j].second;
+                found = true;
+                if (event.type != Event::kTouchMoved) {
+                    moves.erase(moves.begin() + j);
+                }
+                break;
+            }
+        }
+        if (event.type == Event::kTouchMoved && found) {
+            batch_[pending] = event;
+            stats_.coalesced++;
+            continue;
+        }
+        if (event.type == Event::kTouchMoved) {
+            moves.push_back(std::make_pair(event.pointer, batch_.size()));
+        }
+        batch_.push_back(event);
+    }
+
+    v8::HandleScope handle_scope;
+    TemplateCache *templates = runtime_->templates();
+    v8::Local<v8::Array> objects = v8::Array::New(static_cast<int>(batch_.size()));
+    for (size_t i = 0; i < batch_.size(); i++) {
+        const Event &event = batch_[i];
+        v8::Local<v8::Object> object = v8::Object::New();
+        object->Set(templates->symbol(TemplateCache::kType), templates->symbol(static_cast<TemplateCache::Symbol>(TemplateCache::kTouchBegan + event.type)));
+        object->Set(templates->symbol(TemplateCache::kPointer), v8::Integer::New(event.pointer));
+        object->Set(templates->symbol(TemplateCache::kX), v8::Number::New(event.x));
+        object->Set(templates->symbol(TemplateCache::kY), v8::Number::New(event.y));
+        object->Set(templates->symbol(TemplateCache::kTimestamp), v8::Number::New(event.timestamp));
+        objects->Set(static_cast<uint32_t>(i), object);
+    }
+    Deliver(objects);
+}
+
+void zb::EventLoop::Deliver(v8::Handle<v8::Array> events)
+{
+    TemplateCache *templates = runtime_->templates();
+    v8::Local<v8::Object> global = runtime_->context()->Global();
+    v8::Local<v8::Value> handler = global->Get(templates->symbol(TemplateCache::kOnEvents));
+    v8::Local<v8::Array> callbacks;
+    v8::Local<v8::Array> arguments;
+    if (handler->IsFunction()) {
+        callbacks = v8::Array::New(1);
+        arguments = v8::Array::New(1);
+        v8::Local<v8::Array> argv = v8::Array::New(1);
+        argv->Set(0, events);
+        callbacks->Set(0, handler);
+        arguments->Set(0, argv);
+    } else {
+        handler = global->Get(templates->symbol(TemplateCache::kOnEvent));
+        if (!handler->IsFunction()) {
+            return;
+        }
+        uint32_t length = events->Length();
+        callbacks = v8::Array::New(length);
+        arguments = v8::Array::New(length);
+        for (uint32_t i = 0; i < length; i++) {
+            v8::Local<v8::Array> argv = v8::Array::New(1);
+            argv->Set(0, events->Get(i));
+            callbacks->Set(i, handler);
+            arguments->Set(i, argv);
+        }
+    }
+    stats_.batches++;
+    Call(callbacks, arguments);
+}
+
+// Intervals are put back before any callback runs, measured from when they
+// were due so they do not drift; one that fell more than a period behind
+// fires once and picks up from now.
+int zb::EventLoop::RunTimers(double now)
+{
+    expired_.clear();
+    wheel_.Advance(Tick(now), &expired_);
+    if (expired_.empty()) {
+        return 0;
+    }
+    v8::HandleScope handle_scope;
+    int count = static_cast<int>(expired_.size());
+    v8::Local<v8::Array> callbacks = v8::Array::New(count);
+    v8::Local<v8::Array> arguments = v8::Array::New(count);
+    v8::Local<v8::Array> ids = v8::Array::New(count);
+    for (int i = 0; i < count; i++) {
+        ScriptTimer *timer = static_cast<ScriptTimer *>(expired_[i]);
+        callbacks->Set(i, timer->callback);
+        ids->Set(i, v8::Integer::New(timer->id));
+        if (!timer->arguments.IsEmpty()) {
+            arguments->Set(i, timer->arguments);
+        }
+        if (timer->interval > 0) {
+            uint64_t next = timer->expiry + timer->interval;
+            if (next <= wheel_.now()) {
+                next = wheel_.now() + timer->interval;
+            }
+            wheel_.Add(timer, next);
+        } else {
+            timers_.erase(timer->id);
+            DisposeTimer(timer);
+        }
+    }
+    stats_.timers += count;
+    Call(callbacks, arguments, ids);
+    return count;
+}
+
+// Callbacks requested while these run wait for the next frame.
+int zb::EventLoop::RunFrame(double timestamp)
+{
+    if (frame_callbacks_.empty()) {
+        return 0;
+    }
+    FrameCallbacks frame_callbacks;
+    frame_callbacks.swap(frame_callbacks_);
+    v8::HandleScope handle_scope;
+    int count = static_cast<int>(frame_callbacks.size());
+    v8::Local<v8::Array> callbacks = v8::Array::New(count);
+    v8::Local<v8::Array> arguments = v8::Array::New(count);
+    v8::Local<v8::Array> ids = v8::Array::New(count);
+    v8::Local<v8::Array> argv = v8::Array::New(1);
+    argv->Set(0, v8::Number::New(timestamp * 1000));
+    for (int i = 0; i < count; i++) {
+        callbacks->Set(i, frame_callbacks[i].second);
+        arguments->Set(i, argv);
+        ids->Set(i, v8::Integer::New(frame_callbacks[i].first));
+        frame_callbacks[i].second.Dispose();
+    }
+    stats_.frames++;
+    running_frame_ = true;
+    Call(callbacks, arguments, ids);
+    running_frame_ = false;
+    return count;
+}
+
+// With |ids|, the batch's callbacks can be cleared while it runs; see
+// Cleared.
+void zb::EventLoop::Call(v8::Handle<v8::Array> callbacks, v8::Handle<v8::Array> arguments,
+                         v8::Handle<v8::Array> ids)
+{
+    v8::TryCatch try_catch;
+    v8::Local<v8::Object> global = runtime_->context()->Global();
+    if (trampoline_.IsEmpty()) {
+        v8::Local<v8::Script> script = v8::Script::Compile(v8::String::New(kTrampolineSource), v8::String::New("zb:event_loop"));
+        trampoline_ = v8::Persistent<v8::Function>::New(v8::Local<v8::Function>::Cast(script->Run()));
+    }
+    stats_.entries++;
+    v8::Handle<v8::Value> argv[] = { callbacks, arguments, v8::Undefined(), v8::Undefined() };
+    if (!ids.IsEmpty()) {
+        cleared_ = v8::Persistent<v8::Object>::New(v8::Object::New());
+        argv[2] = ids;
+        argv[3] = cleared_;
+    }
+    v8::Local<v8::Value> errors = trampoline_->Call(global, 4, argv);
+    if (!cleared_.IsEmpty()) {
+        cleared_.Dispose();
+        cleared_.Clear();
+    }
+    if (errors.IsEmpty()) {
+        ReportError(try_catch.Exception());
+        return;
+    }
+    if (errors->IsArray()) {
+        v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(errors);
+        for (uint32_t i = 0; i < array->Length(); i++) {
+            ReportError(array->Get(i));
+        }
+    }
+}
+
+// A delay that is missing, negative or not a number counts as 0, which
+// still waits for the next tick.
+v8::Handle<v8::Value> zb::EventLoop::AddTimer(const v8::Arguments &args, bool repeat)
+{
+    EventLoop *loop = RuntimeFor(args)->event_loop();
+    if (args.Length() < 1 || !args[0]->IsFunction()) {
+        return ThrowArgumentError(0);
+    }
+    double delay = args.Length() > 1 ? args[1]->NumberValue() : 0;
+    if (!(delay > 0)) {
+        delay = 0;
+    }
+    ScriptTimer *timer = new ScriptTimer;
+    timer->id = loop->next_timer_++;
+    timer->interval = repeat ? std::max<uint64_t>(static_cast<uint64_t>(delay), 1) : 0;
+    timer->callback = v8::Persistent<v8::Function>::New(v8::Local<v8::Function>::Cast(args[0]));
+    if (args.Length() > 2) {
+        v8::Local<v8::Array> arguments = v8::Array::New(args.Length() - 2);
+        for (int i = 2; i < args.Length(); i++) {
+            arguments->Set(i - 2, args[i]);
+        }
+        timer->arguments = v8::Persistent<v8::Array>::New(arguments);
+    }
+    uint64_t now = std::max(loop->wheel_.now(), loop->Tick(loop->runtime_->TimerClock()));
+    loop->wheel_.Add(timer, now + static_cast<uint64_t>(delay));
+    loop->timers_[timer->id] = timer;
+    return v8::Integer::New(timer->id);
+}
+
+v8::Handle<v8::Value> zb::EventLoop::SetTimeout(const v8::Arguments &args)
+{
+    return AddTimer(args, false);
+}
+
+v8::Handle<v8::Value> zb::EventLoop::SetInterval(const v8::Arguments &args)
+{
+    return AddTimer(args, true);
+}
+
+// Marks |id| cleared for the batch running now, if it is of the same
+// kind. A timeout due in the batch is already gone from timers_, so this
+// is all that stops it.
+void zb::EventLoop::Cleared(bool frame, int id)
+{
+    if (!cleared_.IsEmpty() && running_frame_ == frame) {
+        cleared_->Set(id, v8::True());
+    }
+}
+
+// Either kind of timer; unknown ids are ignored.
+v8::Handle<v8::Value> zb::EventLoop::ClearTimer(const v8::Arguments &args)
+{
+    EventLoop *loop = RuntimeFor(args)->event_loop();
+    int id = args[0]->Int32Value();
+    loop->Cleared(false, id);
+    TimerMap::iterator it = loop->timers_.find(id);
+    if (it != loop->timers_.end()) {
+        loop->wheel_.Remove(it->second);
+        loop->DisposeTimer(it->second);
+        loop->timers_.erase(it);
+    }
+    return v8::Undefined();
+}
+
+v8::Handle<v8::Value> zb::EventLoop::RequestAnimationFrame(const v8::Arguments &args)
+{
+    EventLoop *loop = RuntimeFor(args)->event_loop();
+    if (args.Length() < 1 || !args[0]->IsFunction()) {
+        return ThrowArgumentError(0);
+    }
+    int id = loop->next_frame_callback_++;
+    loop->frame_callbacks_.push_back(std::make_pair(id, v8::Persistent<v8::Function>::New(v8::Local<v8::Function>::Cast(args[0]))));
+    return v8::Integer::New(id);
+}
+
+v8::Handle<v8::Value> zb::EventLoop::CancelAnimationFrame(const v8::Arguments &args)
+{
+    EventLoop *loop = RuntimeFor(args)->event_loop();
+    int id = args[0]->Int32Value();
+    loop->Cleared(true, id);
+    for (FrameCallbacks::iterator it = loop->frame_callbacks_.begin(); it != loop->frame_callbacks_.end(); ++it) {
+        if (it->first == id) {
+            it->second.Dispose();
+            loop->frame_callbacks_.erase(it);
+            break;
+        }
+    }
+    return v8::Undefined();
+}
+
+void zb::EventLoop::InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime)
+{
+    v8::Handle<v8::External> data = v8::External::New(runtime);
+    global->Set(v8::String::NewSymbol("setTimeout"), v8::FunctionTemplate::New(Trace<EventLoop::SetTimeout>("setTimeout"), data));
+    global->Set(v8::String::NewSymbol("setInterval"), v8::FunctionTemplate::New(Trace<EventLoop::SetInterval>("setInterval"), data));
+    global->Set(v8::String::NewSymbol("clearTimeout"), v8::FunctionTemplate::New(Trace<EventLoop::ClearTimer>("clearTimeout"), data));
+    global->Set(v8::String::NewSymbol("clearInterval"), v8::FunctionTemplate::New(Trace<EventLoop::ClearTimer>("clearInterval"), data));
+    global->Set(v8::String::NewSymbol("requestAnimationFrame"), v8::FunctionTemplate::New(Trace<EventLoop::RequestAnimationFrame>("requestAnimationFrame"), data));
+    global->Set(v8::String::NewSymbol("cancelAnimationFrame"), v8::FunctionTemplate::New(Trace<EventLoop::CancelAnimationFrame>("cancelAnimationFrame"), data));
+}
@@ -0,0 +1,111 @@
+//
+//  event_loop.h
+//  zb
+//
+//  Created by  on 12/03/16.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_EVENT_LOOP_H_
+#define ZB_EVENT_LOOP_H_
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "v8.h"
+#include "event.h"
+#include "timer_wheel.h"
+
+namespace zb {
+    class Runtime;
+
+    // Script side of the runtime's event loop: timers, frame callbacks and
+    // batched input.
+    //
+    //   setTimeout(fn, ms, args...), setInterval(fn, ms, args...),
+    //   clearTimeout(id), clearInterval(id)
+    //   requestAnimationFrame(fn), cancelAnimationFrame(id)
+    //   onEvents = function (events) { ... };
+    //
+    // Timers sit on a TimerWheel with 1 ms ticks; delays count from the
+    // later of the last RunTimers time and the runtime's TimerClock. Whatever expires in one
+    // RunTimers, and every frame callback of one RunFrame, runs from a
+    // single call into the script, so the cost per callback is a JS call,
+    // not a trip through the API. A callback that throws is logged and the
+    // rest still run. Clearing a timer or frame callback that is due in
+    // the same run still stops it if its turn has not come yet.
+    //
+    // Input handed to DispatchInput is one batch: a move followed by
+    // another move of the same pointer is dropped, and what is left goes
+    // to onEvents as one array. Scripts that only define onEvent get one
+    // call per remaining event.
+    //
+    // Use from the runtime's thread with its context entered.
+    class EventLoop {
+    public:
+        struct Stats {
+            int64_t events;     // input events handed in
+            int64_t coalesced;  // moves dropped for a later move
+            int64_t batches;    // script entries for input
+            int64_t timers;     // timer callbacks run
+            int64_t frames;     // RunFrame calls with callbacks
+            int64_t entries;    // script entries for timers and frames
+        };
+
+        explicit EventLoop(Runtime *runtime);
+        ~EventLoop();
+        void Dispose();
+
+        void DispatchInput(const Event *events, int count);
+        int RunTimers(double now);
+        int RunFrame(double timestamp);
+
+        // A Runtime::Now() time no timer expires before, or HUGE_VAL.
+        double NextTimer() const;
+        bool HasFrameCallbacks() const { return !frame_callbacks_.empty(); }
+        const Stats &stats() const { return stats_; }
+
+        static v8::Handle<v8::Value> SetTimeout(const v8::Arguments &args);
+        static v8::Handle<v8::Value> SetInterval(const v8::Arguments &args);
+        static v8::Handle<v8::Value> ClearTimer(const v8::Arguments &args);
+        static v8::Handle<v8::Value> RequestAnimationFrame(const v8::Arguments &args);
+        static v8::Handle<v8::Value> CancelAnimationFrame(const v8::Arguments &args);
+        static void InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime);
+    private:
+        struct ScriptTimer : TimerWheel::Timer {
+            int id;
+            uint64_t interval;  // ticks; 0 for a timeout
+            v8::Persistent<v8::Function> callback;
+            v8::Persistent<v8::Array> arguments;
+        };
+
+        typedef std::map<int, ScriptTimer *> TimerMap;
+        typedef std::vector<std::pair<int, v8::Persistent<v8::Function> > > FrameCallbacks;
+
+        static v8::Handle<v8::Value> AddTimer(const v8::Arguments &args, bool repeat);
+        void Deliver(v8::Handle<v8::Array> events);
+        void Call(v8::Handle<v8::Array> callbacks, v8::Handle<v8::Array> arguments,
+                  v8::Handle<v8::Array> ids = v8::Handle<v8::Array>());
+        void Cleared(bool frame, int id);
+        void DisposeTimer(ScriptTimer *timer);
+        uint64_t Tick(double time) const;
+
+        Runtime *runtime_;
+        TimerWheel wheel_;
+        TimerMap timers_;
+        int next_timer_;
+        FrameCallbacks frame_callbacks_;
+        int next_frame_callback_;
+        std::vector<TimerWheel::Timer *> expired_;
+        std::vector<Event> batch_;
+        v8::Persistent<v8::Function> trampoline_;
+        // Ids cleared while a batch of timers, or of frame callbacks, runs.
+        v8::Persistent<v8::Object> cleared_;
+        bool running_frame_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_EVENT_LOOP_H_
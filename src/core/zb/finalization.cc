@@ -0,0 +1,58 @@
+//
+//  finalization.cc
+//  zb
+//
+//  Created by  on 12/03/08.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <chrono>
+
+#include "finalization.h"
+
+zb::FinalizationRegistry::FinalizationRegistry()
+{
+    stats_.finalized = 0;
+    stats_.batches = 0;
+    stats_.total_ms = 0;
+    stats_.max_ms = 0;
+}
+
+void zb::FinalizationRegistry::Defer(v8::Persistent<v8::Value> handle, void *native, Finalizer finalizer)
+{
+    Entry entry = { handle, native, finalizer };
+    incoming_.push_back(entry);
+}
+
+// Called from the GC epilogue, after V8 has run every weak callback of the
+// collection.
+void zb::FinalizationRegistry::Seal()
+{
+    ready_.insert(ready_.end(), incoming_.begin(), incoming_.end());
+    incoming_.clear();
+}
+
+// Releases every sealed entry. Finalizers may trigger a GC that defers
+// more entries; those wait for the next flush.
+int zb::FinalizationRegistry::Flush()
+{
+    if (ready_.empty()) {
+        return 0;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    flushing_.swap(ready_);
+    for (size_t i = 0; i < flushing_.size(); i++) {
+        flushing_[i].finalizer(flushing_[i].handle, flushing_[i].native);
+    }
+    int count = static_cast<int>(flushing_.size());
+    flushing_.clear();
+    
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats_.finalized += count;
+    stats_.batches++;
+    stats_.total_ms += ms;
+    if (ms > stats_.max_ms) {
+        stats_.max_ms = ms;
+    }
+    return count;
+}
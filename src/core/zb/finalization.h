@@ -0,0 +1,56 @@
+//
+//  finalization.h
+//  zb
+//
+//  Created by  on 12/03/08.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_FINALIZATION_H_
+#define ZB_FINALIZATION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "v8.h"
+
+namespace zb {
+    // Keeps native releases out of GC pauses. Weak callbacks only Defer
+    // their object; the GC epilogue seals what one collection produced
+    // into the ready batch, and Flush releases ready batches together when
+    // the runtime has an idle slot, or at a commit once many are waiting.
+    class FinalizationRegistry {
+    public:
+        // Runs at flush time. handle is empty when the weak callback
+        // already disposed it, or strong when it kept the wrapper alive.
+        typedef void (*Finalizer)(v8::Persistent<v8::Value> handle, void *native);
+        
+        struct Stats {
+            int64_t finalized;
+            int64_t batches;
+            double total_ms;
+            double max_ms;
+        };
+        
+        FinalizationRegistry();
+        void Defer(v8::Persistent<v8::Value> handle, void *native, Finalizer finalizer);
+        void Seal();
+        int Flush();
+        size_t pending() const { return incoming_.size() + ready_.size(); }
+        const Stats &stats() const { return stats_; }
+    private:
+        struct Entry {
+            v8::Persistent<v8::Value> handle;
+            void *native;
+            Finalizer finalizer;
+        };
+        
+        std::vector<Entry> incoming_;
+        std::vector<Entry> ready_;
+        std::vector<Entry> flushing_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_FINALIZATION_H_
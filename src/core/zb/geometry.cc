@@ -0,0 +1,202 @@
+//
+//  geometry.cc
+//  zb
+//
+//  Created by  on 12/02/28.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "geometry.h"
+
+using namespace v8;
+
+static const int kInitialCapacity = 64;
+
+zb::GeometryBuffer::GeometryBuffer()
+    : data_(NULL), committed_(NULL), capacity_(0), marked_(NULL), exposed_(false)
+{
+    Grow();
+}
+
+zb::GeometryBuffer::~GeometryBuffer()
+{
+    free(data_);
+    free(committed_);
+    free(marked_);
+}
+
+void zb::GeometryBuffer::Dispose()
+{
+    object_.Dispose();
+    object_.Clear();
+    marks_.Dispose();
+    marks_.Clear();
+}
+
+int zb::GeometryBuffer::Allocate(NativeView native, const Frame &frame, float alpha)
+{
+    int slot;
+    if (!free_.empty()) {
+        slot = free_.back();
+        free_.pop_back();
+        natives_[slot] = native;
+    } else {
+        if (high_water() == capacity_) {
+            Grow();
+        }
+        slot = high_water();
+        natives_.push_back(native);
+    }
+    Reset(slot, frame, alpha);
+    return slot;
+}
+
+// Sets both the model and the committed copy, for state the backend
+// already has.
+void zb::GeometryBuffer::Reset(int slot, const Frame &frame, float alpha)
+{
+    float *values = At(slot);
+    values[kX] = frame.x;
+    values[kY] = frame.y;
+    values[kWidth] = frame.width;
+    values[kHeight] = frame.height;
+    values[kAlpha] = alpha;
+    memcpy(&committed_[slot * kStride], values, kStride * sizeof(float));
+}
+
+// Like Reset for a single field, for a value the backend will reach on its
+// own, such as the end of an animation.
+void zb::GeometryBuffer::Settle(int slot, int field, float value)
+{
+    At(slot)[field] = value;
+    committed_[slot * kStride + field] = value;
+}
+
+void zb::GeometryBuffer::Release(int slot)
+{
+    natives_[slot] = NULL;
+    free_.push_back(slot);
+}
+
+void zb::GeometryBuffer::MarkDirty(int slot)
+{
+    if (!marked_[slot]) {
+        marked_[slot] = 1;
+        dirty_.push_back(slot);
+    }
+}
+
+bool zb::GeometryBuffer::HasPending() const
+{
+    return !dirty_.empty() || (exposed_ && NextMarked(0) < capacity_);
+}
+
+// Once scripts can mark slots themselves the list misses some, so the
+// flags are scanned instead, eight slots per load; setters mark both.
+void zb::GeometryBuffer::Commit(Backend *backend)
+{
+    if (exposed_) {
+        for (int slot = NextMarked(0); slot < capacity_; slot = NextMarked(slot + 1)) {
+            if (slot < high_water() && natives_[slot] != NULL) {
+                CommitSlot(slot, backend);
+            }
+            marked_[slot] = 0;
+        }
+    } else {
+        for (size_t i = 0; i < dirty_.size(); i++) {
+            int slot = dirty_[i];
+            if (natives_[slot] != NULL) {
+                CommitSlot(slot, backend);
+            }
+            marked_[slot] = 0;
+        }
+    }
+    dirty_.clear();
+}
+
+// The first marked slot from |slot| on, or capacity_. The capacity is a
+// multiple of eight, so unmarked runs are skipped a word at a time.
+int zb::GeometryBuffer::NextMarked(int slot) const
+{
+    while (slot < capacity_) {
+        if (slot % 8 == 0) {
+            uint64_t word;
+            memcpy(&word, &marked_[slot], sizeof(word));
+            if (word == 0) {
+                slot += 8;
+                continue;
+            }
+        }
+        if (marked_[slot]) {
+            return slot;
+        }
+        slot++;
+    }
+    return capacity_;
+}
+
+// Pushes whatever changed in the slot since its last commit: at most one
+// frame write and one alpha write.
+void zb::GeometryBuffer::CommitSlot(int slot, Backend *backend)
+{
+    float *values = At(slot);
+    float *committed = &committed_[slot * kStride];
+    if (memcmp(values, committed, kAlpha * sizeof(float)) != 0) {
+        Frame frame = { values[kX], values[kY], values[kWidth], values[kHeight] };
+        backend->SetFrame(natives_[slot], frame);
+    }
+    if (values[kAlpha] != committed[kAlpha]) {
+        backend->SetAlpha(natives_[slot], values[kAlpha]);
+    }
+    memcpy(committed, values, kStride * sizeof(float));
+}
+
+// Returns the script-visible view of the buffer, with its dirty flags.
+v8::Handle<v8::Object> zb::GeometryBuffer::Expose()
+{
+    if (object_.IsEmpty()) {
+        v8::HandleScope handle_scope;
+        v8::Local<v8::Object> object = v8::Object::New();
+        object->Set(v8::String::New("stride"), v8::Integer::New(kStride), v8::ReadOnly);
+        object->Set(v8::String::New("X"), v8::Integer::New(kX), v8::ReadOnly);
+        object->Set(v8::String::New("Y"), v8::Integer::New(kY), v8::ReadOnly);
+        object->Set(v8::String::New("WIDTH"), v8::Integer::New(kWidth), v8::ReadOnly);
+        object->Set(v8::String::New("HEIGHT"), v8::Integer::New(kHeight), v8::ReadOnly);
+        object->Set(v8::String::New("ALPHA"), v8::Integer::New(kAlpha), v8::ReadOnly);
+        v8::Local<v8::Object> marks = v8::Object::New();
+        object->Set(v8::String::New("dirty"), marks, static_cast<v8::PropertyAttribute>(v8::ReadOnly | v8::DontDelete));
+        object_ = v8::Persistent<v8::Object>::New(object);
+        marks_ = v8::Persistent<v8::Object>::New(marks);
+        Bind();
+    }
+    exposed_ = true;
+    return object_;
+}
+
+void zb::GeometryBuffer::Grow()
+{
+    int old_capacity = capacity_;
+    capacity_ = capacity_ == 0 ? kInitialCapacity : capacity_ * 2;
+    data_ = static_cast<float *>(realloc(data_, capacity_ * kStride * sizeof(float)));
+    committed_ = static_cast<float *>(realloc(committed_, capacity_ * kStride * sizeof(float)));
+    marked_ = static_cast<unsigned char *>(realloc(marked_, capacity_));
+    memset(&marked_[old_capacity], 0, capacity_ - old_capacity);
+    Bind();
+}
+
+// Growing moves the storage, so the script-visible objects are pointed at
+// the new blocks; scripts keep using the same objects.
+void zb::GeometryBuffer::Bind()
+{
+    if (object_.IsEmpty()) {
+        return;
+    }
+    object_->SetIndexedPropertiesToExternalArrayData(data_, v8::kExternalFloatArray, capacity_ * kStride);
+    object_->Set(v8::String::New("length"), v8::Integer::New(capacity_ * kStride));
+    marks_->SetIndexedPropertiesToExternalArrayData(marked_, v8::kExternalUnsignedByteArray, capacity_);
+    marks_->Set(v8::String::New("length"), v8::Integer::New(capacity_));
+}
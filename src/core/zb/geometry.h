@@ -0,0 +1,73 @@
+//
+//  geometry.h
+//  zb
+//
+//  Created by  on 12/02/28.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_GEOMETRY_H_
+#define ZB_GEOMETRY_H_
+
+#include <vector>
+
+#include "v8.h"
+#include "backend.h"
+
+namespace zb {
+    // Geometry of every live view in one float array, kStride floats per
+    // view. Scripts see the same memory as the external array `Geometry`,
+    // so bulk layout code can read and write it without accessor calls.
+    // A second copy holds what the backend last received; commits diff
+    // against it, visiting only marked slots. Setters mark their slot;
+    // scripts writing the array directly mark it in `Geometry.dirty`, one
+    // byte per slot, since stores to an external array cannot be seen:
+    //
+    //   Geometry[view.slot * Geometry.stride + Geometry.X] = 10;
+    //   Geometry.dirty[view.slot] = 1;
+    class GeometryBuffer {
+    public:
+        enum {
+            kX,
+            kY,
+            kWidth,
+            kHeight,
+            kAlpha,
+            kStride
+        };
+        
+        GeometryBuffer();
+        ~GeometryBuffer();
+        int Allocate(NativeView native, const Frame &frame, float alpha);
+        void Release(int slot);
+        void Reset(int slot, const Frame &frame, float alpha);
+        void Settle(int slot, int field, float value);
+        float *At(int slot) { return &data_[slot * kStride]; }
+        NativeView native(int slot) const { return natives_[slot]; }
+        int high_water() const { return static_cast<int>(natives_.size()); }
+        void MarkDirty(int slot);
+        bool HasPending() const;
+        void Commit(Backend *backend);
+        
+        v8::Handle<v8::Object> Expose();
+        void Dispose();
+    private:
+        int NextMarked(int slot) const;
+        void CommitSlot(int slot, Backend *backend);
+        void Grow();
+        void Bind();
+        
+        float *data_;
+        float *committed_;
+        int capacity_;
+        std::vector<NativeView> natives_;
+        unsigned char *marked_;
+        std::vector<int> dirty_;
+        std::vector<int> free_;
+        bool exposed_;
+        v8::Persistent<v8::Object> object_;
+        v8::Persistent<v8::Object> marks_;
+    };
+}
+
+#endif  // ZB_GEOMETRY_H_
@@ -0,0 +1,31 @@
+//
+//  invoke.cc
+//  zb
+//
+//  Created by  on 12/02/01.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "invoke.h"
+#include "log_channel.h"
+#include "runtime.h"
+
+using namespace v8;
+
+uint32_t zb::Invoke::Plus(uint32_t a, uint32_t b)
+{
+    return a + b;
+}
+
+// Log at info level on the shared channel. The template's data, if any,
+// is the rate limiter of the runtime or worker thread it belongs to.
+v8::Handle<v8::Value> zb::Invoke::Print(const v8::Arguments& args) {
+    LogRateLimiter *limiter = NULL;
+    if (args.Data()->IsExternal()) {
+        limiter = static_cast<LogRateLimiter *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    }
+    if (!Runtime::LogArguments(args, LogChannel::Shared(), LogChannel::kInfo, limiter)) {
+        return v8::Handle<v8::Value>();
+    }
+    return v8::Undefined();
+}
@@ -1,21 +1,23 @@
 //
-//  script.h
+//  invoke.h
 //  zb
 //
 //  Created by  on 12/02/01.
 //  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
 //
 
+#ifndef ZB_INVOKE_H_
+#define ZB_INVOKE_H_
+
 #include "v8.h"
 #include "v8stdint.h"
 
 namespace zb {
     class Invoke {
     public:
-        static bool Run(NSString *script);
-        static v8::Handle<v8::Value> Plus(const v8::Arguments& args);
-        static v8::Local<v8::Value> hoge_Constructor(const v8::Arguments& args);
+        static uint32_t Plus(uint32_t a, uint32_t b);
         static v8::Handle<v8::Value> Print(const v8::Arguments& args);
     };
-    
 }
+
+#endif  // ZB_INVOKE_H_
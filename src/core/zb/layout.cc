@@ -0,0 +1,169 @@
+//
+//  layout.cc
+//  zb
+//
+//  Created by  on 12/03/10.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+
+#include "layout.h"
+#include "shadow_tree.h"
+
+bool zb::LayoutStyle::operator==(const LayoutStyle &other) const
+{
+    return direction == other.direction && justify == other.justify && align == other.align &&
+        grow == other.grow && width == other.width && height == other.height &&
+        padding == other.padding && margin == other.margin;
+}
+
+zb::LayoutStyle zb::DefaultLayoutStyle()
+{
+    LayoutStyle style;
+    style.direction = kFlexNone;
+    style.justify = kAlignStart;
+    style.align = kAlignStretch;
+    style.grow = 0;
+    style.width = kLayoutAuto;
+    style.height = kLayoutAuto;
+    style.padding = 0;
+    style.margin = 0;
+    return style;
+}
+
+zb::LayoutEngine::LayoutEngine(Backend *backend)
+    : backend_(backend)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+void zb::LayoutEngine::Layout(ShadowNode *root)
+{
+    stats_.passes++;
+    if (root->dirty || root->dirty_descendant ||
+        root->frame.width != root->layout_width || root->frame.height != root->layout_height) {
+        LayoutNode(root);
+    }
+}
+
+void zb::LayoutEngine::LayoutNode(ShadowNode *node)
+{
+    bool resized = node->frame.width != node->layout_width || node->frame.height != node->layout_height;
+    if (node->style.direction != kFlexNone && (node->dirty || resized)) {
+        LayoutChildren(node);
+        stats_.containers++;
+    }
+    node->layout_width = node->frame.width;
+    node->layout_height = node->frame.height;
+    node->dirty = false;
+    node->dirty_descendant = false;
+
+    for (size_t i = 0; i < node->children.size(); i++) {
+        ShadowNode *child = node->children[i];
+        if (child->dirty || child->dirty_descendant ||
+            child->frame.width != child->layout_width || child->frame.height != child->layout_height) {
+            LayoutNode(child);
+        }
+    }
+}
+
+// A single line of children along the main axis: fixed sizes first, then
+// any space left is shared by flex grow or spread by justifyContent.
+// Children never shrink; a line that does not fit overflows.
+void zb::LayoutEngine::LayoutChildren(ShadowNode *node)
+{
+    const LayoutStyle &style = node->style;
+    bool row = style.direction == kFlexRow;
+    float inner_main = (row ? node->frame.width : node->frame.height) - 2 * style.padding;
+    float inner_cross = (row ? node->frame.height : node->frame.width) - 2 * style.padding;
+    if (inner_main < 0) {
+        inner_main = 0;
+    }
+    if (inner_cross < 0) {
+        inner_cross = 0;
+    }
+
+    size_t count = node->children.size();
+    sizes_.resize(count);
+    float used = 0;
+    float grow = 0;
+    for (size_t i = 0; i < count; i++) {
+        const LayoutStyle &child = node->children[i]->style;
+        float size = row ? child.width : child.height;
+        sizes_[i] = size < 0 ? 0 : size;
+        used += sizes_[i] + 2 * child.margin;
+        if (child.grow > 0) {
+            grow += child.grow;
+        }
+    }
+
+    float free = inner_main - used;
+    float offset = style.padding;
+    float gap = 0;
+    if (free > 0 && grow > 0) {
+        for (size_t i = 0; i < count; i++) {
+            float child_grow = node->children[i]->style.grow;
+            if (child_grow > 0) {
+                sizes_[i] += free * child_grow / grow;
+            }
+        }
+    } else if (free > 0) {
+        switch (style.justify) {
+            case kAlignCenter:
+                offset += free / 2;
+                break;
+            case kAlignEnd:
+                offset += free;
+                break;
+            case kAlignSpaceBetween:
+                if (count > 1) {
+                    gap = free / (count - 1);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ShadowNode *child = node->children[i];
+        float margin = child->style.margin;
+        float size = row ? child->style.height : child->style.width;
+        float cross = size;
+        if (size < 0) {
+            cross = style.align == kAlignStretch && inner_cross > 2 * margin ? inner_cross - 2 * margin : 0;
+        }
+        float cross_offset = style.padding + margin;
+        if (style.align == kAlignCenter) {
+            cross_offset += (inner_cross - 2 * margin - cross) / 2;
+        } else if (style.align == kAlignEnd) {
+            cross_offset += inner_cross - 2 * margin - cross;
+        }
+
+        float main_offset = offset + margin;
+        Frame frame;
+        if (row) {
+            frame.x = main_offset;
+            frame.y = cross_offset;
+            frame.width = sizes_[i];
+            frame.height = cross;
+        } else {
+            frame.x = cross_offset;
+            frame.y = main_offset;
+            frame.width = cross;
+            frame.height = sizes_[i];
+        }
+        SetFrame(child, frame);
+        offset = main_offset + sizes_[i] + margin + gap;
+    }
+}
+
+void zb::LayoutEngine::SetFrame(ShadowNode *node, const Frame &frame)
+{
+    if (!SameFrame(node->frame, frame)) {
+        node->frame = frame;
+        backend_->SetFrame(node->native, frame);
+        stats_.frames++;
+    }
+}
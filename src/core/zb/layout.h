@@ -0,0 +1,86 @@
+//
+//  layout.h
+//  zb
+//
+//  Created by  on 12/03/10.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_LAYOUT_H_
+#define ZB_LAYOUT_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "backend.h"
+
+namespace zb {
+    struct ShadowNode;
+
+    enum FlexDirection {
+        kFlexNone,
+        kFlexRow,
+        kFlexColumn
+    };
+
+    enum FlexAlign {
+        kAlignStart,
+        kAlignCenter,
+        kAlignEnd,
+        kAlignStretch,
+        kAlignSpaceBetween
+    };
+
+    // Sizes below zero mean auto: the main axis size comes from flex, the
+    // cross axis size from alignItems: 'stretch'. There is no intrinsic
+    // content size, so an auto view that neither grows nor stretches is 0.
+    const float kLayoutAuto = -1;
+
+    struct LayoutStyle {
+        FlexDirection direction;
+        FlexAlign justify;
+        FlexAlign align;
+        float grow;
+        float width;
+        float height;
+        float padding;
+        float margin;
+
+        bool operator==(const LayoutStyle &other) const;
+        bool operator!=(const LayoutStyle &other) const { return !(*this == other); }
+    };
+
+    LayoutStyle DefaultLayoutStyle();
+
+    inline bool SameFrame(const Frame &a, const Frame &b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+
+    // Positions the children of flex containers in a shadow tree. Only
+    // containers marked dirty, or whose size changed since they were last
+    // laid out, are recomputed; everything else is skipped along with its
+    // subtree. Frames that change go straight to the backend.
+    class LayoutEngine {
+    public:
+        struct Stats {
+            int64_t passes;
+            int64_t containers;
+            int64_t frames;
+        };
+
+        explicit LayoutEngine(Backend *backend);
+        void Layout(ShadowNode *root);
+        const Stats &stats() const { return stats_; }
+    private:
+        void LayoutNode(ShadowNode *node);
+        void LayoutChildren(ShadowNode *node);
+        void SetFrame(ShadowNode *node, const Frame &frame);
+
+        Backend *backend_;
+        std::vector<float> sizes_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_LAYOUT_H_
@@ -0,0 +1,235 @@
+//
+//  log_channel.cc
+//  zb
+//
+//  Created by  on 12/03/13.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "log_channel.h"
+
+namespace {
+    const size_t kBufferSize = 64 * 1024;
+    
+    const char *const kLevelPrefixes[] = { "[debug] ", "", "[warning] ", "[error] " };
+    
+    void WriteToStdout(void *data, const char *text, size_t length)
+    {
+        fwrite(text, 1, length, stdout);
+        fflush(stdout);
+    }
+    
+    double Now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+zb::LogChannel::LogChannel(size_t capacity)
+    : ring_(capacity), level_(kDebug), written_(0), dropped_(0), suppressed_(0), batches_(0),
+      reported_dropped_(0), reported_suppressed_(0), sink_(WriteToStdout), sink_data_(NULL),
+      stopping_(false), buffer_(new char[kBufferSize])
+{
+}
+
+zb::LogChannel::~LogChannel()
+{
+    Stop();
+    Drain();
+    delete[] buffer_;
+}
+
+// Shared by every runtime in the process; its writer starts on first use
+// and prints to stdout until the host sets a sink.
+zb::LogChannel *zb::LogChannel::Shared()
+{
+    static LogChannel shared;
+    static std::once_flag once;
+    std::call_once(once, [] { shared.Start(); });
+    return &shared;
+}
+
+// A NULL sink puts back the default, stdout.
+void zb::LogChannel::SetSink(Sink sink, void *data)
+{
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    sink_ = sink != NULL ? sink : WriteToStdout;
+    sink_data_ = data;
+}
+
+void zb::LogChannel::Start()
+{
+    if (!thread_.joinable()) {
+        stopping_ = false;
+        thread_ = std::thread(&LogChannel::Main, this);
+    }
+}
+
+void zb::LogChannel::Stop()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+// Writes out everything logged so far on the calling thread, for hosts
+// that need the log in order with their own output.
+void zb::LogChannel::Flush()
+{
+    Drain();
+}
+
+// Safe from any thread and never blocks. Messages longer than
+// kMaxMessage are cut.
+bool zb::LogChannel::Write(Level level, const char *message, size_t length)
+{
+    if (!IsEnabled(level)) {
+        return false;
+    }
+    Record record;
+    record.level = level;
+    record.length = static_cast<uint16_t>(length < static_cast<size_t>(kMaxMessage) ? length : static_cast<size_t>(kMaxMessage));
+    memcpy(record.text, message, record.length);
+    if (!ring_.Push(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // The writer polls anyway; only hurry it when the ring fills up.
+    if (ring_.size() > ring_.capacity() / 2) {
+        wake_.notify_one();
+    }
+    return true;
+}
+
+zb::LogChannel::Stats zb::LogChannel::stats() const
+{
+    Stats stats;
+    stats.written = written_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.suppressed = suppressed_.load(std::memory_order_relaxed);
+    stats.batches = batches_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void zb::LogChannel::Main()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wake_.wait_for(lock, std::chrono::milliseconds(10));
+        lock.unlock();
+        Drain();
+        lock.lock();
+    }
+}
+
+// Formats whatever is in the ring into lines and hands them to the sink,
+// one call per buffer-full, followed by a line for any new drops.
+void zb::LogChannel::Drain()
+{
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    size_t used = 0;
+    int64_t written = 0;
+    Record record;
+    while (ring_.Pop(&record)) {
+        const char *prefix = kLevelPrefixes[record.level];
+        size_t prefix_length = strlen(prefix);
+        if (used + prefix_length + record.length + 1 > kBufferSize) {
+            sink_(sink_data_, buffer_, used);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            used = 0;
+        }
+        memcpy(buffer_ + used, prefix, prefix_length);
+        used += prefix_length;
+        memcpy(buffer_ + used, record.text, record.length);
+        used += record.length;
+        buffer_[used++] = '\n';
+        written++;
+    }
+    
+    int64_t dropped = dropped_.load(std::memory_order_relaxed);
+    int64_t suppressed = suppressed_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_ || suppressed != reported_suppressed_) {
+        char line[96];
+        size_t length = snprintf(line, sizeof(line), "[log] %lld dropped, %lld rate limited\n",
+                                 static_cast<long long>(dropped - reported_dropped_),
+                                 static_cast<long long>(suppressed - reported_suppressed_));
+        if (length >= sizeof(line)) {
+            length = sizeof(line) - 1;
+        }
+        if (used + length > kBufferSize) {
+            sink_(sink_data_, buffer_, used);
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            used = 0;
+        }
+        memcpy(buffer_ + used, line, length);
+        used += length;
+        reported_dropped_ = dropped;
+        reported_suppressed_ = suppressed;
+    }
+    if (used > 0) {
+        sink_(sink_data_, buffer_, used);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+    }
+    written_.fetch_add(written, std::memory_order_relaxed);
+}
+
+zb::LogRateLimiter::LogRateLimiter(double burst, double rate)
+    : burst_(burst), rate_(rate)
+{
+    shared_.tokens = burst;
+    shared_.updated = Now();
+}
+
+// A rate of zero turns limiting off.
+void zb::LogRateLimiter::Configure(double burst, double rate)
+{
+    burst_ = burst;
+    rate_ = rate;
+    shared_.tokens = burst;
+    shared_.updated = Now();
+    buckets_.clear();
+}
+
+bool zb::LogRateLimiter::AllowAny()
+{
+    return rate_ <= 0 || Take(&shared_, Now());
+}
+
+bool zb::LogRateLimiter::Allow(uint64_t site)
+{
+    if (rate_ <= 0) {
+        return true;
+    }
+    double now = Now();
+    std::unordered_map<uint64_t, Bucket>::iterator it = buckets_.find(site);
+    if (it == buckets_.end()) {
+        Bucket bucket = { burst_ - 1, now };
+        buckets_[site] = bucket;
+        return true;
+    }
+    return Take(&it->second, now);
+}
+
+bool zb::LogRateLimiter::Take(Bucket *bucket, double now)
+{
+    bucket->tokens += (now - bucket->updated) * rate_;
+    if (bucket->tokens > burst_) {
+        bucket->tokens = burst_;
+    }
+    bucket->updated = now;
+    if (bucket->tokens < 1) {
+        return false;
+    }
+    bucket->tokens -= 1;
+    return true;
+}
@@ -0,0 +1,123 @@
+//
+//  log_channel.h
+//  zb
+//
+//  Created by  on 12/03/13.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_LOG_CHANNEL_H_
+#define ZB_LOG_CHANNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "ring.h"
+
+namespace zb {
+    // Log messages from any thread go into a lock-free ring of fixed-size
+    // records and a background writer hands them to the sink in batches,
+    // so logging never waits on I/O. Messages below the level are dropped
+    // before they are copied; a full ring drops and counts instead of
+    // blocking, and the writer reports drops in the log itself.
+    class LogChannel {
+    public:
+        enum Level {
+            kDebug,
+            kInfo,
+            kWarning,
+            kError
+        };
+        
+        enum { kMaxMessage = 240 };
+        
+        // Gets whole lines, several at a time. Runs on the writer thread,
+        // or on the thread calling Flush.
+        typedef void (*Sink)(void *data, const char *text, size_t length);
+        
+        struct Stats {
+            int64_t written;
+            int64_t dropped;
+            int64_t suppressed;
+            int64_t batches;
+        };
+        
+        explicit LogChannel(size_t capacity = 1024);
+        ~LogChannel();
+        void SetSink(Sink sink, void *data);
+        void Start();
+        void Stop();
+        void Flush();
+        bool Write(Level level, const char *message, size_t length);
+        void CountSuppressed(int count) { suppressed_.fetch_add(count, std::memory_order_relaxed); }
+        bool IsEnabled(Level level) const { return level >= level_.load(std::memory_order_relaxed); }
+        void set_level(Level level) { level_.store(level, std::memory_order_relaxed); }
+        Stats stats() const;
+        
+        static LogChannel *Shared();
+    private:
+        struct Record {
+            Level level;
+            uint16_t length;
+            char text[kMaxMessage];
+        };
+        
+        void Main();
+        void Drain();
+        
+        MpscRing<Record> ring_;
+        std::atomic<int> level_;
+        std::atomic<int64_t> written_;
+        std::atomic<int64_t> dropped_;
+        std::atomic<int64_t> suppressed_;
+        std::atomic<int64_t> batches_;
+        int64_t reported_dropped_;
+        int64_t reported_suppressed_;
+        Sink sink_;
+        void *sink_data_;
+        std::mutex drain_mutex_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::thread thread_;
+        bool stopping_;
+        char *buffer_;
+    };
+    
+    // Token bucket per call site: each site may log |burst| messages at
+    // once and |rate| per second after that. Not thread-safe; every
+    // runtime keeps its own.
+    //
+    // Finding the call site costs a stack capture, so callers first ask
+    // AllowAny, a bucket shared by all sites with the same limits: while
+    // the runtime as a whole logs within one site's budget, no site can
+    // be over its own. Only once it runs dry is the site looked up and
+    // passed to Allow. A site can so log up to one extra burst, and the
+    // shared rate, on top of its own.
+    class LogRateLimiter {
+    public:
+        LogRateLimiter(double burst = 20, double rate = 10);
+        bool AllowAny();
+        bool Allow(uint64_t site);
+        bool enabled() const { return rate_ > 0; }
+        void Configure(double burst, double rate);
+    private:
+        struct Bucket {
+            double tokens;
+            double updated;
+        };
+        
+        bool Take(Bucket *bucket, double now);
+        
+        double burst_;
+        double rate_;
+        Bucket shared_;
+        std::unordered_map<uint64_t, Bucket> buckets_;
+    };
+}
+
+#endif  // ZB_LOG_CHANNEL_H_
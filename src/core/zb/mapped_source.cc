@@ -0,0 +1,46 @@
+//
+//  mapped_source.cc
+//  zb
+//
+//  Created by  on 12/03/07.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_source.h"
+
+zb::MappedSource *zb::MappedSource::Open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void *address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return NULL;
+    }
+    const char *data = static_cast<const char *>(address);
+    for (size_t i = 0; i < length; i++) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80) {
+            munmap(address, length);
+            return NULL;
+        }
+    }
+    return new MappedSource(data, length);
+}
+
+zb::MappedSource::~MappedSource()
+{
+    munmap(const_cast<char *>(data_), length_);
+}
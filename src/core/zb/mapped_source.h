@@ -0,0 +1,37 @@
+//
+//  mapped_source.h
+//  zb
+//
+//  Created by  on 12/03/07.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_MAPPED_SOURCE_H_
+#define ZB_MAPPED_SOURCE_H_
+
+#include <stddef.h>
+
+#include "v8.h"
+
+namespace zb {
+    // A script file mapped read-only and handed to V8 as an external ASCII
+    // string, so large bundles cost no heap copy and no transcoding. V8
+    // owns it once the string is created and unmaps it when the string
+    // dies.
+    class MappedSource : public v8::String::ExternalAsciiStringResource {
+    public:
+        // NULL if the file cannot be mapped, is empty or is not pure
+        // ASCII; callers fall back to reading it into a heap string.
+        static MappedSource *Open(const char *path);
+        virtual ~MappedSource();
+        virtual const char *data() const { return data_; }
+        virtual size_t length() const { return length_; }
+    private:
+        MappedSource(const char *data, size_t length) : data_(data), length_(length) {}
+        
+        const char *data_;
+        size_t length_;
+    };
+}
+
+#endif  // ZB_MAPPED_SOURCE_H_
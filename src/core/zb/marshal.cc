@@ -0,0 +1,407 @@
+//
+//  marshal.cc
+//  zb
+//
+//  Created by  on 12/03/17.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "marshal.h"
+#include "binding.h"
+#include "structured_clone.h"
+
+namespace {
+    // Owns the characters of a long ASCII string for as long as V8 keeps
+    // the string.
+    class OwnedAsciiString : public v8::String::ExternalAsciiStringResource {
+    public:
+        explicit OwnedAsciiString(std::string *value) { data_.swap(*value); }
+        virtual const char *data() const { return data_.data(); }
+        virtual size_t length() const { return data_.size(); }
+    private:
+        std::string data_;
+    };
+
+    bool IsASCII(const std::string &value)
+    {
+        for (size_t i = 0; i < value.size(); i++) {
+            if (static_cast<unsigned char>(value[i]) >= 0x80) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Keys the factory cannot express: "__proto__" in a literal sets the
+    // prototype instead of making a property.
+    bool IsProtoKey(const std::string &key)
+    {
+        return key == "__proto__";
+    }
+
+    bool FieldLess(const zb::Variant::Field &a, const zb::Variant::Field &b)
+    {
+        return a.first < b.first;
+    }
+
+    double ExternalElement(const void *data, v8::ExternalArrayType type, int index)
+    {
+        switch (type) {
+            case v8::kExternalByteArray:
+                return static_cast<const int8_t *>(data)[index];
+            case v8::kExternalUnsignedByteArray:
+            case v8::kExternalPixelArray:
+                return static_cast<const uint8_t *>(data)[index];
+            case v8::kExternalShortArray:
+                return static_cast<const int16_t *>(data)[index];
+            case v8::kExternalUnsignedShortArray:
+                return static_cast<const uint16_t *>(data)[index];
+            case v8::kExternalIntArray:
+                return static_cast<const int32_t *>(data)[index];
+            case v8::kExternalUnsignedIntArray:
+                return static_cast<const uint32_t *>(data)[index];
+            case v8::kExternalFloatArray:
+                return static_cast<const float *>(data)[index];
+            case v8::kExternalDoubleArray:
+                return static_cast<const double *>(data)[index];
+        }
+        return 0;
+    }
+}
+
+zb::Variant *zb::Variant::Set(const std::string &key)
+{
+    Field field(key, Variant());
+    std::vector<Field>::iterator it = std::lower_bound(fields_.begin(), fields_.end(), field, FieldLess);
+    if (it == fields_.end() || it->first != key) {
+        it = fields_.insert(it, field);
+    }
+    return &it->second;
+}
+
+const zb::Variant *zb::Variant::Get(const std::string &key) const
+{
+    Field field(key, Variant());
+    std::vector<Field>::const_iterator it = std::lower_bound(fields_.begin(), fields_.end(), field, FieldLess);
+    return it != fields_.end() && it->first == key ? &it->second : NULL;
+}
+
+zb::Marshaller::Marshaller()
+    : error_(NULL)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+zb::Marshaller::~Marshaller()
+{
+}
+
+void zb::Marshaller::Dispose()
+{
+    for (ShapeMap::iterator it = shapes_.begin(); it != shapes_.end(); ++it) {
+        it->second.Dispose();
+    }
+    shapes_.clear();
+    for (SymbolMap::iterator it = symbols_.begin(); it != symbols_.end(); ++it) {
+        it->second.Dispose();
+    }
+    symbols_.clear();
+    array_factory_.Dispose();
+    array_factory_.Clear();
+}
+
+v8::Handle<v8::Value> zb::Marshaller::ToV8(Variant *value)
+{
+    switch (value->type_) {
+        case Variant::kUndefined:
+            return v8::Undefined();
+        case Variant::kNull:
+            return v8::Null();
+        case Variant::kBoolean:
+            return v8::Boolean::New(value->boolean());
+        case Variant::kNumber:
+            return Converter<double>::ToV8(value->number_);
+        case Variant::kString:
+            return NewString(&value->string_);
+        case Variant::kArray:
+            return NewArray(value);
+        case Variant::kObject:
+            return NewObject(value);
+        case Variant::kNumbers: {
+            size_t bytes = value->numbers_.size() * sizeof(double);
+            void *data = malloc(bytes > 0 ? bytes : 1);
+            memcpy(data, value->numbers_.data(), bytes);
+            stats_.buffers++;
+            return Buffer::Adopt(data, v8::kExternalDoubleArray, static_cast<int>(value->numbers_.size()));
+        }
+    }
+    return v8::Undefined();
+}
+
+// Once the cache is full, short strings not in it are plain strings.
+v8::Handle<v8::Value> zb::Marshaller::NewString(std::string *value)
+{
+    int length = static_cast<int>(value->size());
+    if (length <= kSymbolLength) {
+        SymbolMap::iterator it = symbols_.find(*value);
+        if (it != symbols_.end()) {
+            stats_.symbol_hits++;
+            return it->second;
+        }
+        if (symbols_.size() >= kMaxSymbols) {
+            return v8::String::New(value->data(), length);
+        }
+        v8::Local<v8::String> symbol = v8::String::NewSymbol(value->data(), length);
+        symbols_[*value] = v8::Persistent<v8::String>::New(symbol);
+        return symbol;
+    }
+    if (length >= kExternalLength && IsASCII(*value)) {
+        stats_.external_strings++;
+        return v8::String::NewExternal(new OwnedAsciiString(value));
+    }
+    return v8::String::New(value->data(), length);
+}
+
+// Elements are built onto arguments_ and handed to the factory in one
+// call; the nested values below them push and pop their own.
+v8::Handle<v8::Value> zb::Marshaller::NewArray(Variant *value)
+{
+    v8::HandleScope handle_scope;
+    std::vector<Variant> &items = value->items_;
+    int length = static_cast<int>(items.size());
+    if (length > kMaxArguments) {
+        v8::Local<v8::Array> array = v8::Array::New(length);
+        for (int i = 0; i < length; i++) {
+            array->Set(i, ToV8(&items[i]));
+        }
+        return handle_scope.Close(array);
+    }
+    if (array_factory_.IsEmpty()) {
+        const char source[] =
+            "(function () {\n"
+            "    var length = arguments.length, array = new Array(length);\n"
+            "    for (var i = 0; i < length; i++) {\n"
+            "        array[i] = arguments[i];\n"
+            "    }\n"
+            "    return array;\n"
+            "})";
+        v8::Local<v8::Script> script = v8::Script::Compile(v8::String::New(source), v8::String::New("zb:marshal"));
+        array_factory_ = v8::Persistent<v8::Function>::New(v8::Local<v8::Function>::Cast(script->Run()));
+    }
+    size_t base = arguments_.size();
+    for (int i = 0; i < length; i++) {
+        v8::Handle<v8::Value> item = ToV8(&items[i]);
+        arguments_.push_back(item);
+    }
+    v8::Local<v8::Value> array = array_factory_->Call(v8::Context::GetCurrent()->Global(), length, length > 0 ? &arguments_[base] : NULL);
+    arguments_.resize(base);
+    return handle_scope.Close(array);
+}
+
+// Key sets past kMaxShapes or kMaxArguments keys, or with a key the
+// factory cannot express, are built property by property instead.
+v8::Handle<v8::Value> zb::Marshaller::NewObject(Variant *value)
+{
+    v8::HandleScope handle_scope;
+    std::vector<Variant::Field> &fields = value->fields_;
+    int length = static_cast<int>(fields.size());
+    stats_.objects++;
+    v8::Handle<v8::Function> factory = Factory(*value);
+    if (factory.IsEmpty()) {
+        v8::Local<v8::Object> object = v8::Object::New();
+        for (int i = 0; i < length; i++) {
+            v8::Local<v8::String> key = v8::String::NewSymbol(fields[i].first.data(), static_cast<int>(fields[i].first.size()));
+            v8::Handle<v8::Value> field = ToV8(&fields[i].second);
+            if (IsProtoKey(fields[i].first)) {
+                object->ForceSet(key, field);
+            } else {
+                object->Set(key, field);
+            }
+        }
+        return handle_scope.Close(object);
+    }
+    size_t base = arguments_.size();
+    for (int i = 0; i < length; i++) {
+        v8::Handle<v8::Value> field = ToV8(&fields[i].second);
+        arguments_.push_back(field);
+    }
+    v8::Local<v8::Value> object = factory->Call(v8::Context::GetCurrent()->Global(), length, length > 0 ? &arguments_[base] : NULL);
+    arguments_.resize(base);
+    return handle_scope.Close(object);
+}
+
+// function (a0, a1, ...) { return { "key0": a0, "key1": a1, ... }; }
+v8::Handle<v8::Function> zb::Marshaller::Factory(const Variant &value)
+{
+    const std::vector<Variant::Field> &fields = value.fields_;
+    if (fields.size() > kMaxArguments) {
+        return v8::Handle<v8::Function>();
+    }
+    shape_key_.clear();
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (IsProtoKey(fields[i].first)) {
+            return v8::Handle<v8::Function>();
+        }
+        shape_key_.append(fields[i].first);
+        shape_key_.push_back('\0');
+    }
+    ShapeMap::iterator it = shapes_.find(shape_key_);
+    if (it != shapes_.end()) {
+        stats_.shape_hits++;
+        return it->second;
+    }
+    if (shapes_.size() >= kMaxShapes) {
+        return v8::Handle<v8::Function>();
+    }
+    std::string source("(function (");
+    for (size_t i = 0; i < fields.size(); i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%sa%d", i > 0 ? ", " : "", static_cast<int>(i));
+        source.append(name);
+    }
+    source.append(") { return {");
+    for (size_t i = 0; i < fields.size(); i++) {
+        source.append(i > 0 ? ", \"" : "\"");
+        const std::string &key = fields[i].first;
+        for (size_t j = 0; j < key.size(); j++) {
+            unsigned char c = static_cast<unsigned char>(key[j]);
+            if (c == '"' || c == '\\') {
+                source.push_back('\\');
+                source.push_back(key[j]);
+            } else if (c < 0x20) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                source.append(escape);
+            } else if (c == 0xe2 && j + 2 < key.size() && static_cast<unsigned char>(key[j + 1]) == 0x80 &&
+                       (static_cast<unsigned char>(key[j + 2]) == 0xa8 || static_cast<unsigned char>(key[j + 2]) == 0xa9)) {
+                // U+2028 and U+2029 end a line inside a string literal.
+                source.append(static_cast<unsigned char>(key[j + 2]) == 0xa8 ? "\\u2028" : "\\u2029");
+                j += 2;
+            } else {
+                source.push_back(key[j]);
+            }
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "\": a%d", static_cast<int>(i));
+        source.append(name);
+    }
+    source.append("}; })");
+    v8::HandleScope handle_scope;
+    v8::TryCatch try_catch;
+    v8::Local<v8::Script> script = v8::Script::Compile(v8::String::New(source.data(), static_cast<int>(source.size())), v8::String::New("zb:marshal"));
+    if (script.IsEmpty()) {
+        return v8::Handle<v8::Function>();
+    }
+    v8::Local<v8::Value> result = script->Run();
+    if (result.IsEmpty() || !result->IsFunction()) {
+        return v8::Handle<v8::Function>();
+    }
+    v8::Local<v8::Function> factory = v8::Local<v8::Function>::Cast(result);
+    shapes_[shape_key_] = v8::Persistent<v8::Function>::New(factory);
+    return handle_scope.Close(factory);
+}
+
+bool zb::Marshaller::FromV8(v8::Handle<v8::Value> value, Variant *out)
+{
+    v8::HandleScope handle_scope;
+    std::vector<v8::Handle<v8::Object> > stack;
+    *out = Variant();
+    error_ = NULL;
+    return FromV8(value, out, &stack);
+}
+
+bool zb::Marshaller::FromV8(v8::Handle<v8::Value> value, Variant *out, std::vector<v8::Handle<v8::Object> > *stack)
+{
+    if (value->IsUndefined()) {
+        *out = Variant();
+    } else if (value->IsNull()) {
+        *out = Variant::Null();
+    } else if (value->IsBoolean()) {
+        *out = Variant(value->IsTrue());
+    } else if (value->IsNumber() || value->IsDate()) {
+        *out = Variant(value->NumberValue());
+    } else if (value->IsString()) {
+        *out = Variant(Variant::kString);
+        Converter<std::string>::FromV8(value, &out->string_);
+    } else if (value->IsFunction()) {
+        error_ = "functions cannot be marshalled";
+        return false;
+    } else if (value->IsObject()) {
+        v8::Handle<v8::Object> object = v8::Handle<v8::Object>::Cast(value);
+        if (object->HasIndexedPropertiesInExternalArrayData()) {
+            const void *data = object->GetIndexedPropertiesExternalArrayData();
+            v8::ExternalArrayType type = object->GetIndexedPropertiesExternalArrayDataType();
+            int length = object->GetIndexedPropertiesExternalArrayDataLength();
+            *out = Variant::Numbers();
+            out->numbers_.resize(length);
+            for (int i = 0; i < length; i++) {
+                out->numbers_[i] = ExternalElement(data, type, i);
+            }
+            return true;
+        }
+        if (object->InternalFieldCount() > 0) {
+            error_ = "bridged objects cannot be marshalled";
+            return false;
+        }
+        if (stack->size() >= kMaxDepth) {
+            error_ = "value is nested too deeply to marshal";
+            return false;
+        }
+        for (size_t i = 0; i < stack->size(); i++) {
+            if ((*stack)[i]->StrictEquals(object)) {
+                error_ = "cyclic values cannot be marshalled";
+                return false;
+            }
+        }
+        stack->push_back(object);
+        if (object->IsArray()) {
+            v8::Handle<v8::Array> array = v8::Handle<v8::Array>::Cast(object);
+            *out = Variant::Array();
+            out->items_.resize(array->Length());
+            for (uint32_t i = 0; i < array->Length(); i++) {
+                v8::HandleScope handle_scope;
+                v8::Local<v8::Value> element = array->Get(i);
+                if (element.IsEmpty() || !FromV8(element, &out->items_[i], stack)) {
+                    return false;
+                }
+            }
+        } else {
+            v8::Local<v8::Array> names = object->GetOwnPropertyNames();
+            if (names.IsEmpty()) {
+                return false;
+            }
+            *out = Variant::Object();
+            out->fields_.resize(names->Length());
+            for (uint32_t i = 0; i < names->Length(); i++) {
+                v8::HandleScope handle_scope;
+                v8::Local<v8::Value> name = names->Get(i);
+                Converter<std::string>::FromV8(name, &out->fields_[i].first);
+                // A plain Get of "__proto__" reads the prototype, not the
+                // own property of that name.
+                v8::Local<v8::Value> property;
+                if (IsProtoKey(out->fields_[i].first)) {
+                    property = object->GetRealNamedProperty(name->ToString());
+                    if (property.IsEmpty()) {
+                        continue;
+                    }
+                } else {
+                    property = object->Get(name);
+                }
+                if (property.IsEmpty() || !FromV8(property, &out->fields_[i].second, stack)) {
+                    return false;
+                }
+            }
+            std::sort(out->fields_.begin(), out->fields_.end(), FieldLess);
+        }
+        stack->pop_back();
+    } else {
+        error_ = "value cannot be marshalled";
+        return false;
+    }
+    return true;
+}
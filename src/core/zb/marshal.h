@@ -0,0 +1,145 @@
+//
+//  marshal.h
+//  zb
+//
+//  Created by  on 12/03/17.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_MARSHAL_H_
+#define ZB_MARSHAL_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "v8.h"
+
+namespace zb {
+    // Structured data on the native side: what NSDictionary and NSArray
+    // payloads, or plain C++ ones on the headless backend, are turned into
+    // on their way to scripts, and what script results come back as.
+    // Object fields stay sorted by key. Numbers holds a numeric array that
+    // scripts see as a float64 Buffer.
+    class Variant {
+    public:
+        enum Type {
+            kUndefined,
+            kNull,
+            kBoolean,
+            kNumber,
+            kString,
+            kArray,
+            kObject,
+            kNumbers
+        };
+
+        typedef std::pair<std::string, Variant> Field;
+
+        Variant() : type_(kUndefined), number_(0) {}
+        explicit Variant(bool value) : type_(kBoolean), number_(value ? 1 : 0) {}
+        explicit Variant(double value) : type_(kNumber), number_(value) {}
+        explicit Variant(const std::string &value) : type_(kString), number_(0), string_(value) {}
+        explicit Variant(const char *value) : type_(kString), number_(0), string_(value) {}
+        static Variant Null() { return Variant(kNull); }
+        static Variant Array() { return Variant(kArray); }
+        static Variant Object() { return Variant(kObject); }
+        static Variant Numbers() { return Variant(kNumbers); }
+
+        Type type() const { return type_; }
+        bool boolean() const { return number_ != 0; }
+        double number() const { return number_; }
+        const std::string &string() const { return string_; }
+        std::string *mutable_string() { return &string_; }
+
+        const std::vector<Variant> &items() const { return items_; }
+        Variant *Append() { items_.push_back(Variant()); return &items_.back(); }
+
+        // The field for |key|, added as undefined if missing.
+        const std::vector<Field> &fields() const { return fields_; }
+        Variant *Set(const std::string &key);
+        const Variant *Get(const std::string &key) const;
+
+        const std::vector<double> &numbers() const { return numbers_; }
+        std::vector<double> *mutable_numbers() { return &numbers_; }
+    private:
+        friend class Marshaller;
+
+        explicit Variant(Type type) : type_(type), number_(0) {}
+
+        Type type_;
+        double number_;
+        std::string string_;
+        std::vector<Variant> items_;
+        std::vector<Field> fields_;
+        std::vector<double> numbers_;
+    };
+
+    // Builds script values straight from Variants and back, without a JSON
+    // round trip. Per isolate; use with the runtime's context entered.
+    //
+    // Each distinct key set gets a factory, a compiled function returning
+    // an object literal with those keys in sorted order. An object then
+    // costs one call and one allocation, and every object of a shape shares
+    // its hidden class. Arrays go through a factory too instead of one API
+    // call per element. Short strings come from a cache of symbols, so
+    // repeated ones are not allocated again; long ASCII strings are moved
+    // into external strings. Numbers are copied once into a Buffer.
+    class Marshaller {
+    public:
+        struct Stats {
+            int64_t objects;           // objects built
+            int64_t shape_hits;        // of those, from an existing factory
+            int64_t symbol_hits;       // strings found in the symbol cache
+            int64_t external_strings;  // strings handed over without a copy
+            int64_t buffers;           // numeric arrays
+        };
+
+        enum {
+            kMaxShapes = 256,
+            kMaxSymbols = 1024,
+            kMaxArguments = 256,
+            kSymbolLength = 24,
+            kExternalLength = 256,
+            kMaxDepth = 100
+        };
+
+        Marshaller();
+        ~Marshaller();
+        void Dispose();
+
+        // Long strings are moved out of |value|; the rest is left as it was.
+        v8::Handle<v8::Value> ToV8(Variant *value);
+
+        // Returns false for functions, bridged objects, cycles and nesting
+        // past kMaxDepth, with error() saying which, or when a getter threw;
+        // then error() is NULL and the exception is the caller's. Nothing is
+        // thrown here, since callers outside a script call could not catch
+        // it.
+        bool FromV8(v8::Handle<v8::Value> value, Variant *out);
+        const char *error() const { return error_; }
+
+        const Stats &stats() const { return stats_; }
+    private:
+        typedef std::unordered_map<std::string, v8::Persistent<v8::Function> > ShapeMap;
+        typedef std::unordered_map<std::string, v8::Persistent<v8::String> > SymbolMap;
+
+        v8::Handle<v8::Value> NewString(std::string *value);
+        v8::Handle<v8::Value> NewArray(Variant *value);
+        v8::Handle<v8::Value> NewObject(Variant *value);
+        v8::Handle<v8::Function> Factory(const Variant &value);
+        bool FromV8(v8::Handle<v8::Value> value, Variant *out, std::vector<v8::Handle<v8::Object> > *stack);
+
+        ShapeMap shapes_;
+        SymbolMap symbols_;
+        v8::Persistent<v8::Function> array_factory_;
+        std::vector<v8::Handle<v8::Value> > arguments_;
+        std::string shape_key_;
+        const char *error_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_MARSHAL_H_
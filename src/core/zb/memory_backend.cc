@@ -0,0 +1,147 @@
+//
+//  memory_backend.cc
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <algorithm>
+
+#include "memory_backend.h"
+
+zb::MemoryBackend::MemoryBackend(FILE *log)
+    : log_(log), next_id_(1)
+{
+    stats_.commits = 0;
+    stats_.created = 0;
+    stats_.destroyed = 0;
+    stats_.recycled = 0;
+    stats_.frame_writes = 0;
+    stats_.alpha_writes = 0;
+}
+
+zb::MemoryBackend::~MemoryBackend()
+{
+    for (std::map<int, MemoryView *>::iterator it = views_.begin(); it != views_.end(); ++it) {
+        delete it->second;
+    }
+}
+
+void zb::MemoryBackend::BeginCommit()
+{
+    stats_.commits++;
+}
+
+zb::NativeView zb::MemoryBackend::CreateView()
+{
+    MemoryView *view = new MemoryView();
+    view->id = next_id_++;
+    view->frame.x = 0;
+    view->frame.y = 0;
+    view->frame.width = 0;
+    view->frame.height = 0;
+    view->alpha = 1;
+    view->parent = NULL;
+    views_[view->id] = view;
+    stats_.created++;
+    return view;
+}
+
+void zb::MemoryBackend::DestroyView(NativeView native)
+{
+    MemoryView *view = static_cast<MemoryView *>(native);
+    Detach(view);
+    for (size_t i = 0; i < view->children.size(); i++) {
+        view->children[i]->parent = NULL;
+    }
+    views_.erase(view->id);
+    delete view;
+    stats_.destroyed++;
+}
+
+void zb::MemoryBackend::RecycleView(NativeView native)
+{
+    MemoryView *view = static_cast<MemoryView *>(native);
+    Detach(view);
+    for (size_t i = 0; i < view->children.size(); i++) {
+        view->children[i]->parent = NULL;
+    }
+    view->children.clear();
+    view->frame.x = 0;
+    view->frame.y = 0;
+    view->frame.width = 0;
+    view->frame.height = 0;
+    view->alpha = 1;
+    stats_.recycled++;
+}
+
+zb::Frame zb::MemoryBackend::GetFrame(NativeView native)
+{
+    return static_cast<MemoryView *>(native)->frame;
+}
+
+void zb::MemoryBackend::SetFrame(NativeView native, const Frame &frame)
+{
+    static_cast<MemoryView *>(native)->frame = frame;
+    stats_.frame_writes++;
+}
+
+float zb::MemoryBackend::GetAlpha(NativeView native)
+{
+    return static_cast<MemoryView *>(native)->alpha;
+}
+
+void zb::MemoryBackend::SetAlpha(NativeView native, float alpha)
+{
+    static_cast<MemoryView *>(native)->alpha = alpha;
+    stats_.alpha_writes++;
+}
+
+void zb::MemoryBackend::AddSubview(NativeView parent, NativeView child)
+{
+    MemoryView *view = static_cast<MemoryView *>(child);
+    Detach(view);
+    view->parent = static_cast<MemoryView *>(parent);
+    view->parent->children.push_back(view);
+}
+
+void zb::MemoryBackend::RemoveFromSuperview(NativeView native)
+{
+    Detach(static_cast<MemoryView *>(native));
+}
+
+void zb::MemoryBackend::Log(const char *message)
+{
+    if (log_ != NULL) {
+        fprintf(log_, "%s\n", message);
+    }
+}
+
+void zb::MemoryBackend::Detach(MemoryView *view)
+{
+    if (view->parent == NULL) {
+        return;
+    }
+    std::vector<MemoryView *> &siblings = view->parent->children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), view));
+    view->parent = NULL;
+}
+
+void zb::MemoryBackend::Dump(FILE *out) const
+{
+    for (std::map<int, MemoryView *>::const_iterator it = views_.begin(); it != views_.end(); ++it) {
+        if (it->second->parent == NULL) {
+            DumpView(out, it->second, 0);
+        }
+    }
+}
+
+void zb::MemoryBackend::DumpView(FILE *out, const MemoryView *view, int depth) const
+{
+    fprintf(out, "%*sView#%d {%g, %g, %g, %g} alpha=%g\n", depth * 2, "", view->id,
+            view->frame.x, view->frame.y, view->frame.width, view->frame.height, view->alpha);
+    for (size_t i = 0; i < view->children.size(); i++) {
+        DumpView(out, view->children[i], depth + 1);
+    }
+}
@@ -0,0 +1,69 @@
+//
+//  memory_backend.h
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_MEMORY_BACKEND_H_
+#define ZB_MEMORY_BACKEND_H_
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include "backend.h"
+
+namespace zb {
+    struct MemoryView {
+        int id;
+        Frame frame;
+        float alpha;
+        MemoryView *parent;
+        std::vector<MemoryView *> children;
+    };
+    
+    // Headless backend that keeps the view tree in plain structs, so the
+    // bridge can run, be inspected and be benchmarked without a UI toolkit.
+    class MemoryBackend : public Backend {
+    public:
+        struct Stats {
+            int commits;
+            int created;
+            int destroyed;
+            int recycled;
+            int frame_writes;
+            int alpha_writes;
+        };
+        
+        explicit MemoryBackend(FILE *log = stdout);
+        virtual ~MemoryBackend();
+        
+        virtual void BeginCommit();
+        virtual NativeView CreateView();
+        virtual void DestroyView(NativeView view);
+        virtual void RecycleView(NativeView view);
+        virtual Frame GetFrame(NativeView view);
+        virtual void SetFrame(NativeView view, const Frame &frame);
+        virtual float GetAlpha(NativeView view);
+        virtual void SetAlpha(NativeView view, float alpha);
+        virtual void AddSubview(NativeView parent, NativeView child);
+        virtual void RemoveFromSuperview(NativeView view);
+        virtual void Log(const char *message);
+        
+        int live_views() const { return static_cast<int>(views_.size()); }
+        const Stats &stats() const { return stats_; }
+        void Dump(FILE *out) const;
+    private:
+        void Detach(MemoryView *view);
+        void DumpView(FILE *out, const MemoryView *view, int depth) const;
+        
+        FILE *log_;
+        int next_id_;
+        std::map<int, MemoryView *> views_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_MEMORY_BACKEND_H_
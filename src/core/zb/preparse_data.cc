@@ -0,0 +1,110 @@
+//
+//  preparse_data.cc
+//  zb
+//
+//  Created by  on 12/03/18.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "preparse_data.h"
+#include "script_cache.h"
+
+namespace {
+    const uint32_t kMagic = 0x5a425050;  // "ZBPP"
+    const uint32_t kFormat = 1;
+
+    // The data's layout belongs to the V8 that wrote it.
+    uint32_t Version()
+    {
+        const char *version = v8::V8::GetVersion();
+        return static_cast<uint32_t>(zb::ScriptCache::Hash(version, strlen(version))) ^ kFormat;
+    }
+}
+
+zb::PreparseData::PreparseData(const Header &header, std::vector<uint32_t> *data)
+    : header_(header)
+{
+    data_.swap(*data);
+    script_data_ = v8::ScriptData::New(reinterpret_cast<const char *>(data_.data()), static_cast<int>(data_.size() * sizeof(uint32_t)));
+}
+
+zb::PreparseData::~PreparseData()
+{
+    delete script_data_;
+}
+
+zb::PreparseData::Header zb::PreparseData::HeaderFor(const char *source, size_t length)
+{
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kMagic;
+    header.version = Version();
+    header.source_hash = ScriptCache::Hash(source, length);
+    header.source_length = length;
+    return header;
+}
+
+std::string zb::PreparseData::PathFor(const char *bundle)
+{
+    return std::string(bundle) + ".preparse";
+}
+
+zb::PreparseData *zb::PreparseData::Load(const char *path, const char *source, size_t length)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    Header header;
+    Header expected = HeaderFor(source, length);
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+        header.magic == expected.magic && header.version == expected.version &&
+        header.source_hash == expected.source_hash && header.source_length == expected.source_length &&
+        header.data_length > 0 && header.data_length % sizeof(uint32_t) == 0;
+    std::vector<uint32_t> data;
+    if (ok) {
+        data.resize(header.data_length / sizeof(uint32_t));
+        ok = fread(data.data(), header.data_length, 1, file) == 1 && fgetc(file) == EOF;
+    }
+    fclose(file);
+    if (!ok) {
+        return NULL;
+    }
+    return new PreparseData(header, &data);
+}
+
+zb::PreparseData *zb::PreparseData::Create(const char *source, size_t length)
+{
+    v8::ScriptData *script_data = v8::ScriptData::PreCompile(source, static_cast<int>(length));
+    if (script_data->HasError() || script_data->Length() <= 0) {
+        delete script_data;
+        return NULL;
+    }
+    Header header = HeaderFor(source, length);
+    header.data_length = script_data->Length();
+    std::vector<uint32_t> data(header.data_length / sizeof(uint32_t));
+    memcpy(data.data(), script_data->Data(), data.size() * sizeof(uint32_t));
+    delete script_data;
+    return new PreparseData(header, &data);
+}
+
+bool zb::PreparseData::Write(const char *path) const
+{
+    std::string temporary = std::string(path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fwrite(&header_, sizeof(header_), 1, file) == 1 &&
+        fwrite(data_.data(), data_.size() * sizeof(uint32_t), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
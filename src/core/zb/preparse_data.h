@@ -0,0 +1,69 @@
+//
+//  preparse_data.h
+//  zb
+//
+//  Created by  on 12/03/18.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_PREPARSE_DATA_H_
+#define ZB_PREPARSE_DATA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+
+namespace zb {
+    // V8's preparse data for a script bundle, kept in a file next to it
+    // (app.js gets app.js.preparse). Compiling with it lets the parser jump
+    // over the bodies of lazily compiled functions instead of scanning them
+    // again on every launch.
+    //
+    // The file records a hash and the length of the source it was made
+    // from and the V8 version that made it; Load rejects it when any of
+    // them differ, since V8 only checks the data in debug builds. Files
+    // are written by zb_preparse at build time, or by the runtime on first
+    // run where the bundle's directory is writable.
+    class PreparseData {
+    public:
+        // V8 does not bother preparsing sources shorter than this either.
+        enum { kMinLength = 1024 };
+
+        ~PreparseData();
+
+        // NULL if there is no file for |source| or it is stale.
+        static PreparseData *Load(const char *path, const char *source, size_t length);
+        // Preparses |source|, which is UTF-8. NULL if it has a syntax error.
+        static PreparseData *Create(const char *source, size_t length);
+        static std::string PathFor(const char *bundle);
+
+        // Replaces the file at |path| in one rename, so a reader never
+        // sees half of it.
+        bool Write(const char *path) const;
+
+        // Owned by this object; valid while it lives.
+        v8::ScriptData *script_data() const { return script_data_; }
+        size_t size() const { return data_.size() * sizeof(uint32_t); }
+    private:
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t source_hash;
+            uint64_t source_length;
+            uint32_t data_length;
+            uint32_t reserved;
+        };
+
+        PreparseData(const Header &header, std::vector<uint32_t> *data);
+        static Header HeaderFor(const char *source, size_t length);
+
+        Header header_;
+        std::vector<uint32_t> data_;
+        v8::ScriptData *script_data_;
+    };
+}
+
+#endif  // ZB_PREPARSE_DATA_H_
@@ -0,0 +1,614 @@
+//
+//  recorder.cc
+//  zb
+//
+//  Created by  on 12/03/19.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+#include "recorder.h"
+#include "runtime.h"
+#include "trace.h"
+
+namespace {
+    const char kMagic[4] = { 'Z', 'B', 'R', 'T' };
+    const uint32_t kFormat = 1;
+    const size_t kFlushSize = 64 * 1024;
+
+    // Tags for the values handed to bindings, which are only summarized.
+    enum Tag {
+        kUndefined,
+        kNull,
+        kFalse,
+        kTrue,
+        kInteger,
+        kDouble,
+        kString,
+        kArray,
+        kFunction,
+        kObject
+    };
+
+    std::mutex mutex;
+    FILE *file = NULL;
+    std::string buffer;
+    double start;
+    int64_t last;
+    std::vector<bool> named;
+
+    void PutByte(uint8_t byte)
+    {
+        buffer.push_back(static_cast<char>(byte));
+    }
+
+    void PutVarint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            PutByte(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        PutByte(static_cast<uint8_t>(value));
+    }
+
+    void PutSigned(int64_t value)
+    {
+        PutVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void PutBytes(const void *data, size_t length)
+    {
+        buffer.append(static_cast<const char *>(data), length);
+    }
+
+    void PutString(const char *data, size_t length)
+    {
+        PutVarint(length);
+        PutBytes(data, length);
+    }
+
+    void PutDouble(double value)
+    {
+        PutBytes(&value, sizeof(value));
+    }
+
+    int64_t Nanoseconds(double seconds)
+    {
+        return static_cast<int64_t>(llround(seconds * 1e9));
+    }
+
+    // Starts a record stamped now; times only go forward, whichever
+    // thread records.
+    int64_t Begin(zb::Record::Type type)
+    {
+        int64_t now = std::max(Nanoseconds(zb::Runtime::Now() - start), last);
+        PutByte(static_cast<uint8_t>(type));
+        PutVarint(static_cast<uint64_t>(now - last));
+        last = now;
+        return now;
+    }
+
+    void End()
+    {
+        if (buffer.size() >= kFlushSize) {
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    }
+
+    void PutVariant(const zb::Variant &value)
+    {
+        PutByte(static_cast<uint8_t>(value.type()));
+        switch (value.type()) {
+            case zb::Variant::kUndefined:
+            case zb::Variant::kNull:
+                break;
+            case zb::Variant::kBoolean:
+                PutByte(value.boolean() ? 1 : 0);
+                break;
+            case zb::Variant::kNumber:
+                PutDouble(value.number());
+                break;
+            case zb::Variant::kString:
+                PutString(value.string().data(), value.string().size());
+                break;
+            case zb::Variant::kArray:
+                PutVarint(value.items().size());
+                for (size_t i = 0; i < value.items().size(); i++) {
+                    PutVariant(value.items()[i]);
+                }
+                break;
+            case zb::Variant::kObject:
+                PutVarint(value.fields().size());
+                for (size_t i = 0; i < value.fields().size(); i++) {
+                    PutString(value.fields()[i].first.data(), value.fields()[i].first.size());
+                    PutVariant(value.fields()[i].second);
+                }
+                break;
+            case zb::Variant::kNumbers:
+                PutVarint(value.numbers().size());
+                PutBytes(value.numbers().data(), value.numbers().size() * sizeof(double));
+                break;
+        }
+    }
+
+    // Strings keep their full length and their first kMaxString bytes.
+    void PutValue(v8::Handle<v8::Value> value)
+    {
+        if (value->IsUndefined()) {
+            PutByte(kUndefined);
+        } else if (value->IsNull()) {
+            PutByte(kNull);
+        } else if (value->IsBoolean()) {
+            PutByte(value->IsTrue() ? kTrue : kFalse);
+        } else if (value->IsInt32()) {
+            PutByte(kInteger);
+            PutSigned(value->Int32Value());
+        } else if (value->IsNumber()) {
+            PutByte(kDouble);
+            PutDouble(value->NumberValue());
+        } else if (value->IsString()) {
+            v8::Handle<v8::String> string = v8::Handle<v8::String>::Cast(value);
+            char prefix[zb::Recorder::kMaxString];
+            int length = string->WriteUtf8(prefix, sizeof(prefix), NULL, v8::String::NO_NULL_TERMINATION);
+            PutByte(kString);
+            PutVarint(string->Length());
+            PutString(prefix, length);
+        } else if (value->IsArray()) {
+            PutByte(kArray);
+            PutVarint(v8::Handle<v8::Array>::Cast(value)->Length());
+        } else if (value->IsFunction()) {
+            PutByte(kFunction);
+        } else {
+            PutByte(kObject);
+        }
+    }
+
+    void Name(const zb::Histogram *binding)
+    {
+        size_t id = binding->id();
+        if (id < named.size() && named[id]) {
+            return;
+        }
+        if (id >= named.size()) {
+            named.resize(id + 1);
+        }
+        named[id] = true;
+        Begin(zb::Record::kBindingName);
+        PutVarint(id);
+        PutString(binding->name().data(), binding->name().size());
+    }
+}
+
+bool zb::Recorder::enabled_ = false;
+
+// Call before creating the runtimes to record.
+bool zb::Recorder::Start(const char *path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file != NULL) {
+        return false;
+    }
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    start = Runtime::Now();
+    last = 0;
+    named.clear();
+    buffer.clear();
+    PutBytes(kMagic, sizeof(kMagic));
+    PutBytes(&kFormat, sizeof(kFormat));
+    PutDouble(start);
+    Tracer::Enable();
+    enabled_ = true;
+    return true;
+}
+
+void zb::Recorder::Stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled_ = false;
+    if (file == NULL) {
+        return;
+    }
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    fclose(file);
+    file = NULL;
+    buffer.clear();
+}
+
+void zb::Recorder::RecordBinding(const Histogram *binding, const v8::Arguments &args)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Name(binding);
+    Begin(Record::kBinding);
+    PutVarint(binding->id());
+    PutVarint(args.Length());
+    for (int i = 0; i < args.Length(); i++) {
+        PutValue(args[i]);
+    }
+    End();
+}
+
+// Accessors: a getter has no value, a setter the one assigned.
+void zb::Recorder::RecordBinding(const Histogram *binding, v8::Handle<v8::Value> value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Name(binding);
+    Begin(Record::kBinding);
+    PutVarint(binding->id());
+    if (value.IsEmpty()) {
+        PutVarint(0);
+    } else {
+        PutVarint(1);
+        PutValue(value);
+    }
+    End();
+}
+
+void zb::Recorder::RecordRun(Record::Type type, const void *data, size_t length)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Begin(type);
+    PutString(static_cast<const char *>(data), length);
+    End();
+}
+
+void zb::Recorder::RecordRunFile(const char *path, uint64_t hash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Begin(Record::kRunFile);
+    PutString(path, strlen(path));
+    PutBytes(&hash, sizeof(hash));
+    End();
+}
+
+void zb::Recorder::RecordCall(const char *function, const Variant *argument, bool result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Begin(Record::kCall);
+    PutString(function, strlen(function));
+    PutByte(result ? 1 : 0);
+    PutVariant(argument != NULL ? *argument : Variant());
+    End();
+}
+
+void zb::Recorder::RecordEvents(const Event *events, int count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Begin(Record::kEvents);
+    PutVarint(count);
+    for (int i = 0; i < count; i++) {
+        PutByte(static_cast<uint8_t>(events[i].type));
+        PutSigned(events[i].pointer);
+        PutBytes(&events[i].x, sizeof(events[i].x));
+        PutBytes(&events[i].y, sizeof(events[i].y));
+        PutDouble(events[i].timestamp);
+        PutSigned(events[i].animation);
+    }
+    End();
+}
+
+// |value| is on the Now() clock, except for kIdle, where it is already
+// relative.
+void zb::Recorder::RecordTime(Record::Type type, double value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    int64_t now = Begin(type);
+    PutSigned(type == Record::kIdle ? Nanoseconds(value) : Nanoseconds(value - start) - now);
+    End();
+}
+
+void zb::Recorder::RecordInput(Record::Type type)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == NULL) {
+        return;
+    }
+    Begin(type);
+    End();
+}
+
+zb::TraceReader::TraceReader()
+    : file_(NULL), start_(0), time_(0), error_(NULL)
+{
+}
+
+zb::TraceReader::~TraceReader()
+{
+    if (file_ != NULL) {
+        fclose(file_);
+    }
+}
+
+bool zb::TraceReader::Open(const char *path)
+{
+    file_ = fopen(path, "rb");
+    if (file_ == NULL) {
+        error_ = "cannot open the trace";
+        return false;
+    }
+    char magic[sizeof(kMagic)];
+    uint32_t format;
+    if (!ReadFixed(magic, sizeof(magic)) || memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+        !ReadFixed(&format, sizeof(format)) || !ReadFixed(&start_, sizeof(start_))) {
+        error_ = "not a trace";
+        return false;
+    }
+    if (format != kFormat) {
+        error_ = "trace format not supported";
+        return false;
+    }
+    return true;
+}
+
+bool zb::TraceReader::Next(Record *record)
+{
+    int c = fgetc(file_);
+    if (c == EOF) {
+        return false;
+    }
+    error_ = "trace is truncated or corrupt";
+    uint64_t delta;
+    if (!ReadVarint(&delta)) {
+        return false;
+    }
+    time_ += static_cast<int64_t>(delta);
+    record->type = static_cast<Record::Type>(c);
+    record->time = time_ / 1e9;
+    record->text.clear();
+    record->events.clear();
+    uint64_t number;
+    int64_t offset;
+    uint8_t byte;
+    switch (record->type) {
+        case Record::kBindingName:
+            if (!ReadVarint(&number) || !ReadString(&record->text)) {
+                return false;
+            }
+            record->binding = static_cast<int>(number);
+            break;
+        case Record::kBinding:
+            if (!ReadVarint(&number)) {
+                return false;
+            }
+            record->binding = static_cast<int>(number);
+            if (!ReadVarint(&number)) {
+                return false;
+            }
+            record->arguments = static_cast<int>(number);
+            for (int i = 0; i < record->arguments; i++) {
+                if (!SkipValue()) {
+                    return false;
+                }
+            }
+            break;
+        case Record::kRun:
+        case Record::kRunUtf16:
+            if (!ReadString(&record->text)) {
+                return false;
+            }
+            break;
+        case Record::kRunFile:
+            if (!ReadString(&record->text) || !ReadFixed(&record->hash, sizeof(record->hash))) {
+                return false;
+            }
+            break;
+        case Record::kCall:
+            if (!ReadString(&record->text) || !ReadByte(&byte) || !ReadVariant(&record->argument, 0)) {
+                return false;
+            }
+            record->flag = byte != 0;
+            break;
+        case Record::kEvents:
+            if (!ReadVarint(&number) || number > 1 << 20) {
+                return false;
+            }
+            record->events.resize(static_cast<size_t>(number));
+            for (size_t i = 0; i < record->events.size(); i++) {
+                Event &event = record->events[i];
+                int64_t pointer;
+                int64_t animation;
+                if (!ReadByte(&byte) || !ReadSigned(&pointer) || !ReadFixed(&event.x, sizeof(event.x)) ||
+                    !ReadFixed(&event.y, sizeof(event.y)) || !ReadFixed(&event.timestamp, sizeof(event.timestamp)) ||
+                    !ReadSigned(&animation) || byte > Event::kAnimationInterrupted) {
+                    return false;
+                }
+                event.type = static_cast<Event::Type>(byte);
+                event.pointer = static_cast<int>(pointer);
+                event.animation = static_cast<int>(animation);
+            }
+            break;
+        case Record::kTimers:
+        case Record::kFrame:
+        case Record::kClock:
+            if (!ReadSigned(&offset)) {
+                return false;
+            }
+            record->value = (time_ + offset) / 1e9;
+            break;
+        case Record::kIdle:
+            if (!ReadSigned(&offset)) {
+                return false;
+            }
+            record->value = offset / 1e9;
+            break;
+        case Record::kMessages:
+        case Record::kLowMemory:
+            break;
+        default:
+            return false;
+    }
+    error_ = NULL;
+    return true;
+}
+
+bool zb::TraceReader::ReadByte(uint8_t *out)
+{
+    int c = fgetc(file_);
+    *out = static_cast<uint8_t>(c);
+    return c != EOF;
+}
+
+bool zb::TraceReader::ReadVarint(uint64_t *out)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        if (!ReadByte(&byte)) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *out = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool zb::TraceReader::ReadSigned(int64_t *out)
+{
+    uint64_t value;
+    if (!ReadVarint(&value)) {
+        return false;
+    }
+    *out = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    return true;
+}
+
+bool zb::TraceReader::ReadString(std::string *out)
+{
+    uint64_t length;
+    if (!ReadVarint(&length) || length > 1 << 30) {
+        return false;
+    }
+    out->resize(static_cast<size_t>(length));
+    return length == 0 || ReadFixed(&(*out)[0], out->size());
+}
+
+bool zb::TraceReader::ReadFixed(void *out, size_t size)
+{
+    return fread(out, size, 1, file_) == 1;
+}
+
+bool zb::TraceReader::ReadVariant(Variant *out, int depth)
+{
+    uint8_t type;
+    uint64_t count;
+    if (depth >= Marshaller::kMaxDepth || !ReadByte(&type)) {
+        return false;
+    }
+    switch (type) {
+        case Variant::kUndefined:
+            *out = Variant();
+            return true;
+        case Variant::kNull:
+            *out = Variant::Null();
+            return true;
+        case Variant::kBoolean: {
+            uint8_t value;
+            if (!ReadByte(&value)) {
+                return false;
+            }
+            *out = Variant(value != 0);
+            return true;
+        }
+        case Variant::kNumber: {
+            double value;
+            if (!ReadFixed(&value, sizeof(value))) {
+                return false;
+            }
+            *out = Variant(value);
+            return true;
+        }
+        case Variant::kString:
+            *out = Variant("");
+            return ReadString(out->mutable_string());
+        case Variant::kArray:
+            *out = Variant::Array();
+            if (!ReadVarint(&count)) {
+                return false;
+            }
+            for (uint64_t i = 0; i < count; i++) {
+                if (!ReadVariant(out->Append(), depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        case Variant::kObject:
+            *out = Variant::Object();
+            if (!ReadVarint(&count)) {
+                return false;
+            }
+            for (uint64_t i = 0; i < count; i++) {
+                std::string key;
+                if (!ReadString(&key) || !ReadVariant(out->Set(key), depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        case Variant::kNumbers:
+            *out = Variant::Numbers();
+            if (!ReadVarint(&count) || count > 1 << 27) {
+                return false;
+            }
+            out->mutable_numbers()->resize(static_cast<size_t>(count));
+            return count == 0 || ReadFixed(out->mutable_numbers()->data(), count * sizeof(double));
+    }
+    return false;
+}
+
+bool zb::TraceReader::SkipValue()
+{
+    uint8_t tag;
+    uint64_t number;
+    double value;
+    std::string prefix;
+    if (!ReadByte(&tag)) {
+        return false;
+    }
+    switch (tag) {
+        case kUndefined:
+        case kNull:
+        case kFalse:
+        case kTrue:
+        case kFunction:
+        case kObject:
+            return true;
+        case kInteger:
+        case kArray:
+            return ReadVarint(&number);
+        case kDouble:
+            return ReadFixed(&value, sizeof(value));
+        case kString:
+            return ReadVarint(&number) && ReadString(&prefix);
+    }
+    return false;
+}
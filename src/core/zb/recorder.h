@@ -0,0 +1,120 @@
+//
+//  recorder.h
+//  zb
+//
+//  Created by  on 12/03/19.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_RECORDER_H_
+#define ZB_RECORDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+#include "event.h"
+#include "marshal.h"
+
+namespace zb {
+    class Histogram;
+
+    // One entry of a recorded trace. Inputs are what the host handed the
+    // runtime; kClock is a clock reading a timer was scheduled from, and
+    // kBinding a call from script into a bridge callback.
+    struct Record {
+        enum Type {
+            kBindingName = 1,  // binding, text: the name binding ids refer to
+            kBinding,          // binding, arguments
+            kRun,              // text
+            kRunUtf16,         // text: UTF-16 code units
+            kRunFile,          // text: path, hash: of the contents
+            kCall,             // text: function, argument, flag: result wanted
+            kEvents,           // events
+            kTimers,           // value: now
+            kFrame,            // value: timestamp
+            kClock,            // value
+            kMessages,
+            kIdle,             // value: seconds to the deadline
+            kLowMemory
+        };
+
+        Type type;
+        double time;  // seconds since the recording started
+        int binding;
+        int arguments;
+        bool flag;
+        uint64_t hash;
+        double value;
+        std::string text;
+        Variant argument;
+        std::vector<Event> events;
+    };
+
+    // Records a runtime's inputs, the clock readings its timers depend on
+    // and every traced bridge callback into a compact binary trace, which
+    // zb_replay runs again on the headless backend.
+    //
+    // Like Tracer, recording is process wide and covers the runtimes
+    // created after Start; it enables tracing, through whose wrappers
+    // binding calls are seen. Records from any thread go through one lock
+    // into a buffer written out 64 KB at a time, so recording slows the
+    // bridge down a little and is meant for capturing workloads, not for
+    // shipping. Strings passed to bindings are kept up to kMaxString bytes.
+    //
+    // The trace starts with "ZBRT", a format version and the recording's
+    // start on the Now() clock. Each record is a type byte, the time since
+    // the previous record in ns and its fields; integers are LEB128
+    // varints, signed ones zigzag encoded, and times within a record are
+    // ns relative to the record.
+    class Recorder {
+    public:
+        enum { kMaxString = 64 };
+
+        static bool Start(const char *path);
+        static void Stop();
+        static bool enabled() { return enabled_; }
+
+        static void RecordBinding(const Histogram *binding, const v8::Arguments &args);
+        static void RecordBinding(const Histogram *binding, v8::Handle<v8::Value> value);
+        static void RecordRun(Record::Type type, const void *data, size_t length);
+        static void RecordRunFile(const char *path, uint64_t hash);
+        static void RecordCall(const char *function, const Variant *argument, bool result);
+        static void RecordEvents(const Event *events, int count);
+        static void RecordTime(Record::Type type, double value);
+        static void RecordInput(Record::Type type);
+    private:
+        static bool enabled_;
+    };
+
+    // Reads back what Recorder wrote.
+    class TraceReader {
+    public:
+        TraceReader();
+        ~TraceReader();
+        bool Open(const char *path);
+        // False at the end of the trace, or if the rest is cut off or
+        // corrupt; error() tells the two apart.
+        bool Next(Record *record);
+        const char *error() const { return error_; }
+        double start() const { return start_; }
+    private:
+        bool ReadByte(uint8_t *out);
+        bool ReadVarint(uint64_t *out);
+        bool ReadSigned(int64_t *out);
+        bool ReadString(std::string *out);
+        bool ReadFixed(void *out, size_t size);
+        bool ReadVariant(Variant *out, int depth);
+        bool SkipValue();
+
+        FILE *file_;
+        double start_;
+        int64_t time_;
+        const char *error_;
+    };
+}
+
+#endif  // ZB_RECORDER_H_
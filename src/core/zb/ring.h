@@ -0,0 +1,149 @@
+//
+//  ring.h
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_RING_H_
+#define ZB_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace zb {
+    // Bounded lock-free queue for exactly one producer thread and one
+    // consumer thread. Capacity is rounded up to a power of two.
+    template <typename T>
+    class SpscRing {
+    public:
+        explicit SpscRing(size_t capacity)
+            : head_(0), tail_(0)
+        {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            items_.resize(size);
+            mask_ = size - 1;
+        }
+        
+        bool Push(const T &item)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) > mask_) {
+                return false;
+            }
+            items_[tail & mask_] = item;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+        
+        bool Pop(T *item)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            *item = items_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+        
+        size_t size() const
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+        
+        size_t capacity() const { return mask_ + 1; }
+    private:
+        std::vector<T> items_;
+        size_t mask_;
+        // Producer and consumer indices sit on separate cache lines so the
+        // two threads do not false-share.
+        alignas(64) std::atomic<size_t> head_;
+        alignas(64) std::atomic<size_t> tail_;
+    };
+    
+    // Bounded lock-free queue for any number of producer threads and one
+    // consumer at a time. Each cell carries a sequence number telling
+    // producers and the consumer whose turn it is, so producers only
+    // contend on claiming a position.
+    template <typename T>
+    class MpscRing {
+    public:
+        explicit MpscRing(size_t capacity)
+            : head_(0), tail_(0)
+        {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            cells_ = new Cell[size];
+            for (size_t i = 0; i < size; i++) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            mask_ = size - 1;
+        }
+        
+        ~MpscRing() { delete[] cells_; }
+        MpscRing(const MpscRing &) = delete;
+        MpscRing &operator=(const MpscRing &) = delete;
+        
+        bool Push(const T &item)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = cells_[tail & mask_];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+                if (diff == 0) {
+                    if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                        cell.item = item;
+                        cell.sequence.store(tail + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    tail = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+        
+        bool Pop(T *item)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            Cell &cell = cells_[head & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+                return false;
+            }
+            *item = cell.item;
+            cell.sequence.store(head + mask_ + 1, std::memory_order_release);
+            head_.store(head + 1, std::memory_order_relaxed);
+            return true;
+        }
+        
+        size_t size() const
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+        
+        size_t capacity() const { return mask_ + 1; }
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T item;
+        };
+        
+        Cell *cells_;
+        size_t mask_;
+        alignas(64) std::atomic<size_t> head_;
+        alignas(64) std::atomic<size_t> tail_;
+    };
+}
+
+#endif  // ZB_RING_H_
@@ -0,0 +1,642 @@
+//
+//  runtime.cc
+//  zb
+//
+//  Created by  on 12/02/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "runtime.h"
+#include "binding.h"
+#include "invoke.h"
+#include "mapped_source.h"
+#include "preparse_data.h"
+#include "recorder.h"
+#include "trace.h"
+#include "view.h"
+
+using namespace v8;
+
+namespace {
+    // Small enough that one incremental marking step fits in the slack of
+    // a 60 Hz frame on a phone.
+    const int kIdleHint = 100;
+    
+    // Finalized wrappers Commit releases itself rather than leave them for
+    // an Idle call that may never come.
+    const size_t kMaxPendingFinalizers = 256;
+}
+
+zb::Runtime::Runtime(Backend *backend)
+    : backend_(backend), transaction_(backend, &geometry_), shadow_tree_(backend), log_(LogChannel::Shared()), next_animation_(1), next_bundle_(1),
+      worker_inbox_(new WorkerInbox()), idle_done_(false), idle_step_estimate_(0.001), write_preparse_(false), clock_(NULL), clock_data_(NULL), event_loop_(this)
+{
+    memset(&idle_stats_, 0, sizeof(idle_stats_));
+    isolate_ = v8::Isolate::New();
+    
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    v8::HandleScope handle_scope;
+    isolate_->SetData(this);
+    if (Tracer::enabled()) {
+        Tracer::Install();
+    }
+    v8::V8::AddGCEpilogueCallback(Runtime::OnGCEpilogue);
+    templates_.Initialize();
+    context_ = NewContext();
+}
+
+zb::Runtime::~Runtime()
+{
+    {
+        v8::Locker locker(isolate_);
+        v8::Isolate::Scope isolate_scope(isolate_);
+        finalizer_.Seal();
+        finalizer_.Flush();
+        view_pool_.Dispose();
+        shadow_tree_.Dispose();
+        for (std::map<int, v8::Persistent<v8::Function> >::iterator it = animation_callbacks_.begin(); it != animation_callbacks_.end(); ++it) {
+            it->second.Dispose();
+        }
+        animation_callbacks_.clear();
+        event_loop_.Dispose();
+        marshaller_.Dispose();
+        // Workers keep running jobs already started, but their messages
+        // no longer reach this runtime.
+        worker_inbox_->Close();
+        for (std::map<int, v8::Persistent<v8::Object> >::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+            WorkerPool::Shared()->Terminate(it->first);
+            it->second.Dispose();
+        }
+        workers_.clear();
+        // The weak callbacks that delete Worker objects never run once the
+        // isolate is gone, so whatever the collector left goes here,
+        // running workers and terminated ones alike.
+        while (!worker_objects_.empty()) {
+            delete *worker_objects_.begin();
+        }
+        geometry_.Dispose();
+        script_cache_.Dispose();
+        context_.Dispose();
+        context_.Clear();
+        templates_.Dispose();
+    }
+    isolate_->Dispose();
+}
+
+v8::Handle<v8::ObjectTemplate> zb::Runtime::CreateGlobalTemplate()
+{
+    v8::HandleScope handle_scope;
+    v8::Handle<v8::ObjectTemplate> global = v8::ObjectTemplate::New();
+    zb::View::InitializeTemplate(global, this);
+    zb::ShadowTree::InitializeTemplate(global, this);
+    zb::Worker::InitializeTemplate(global, this);
+    zb::EventLoop::InitializeTemplate(global, this);
+    global->Set(v8::String::New("Log"), CreateLogTemplate());
+    global->SetAccessor(v8::String::New("Geometry"), TraceGetter<Runtime::GetGeometry>("Geometry"), NULL, v8::External::New(this));
+    global->Set(v8::String::New("Print"), v8::FunctionTemplate::New(Trace<Invoke::Print>("Print"), v8::External::New(&log_limiter_)));
+    global->Set(v8::String::New("Plus"), v8::FunctionTemplate::New(Trace<Function2<uint32_t, uint32_t, uint32_t, Invoke::Plus>::Call>("Plus")));
+    return handle_scope.Close(global);
+}
+
+// A context with the bridge globals, from the global template this isolate
+// built the first time. The caller owns it.
+v8::Persistent<v8::Context> zb::Runtime::NewContext()
+{
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    v8::HandleScope handle_scope;
+    if (templates_.global().IsEmpty()) {
+        templates_.set_global(CreateGlobalTemplate());
+    }
+    return v8::Context::New(NULL, templates_.global());
+}
+
+// Log(...) logs at info; Log.debug, Log.info, Log.warn and Log.error pick
+// the level.
+v8::Handle<v8::FunctionTemplate> zb::Runtime::CreateLogTemplate()
+{
+    v8::HandleScope handle_scope;
+    v8::Handle<v8::External> data = v8::External::New(this);
+    v8::Handle<v8::FunctionTemplate> log = v8::FunctionTemplate::New(Trace<Runtime::Log<LogChannel::kInfo> >("Log"), data);
+    log->Set(v8::String::New("debug"), v8::FunctionTemplate::New(Trace<Runtime::Log<LogChannel::kDebug> >("Log.debug"), data));
+    log->Set(v8::String::New("info"), v8::FunctionTemplate::New(Trace<Runtime::Log<LogChannel::kInfo> >("Log.info"), data));
+    log->Set(v8::String::New("warn"), v8::FunctionTemplate::New(Trace<Runtime::Log<LogChannel::kWarning> >("Log.warn"), data));
+    log->Set(v8::String::New("error"), v8::FunctionTemplate::New(Trace<Runtime::Log<LogChannel::kError> >("Log.error"), data));
+    return handle_scope.Close(log);
+}
+
+bool zb::Runtime::Run(const char *s)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordRun(Record::kRun, s, strlen(s));
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    TryCatch try_catch;
+    return Execute(script_cache_.Compile(s, strlen(s)), &try_catch);
+}
+
+// External sources are compiled in place and skip the script cache, which
+// would otherwise keep its own copy; they are meant for bundles that run
+// once. V8 owns the resource from here on.
+bool zb::Runtime::Run(v8::String::ExternalAsciiStringResource *source)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordRun(Record::kRun, source->data(), source->length());
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    TryCatch try_catch;
+    return Execute(Script::Compile(String::NewExternal(source), NextBundleName()), &try_catch);
+}
+
+bool zb::Runtime::Run(v8::String::ExternalStringResource *source)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordRun(Record::kRunUtf16, source->data(), source->length() * sizeof(uint16_t));
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    TryCatch try_catch;
+    return Execute(Script::Compile(String::NewExternal(source), NextBundleName()), &try_catch);
+}
+
+// External sources have no name of their own; each run gets one, so
+// stack frames, and with them the log limiter's call sites, tell them
+// apart.
+v8::Handle<v8::String> zb::Runtime::NextBundleName()
+{
+    char name[32];
+    snprintf(name, sizeof(name), "zb:bundle:%d", next_bundle_++);
+    return String::New(name);
+}
+
+// Maps ASCII files straight into an external string; anything else is
+// read into a heap string. Either way files skip the script cache. Bundles
+// long enough for V8 to preparse are compiled with the preparse data next
+// to them when it matches, and with set_write_preparse the data is made
+// and saved when it does not.
+bool zb::Runtime::RunFile(const char *path)
+{
+    MappedSource *mapped = MappedSource::Open(path);
+    std::string source;
+    if (mapped == NULL) {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            std::string message = std::string("Error reading '") + path + "'";
+            log_->Write(LogChannel::kError, message.data(), message.size());
+            return false;
+        }
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            source.append(buffer, read);
+        }
+        fclose(file);
+    }
+    const char *data = mapped != NULL ? mapped->data() : source.data();
+    size_t length = mapped != NULL ? mapped->length() : source.size();
+    if (Recorder::enabled()) {
+        Recorder::RecordRunFile(path, ScriptCache::Hash(data, length));
+    }
+    
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    std::unique_ptr<PreparseData> preparse;
+    if (length >= PreparseData::kMinLength) {
+        std::string preparse_path = PreparseData::PathFor(path);
+        preparse.reset(PreparseData::Load(preparse_path.c_str(), data, length));
+        if (preparse.get() == NULL && write_preparse_) {
+            preparse.reset(PreparseData::Create(data, length));
+            if (preparse.get() != NULL && !preparse->Write(preparse_path.c_str())) {
+                std::string message = std::string("Error writing '") + preparse_path + "'";
+                log_->Write(LogChannel::kDebug, message.data(), message.size());
+            }
+        }
+    }
+    TryCatch try_catch;
+    Handle<String> string = mapped != NULL ? String::NewExternal(mapped) : String::New(data, static_cast<int>(length));
+    ScriptOrigin origin(String::New(path));
+    return Execute(Script::Compile(string, &origin, preparse.get() != NULL ? preparse->script_data() : NULL), &try_catch);
+}
+
+// Calls the global |function| with |argument| built straight from the
+// Variant, and marshals what it returns into |result| if given. Like Run,
+// commits afterwards.
+bool zb::Runtime::Call(const char *function, Variant *argument, Variant *result)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordCall(function, argument, result != NULL);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    v8::Local<v8::Value> callee = context_->Global()->Get(v8::String::NewSymbol(function));
+    if (!callee->IsFunction()) {
+        char message[LogChannel::kMaxMessage];
+        int length = snprintf(message, sizeof(message), "%s is not a function", function);
+        log_->Write(LogChannel::kError, message, std::min(length, static_cast<int>(sizeof(message)) - 1));
+        return false;
+    }
+    TryCatch try_catch;
+    v8::Handle<v8::Value> argv[] = { v8::Undefined() };
+    if (argument != NULL) {
+        argv[0] = marshaller_.ToV8(argument);
+    }
+    v8::Local<v8::Value> value = v8::Local<v8::Function>::Cast(callee)->Call(context_->Global(), 1, argv);
+    Commit();
+    if (value.IsEmpty()) {
+        ReportException(&try_catch);
+        return false;
+    }
+    if (result != NULL && !marshaller_.FromV8(value, result)) {
+        if (marshaller_.error() != NULL) {
+            char message[LogChannel::kMaxMessage];
+            int length = snprintf(message, sizeof(message), "%s: %s", function, marshaller_.error());
+            log_->Write(LogChannel::kError, message, std::min(length, static_cast<int>(sizeof(message)) - 1));
+        } else {
+            ReportException(&try_catch);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool zb::Runtime::Execute(v8::Handle<v8::Script> script, v8::TryCatch *try_catch)
+{
+    if (script.IsEmpty()) {
+        ReportException(try_catch);
+        return false;
+    }
+    Handle<Value> result = script->Run();
+    Commit();
+    if (result.IsEmpty()) {
+        ReportException(try_catch);
+        return false;
+    }
+    return true;
+}
+
+// Runs a framework script unless the startup snapshot already evaluated
+// it; see tools/mksnapshot.cc. Without a bridge snapshot linked in this is
+// just Run.
+bool zb::Runtime::Bootstrap(const char *name, const char *source)
+{
+    if (IsPreloaded(name)) {
+        return true;
+    }
+    return Run(source);
+}
+
+bool zb::Runtime::IsPreloaded(const char *name)
+{
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    v8::Local<v8::Value> value = context_->Global()->Get(templates_.symbol(TemplateCache::kPreloaded));
+    if (!value->IsArray()) {
+        return false;
+    }
+    v8::Local<v8::Array> preloaded = v8::Local<v8::Array>::Cast(value);
+    for (uint32_t i = 0; i < preloaded->Length(); i++) {
+        if (strcmp(*v8::String::Utf8Value(preloaded->Get(i)), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void zb::Runtime::DispatchEvent(const Event &event)
+{
+    DispatchEvents(&event, 1);
+}
+
+// Hands a batch of events to the script: input goes to the event loop, in
+// runs between animation events, which call the callback given to
+// View.animate. Like script runs, the changes they make wait for the next
+// commit.
+void zb::Runtime::DispatchEvents(const Event *events, int count)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordEvents(events, count);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    int input = 0;
+    for (int i = 0; i < count; i++) {
+        if (events[i].type == Event::kAnimationFinished || events[i].type == Event::kAnimationInterrupted) {
+            event_loop_.DispatchInput(events + input, i - input);
+            DispatchAnimationEvent(events[i]);
+            input = i + 1;
+        }
+    }
+    event_loop_.DispatchInput(events + input, count - input);
+}
+
+void zb::Runtime::DispatchAnimationEvent(const Event &event)
+{
+    std::map<int, v8::Persistent<v8::Function> >::iterator it = animation_callbacks_.find(event.animation);
+    if (it == animation_callbacks_.end()) {
+        return;
+    }
+    HandleScope handle_scope;
+    v8::Local<v8::Function> callback = v8::Local<v8::Function>::New(it->second);
+    it->second.Dispose();
+    animation_callbacks_.erase(it);
+    TryCatch try_catch;
+    v8::Handle<v8::Value> argv[] = { v8::Boolean::New(event.type == Event::kAnimationFinished) };
+    if (callback->Call(context_->Global(), 1, argv).IsEmpty()) {
+        ReportException(&try_catch);
+    }
+}
+
+// Runs the timers due by |now|, on the Now() clock. The caller commits.
+int zb::Runtime::RunTimers(double now)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordTime(Record::kTimers, now);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    return event_loop_.RunTimers(now);
+}
+
+// Runs the requestAnimationFrame callbacks; hosts call it once per frame
+// with the frame's time. The caller commits.
+int zb::Runtime::RunFrame(double timestamp)
+{
+    if (!event_loop_.HasFrameCallbacks()) {
+        return 0;
+    }
+    if (Recorder::enabled()) {
+        Recorder::RecordTime(Record::kFrame, timestamp);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    return event_loop_.RunFrame(timestamp);
+}
+
+// Flushes the model changes made since the last commit. Run commits at the
+// end of every script; frame-driven hosts can also call it once per frame.
+// Scripts have run since the last idle period, so V8 may have GC work
+// again. Hosts that never call Idle still get finalized wrappers released
+// here once enough of them wait.
+void zb::Runtime::Commit()
+{
+    transaction_.Commit();
+    idle_done_ = false;
+    if (finalizer_.pending() >= kMaxPendingFinalizers) {
+        v8::Locker locker(isolate_);
+        v8::Isolate::Scope isolate_scope(isolate_);
+        HandleScope handle_scope;
+        finalizer_.Flush();
+    }
+}
+
+// Keeps a completion callback until the animation with the returned id
+// reports back through DispatchEvent.
+int zb::Runtime::AddAnimationCallback(v8::Handle<v8::Function> callback)
+{
+    int id = next_animation_++;
+    animation_callbacks_[id] = v8::Persistent<v8::Function>::New(callback);
+    return id;
+}
+
+// Running workers are held here so their objects, and the onmessage
+// handlers set on them, outlive the script that started them.
+void zb::Runtime::AddWorker(int id, v8::Handle<v8::Object> worker)
+{
+    workers_[id] = v8::Persistent<v8::Object>::New(worker);
+}
+
+void zb::Runtime::RemoveWorker(int id)
+{
+    std::map<int, v8::Persistent<v8::Object> >::iterator it = workers_.find(id);
+    if (it != workers_.end()) {
+        it->second.Dispose();
+        workers_.erase(it);
+    }
+}
+
+// Hands whatever workers posted since the last call to their objects'
+// onmessage. Like DispatchEvent, the caller commits.
+int zb::Runtime::DeliverWorkerMessages()
+{
+    std::deque<WorkerInbox::Message> messages;
+    worker_inbox_->Take(&messages);
+    if (messages.empty()) {
+        return 0;
+    }
+    if (Recorder::enabled()) {
+        Recorder::RecordInput(Record::kMessages);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    Context::Scope context_scope(context_);
+    
+    for (size_t i = 0; i < messages.size(); i++) {
+        std::map<int, v8::Persistent<v8::Object> >::iterator it = workers_.find(messages[i].worker);
+        if (it != workers_.end()) {
+            HandleScope message_scope;
+            v8::Local<v8::Object> worker = v8::Local<v8::Object>::New(it->second);
+            v8::Handle<v8::Value> value = messages[i].value->Read();
+            v8::Local<v8::Value> handler = worker->Get(templates_.symbol(TemplateCache::kOnMessage));
+            if (handler->IsFunction()) {
+                TryCatch try_catch;
+                if (v8::Local<v8::Function>::Cast(handler)->Call(worker, 1, &value).IsEmpty()) {
+                    ReportException(&try_catch);
+                }
+            }
+        }
+        delete messages[i].value;
+    }
+    return static_cast<int>(messages.size());
+}
+
+// Work the host runs when it has nothing else to do: releases the
+// wrappers finalized by earlier collections and, given a deadline on the
+// Now() clock, spends the time before it on incremental GC steps. A step
+// is only started when the average step so far still fits. Returns
+// whether V8 could use more idle time; once it says it has done all it
+// can, later calls skip the GC until scripts run again.
+bool zb::Runtime::Idle(double deadline)
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordTime(Record::kIdle, deadline - Now());
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    finalizer_.Flush();
+    
+    double start = Now();
+    double now = start;
+    int64_t steps = 0;
+    while (!idle_done_ && now + idle_step_estimate_ < deadline) {
+        idle_done_ = v8::V8::IdleNotification(kIdleHint);
+        double end = Now();
+        idle_step_estimate_ = idle_step_estimate_ * 0.75 + (end - now) * 0.25;
+        now = end;
+        steps++;
+    }
+    if (steps > 0) {
+        idle_stats_.periods++;
+        idle_stats_.steps += steps;
+        idle_stats_.time += now - start;
+        if (idle_done_) {
+            idle_stats_.rounds++;
+        }
+        finalizer_.Flush();
+    }
+    return !idle_done_;
+}
+
+// For OS memory warnings: drops the wrapper pool and cached scripts, then
+// has V8 collect everything it can.
+void zb::Runtime::LowMemory()
+{
+    if (Recorder::enabled()) {
+        Recorder::RecordInput(Record::kLowMemory);
+    }
+    v8::Locker locker(isolate_);
+    v8::Isolate::Scope isolate_scope(isolate_);
+    HandleScope handle_scope;
+    // With no budget, the weak callbacks the collection runs release
+    // their views instead of reserving the room just freed; wrappers
+    // reserved before still reach the pool in Flush and go with it.
+    size_t budget = view_pool_.budget();
+    view_pool_.set_budget(0);
+    script_cache_.Dispose();
+    v8::V8::LowMemoryNotification();
+    finalizer_.Flush();
+    view_pool_.Dispose();
+    view_pool_.set_budget(budget);
+    idle_done_ = true;
+    idle_stats_.low_memory++;
+}
+
+double zb::Runtime::Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The clock timers count their delays from: Now(), unless SetClock put
+// another one in, as replays do to get the readings the recording saw.
+double zb::Runtime::TimerClock()
+{
+    double now = clock_ != NULL ? clock_(clock_data_) : Now();
+    if (Recorder::enabled()) {
+        Recorder::RecordTime(Record::kClock, now);
+    }
+    return now;
+}
+
+void zb::Runtime::SetClock(Clock clock, void *data)
+{
+    clock_ = clock;
+    clock_data_ = data;
+}
+
+// GC callbacks carry no data; the runtime is the isolate's data.
+void zb::Runtime::OnGCEpilogue(v8::GCType type, v8::GCCallbackFlags flags)
+{
+    static_cast<Runtime *>(v8::Isolate::GetCurrent()->GetData())->finalizer()->Seal();
+}
+
+void zb::Runtime::ReportException(v8::TryCatch *try_catch)
+{
+    v8::String::Utf8Value exception(try_catch->Exception());
+    const char *message = *exception ? *exception : "<string conversion failed>";
+    log_->Write(LogChannel::kError, message, strlen(message));
+}
+
+// Joins the arguments with spaces straight into a record-sized buffer;
+// anything past LogChannel::kMaxMessage is cut. A call site that logs
+// faster than |limiter| allows is counted, not written; sites are told
+// apart by script name, line and column. False if an argument's toString
+// threw.
+bool zb::Runtime::LogArguments(const v8::Arguments &args, LogChannel *log, LogChannel::Level level, LogRateLimiter *limiter)
+{
+    if (!log->IsEnabled(level)) {
+        return true;
+    }
+    if (limiter != NULL && !limiter->AllowAny()) {
+        v8::HandleScope handle_scope;
+        v8::Local<v8::StackTrace> trace = v8::StackTrace::CurrentStackTrace(1, static_cast<v8::StackTrace::StackTraceOptions>(v8::StackTrace::kColumnOffset | v8::StackTrace::kScriptName));
+        if (trace->GetFrameCount() > 0) {
+            v8::Local<v8::StackFrame> frame = trace->GetFrame(0);
+            v8::String::Utf8Value script(frame->GetScriptName());
+            uint64_t site = ScriptCache::Hash(*script, *script != NULL ? script.length() : 0) ^
+                (static_cast<uint64_t>(frame->GetLineNumber()) << 32 | static_cast<uint32_t>(frame->GetColumn()));
+            if (!limiter->Allow(site)) {
+                log->CountSuppressed(1);
+                return true;
+            }
+        }
+    }
+    char message[LogChannel::kMaxMessage];
+    int length = 0;
+    for (int i = 0; i < args.Length() && length < LogChannel::kMaxMessage; i++) {
+        v8::HandleScope handle_scope;
+        v8::Local<v8::String> string = args[i]->ToString();
+        if (string.IsEmpty()) {
+            return false;
+        }
+        if (i > 0) {
+            message[length++] = ' ';
+        }
+        length += string->WriteUtf8(message + length, LogChannel::kMaxMessage - length, NULL, v8::String::NO_NULL_TERMINATION);
+    }
+    log->Write(level, message, length);
+    return true;
+}
+
+template <zb::LogChannel::Level level>
+v8::Handle<v8::Value> zb::Runtime::Log(const v8::Arguments &args)
+{
+    Runtime *runtime = static_cast<Runtime *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    if (!LogArguments(args, runtime->log_, level, runtime->log_limiter())) {
+        return v8::Handle<v8::Value>();
+    }
+    return args.This();
+}
+
+// The buffer is exposed lazily so runtimes whose scripts never touch it
+// keep committing only the views their setters marked.
+v8::Handle<v8::Value> zb::Runtime::GetGeometry(v8::Local<v8::String> propertyName, const v8::AccessorInfo& info)
+{
+    Runtime *runtime = static_cast<Runtime *>(v8::Local<v8::External>::Cast(info.Data())->Value());
+    return runtime->geometry()->Expose();
+}
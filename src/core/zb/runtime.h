@@ -0,0 +1,137 @@
+//
+//  runtime.h
+//  zb
+//
+//  Created by  on 12/02/20.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_RUNTIME_H_
+#define ZB_RUNTIME_H_
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include "v8.h"
+#include "v8stdint.h"
+#include "backend.h"
+#include "event.h"
+#include "event_loop.h"
+#include "finalization.h"
+#include "geometry.h"
+#include "log_channel.h"
+#include "marshal.h"
+#include "script_cache.h"
+#include "shadow_tree.h"
+#include "template_cache.h"
+#include "transaction.h"
+#include "worker.h"
+#include "wrapper_pool.h"
+
+namespace zb {
+    class View;
+    
+    // Owns one isolate and a warm context with the bridge globals installed,
+    // so scripts only pay for their own compile and run.
+    class Runtime {
+    public:
+        struct IdleStats {
+            int64_t periods;     // Idle calls that got to do GC work
+            int64_t steps;       // IdleNotification calls
+            int64_t rounds;      // times V8 reported nothing left to do
+            int64_t low_memory;  // LowMemory calls
+            double time;         // seconds spent in GC steps
+        };
+        
+        // Returns a time on the Now() clock.
+        typedef double (*Clock)(void *data);
+        
+        explicit Runtime(Backend *backend);
+        ~Runtime();
+        v8::Persistent<v8::Context> NewContext();
+        bool Run(const char *source);
+        bool Run(v8::String::ExternalAsciiStringResource *source);
+        bool Run(v8::String::ExternalStringResource *source);
+        bool RunFile(const char *path);
+        bool Call(const char *function, Variant *argument, Variant *result = NULL);
+        bool Bootstrap(const char *name, const char *source);
+        bool IsPreloaded(const char *name);
+        void Commit();
+        void DispatchEvent(const Event &event);
+        void DispatchEvents(const Event *events, int count);
+        int RunTimers(double now);
+        int RunFrame(double timestamp);
+        double NextTimer() const { return event_loop_.NextTimer(); }
+        bool HasFrameCallbacks() const { return event_loop_.HasFrameCallbacks(); }
+        bool Idle(double deadline = 0);
+        void LowMemory();
+        int AddAnimationCallback(v8::Handle<v8::Function> callback);
+        void AddWorker(int id, v8::Handle<v8::Object> worker);
+        void RemoveWorker(int id);
+        int DeliverWorkerMessages();
+        Backend *backend() const { return backend_; }
+        GeometryBuffer *geometry() { return &geometry_; }
+        Transaction *transaction() { return &transaction_; }
+        ScriptCache *script_cache() { return &script_cache_; }
+        WrapperPool<View> *view_pool() { return &view_pool_; }
+        FinalizationRegistry *finalizer() { return &finalizer_; }
+        ShadowTree *shadow_tree() { return &shadow_tree_; }
+        TemplateCache *templates() { return &templates_; }
+        EventLoop *event_loop() { return &event_loop_; }
+        Marshaller *marshaller() { return &marshaller_; }
+        LogRateLimiter *log_limiter() { return &log_limiter_; }
+        std::set<Worker *> *worker_objects() { return &worker_objects_; }
+        void set_write_preparse(bool write) { write_preparse_ = write; }
+        double TimerClock();
+        void SetClock(Clock clock, void *data);
+        const std::shared_ptr<WorkerInbox> &worker_inbox() const { return worker_inbox_; }
+        const IdleStats &idle_stats() const { return idle_stats_; }
+        v8::Isolate *isolate() const { return isolate_; }
+        v8::Handle<v8::Context> context() const { return context_; }
+        
+        // Seconds on a monotonic clock, the one Idle deadlines use.
+        static double Now();
+        static void OnGCEpilogue(v8::GCType type, v8::GCCallbackFlags flags);
+        static bool LogArguments(const v8::Arguments& args, LogChannel *log, LogChannel::Level level, LogRateLimiter *limiter);
+        template <LogChannel::Level level>
+        static v8::Handle<v8::Value> Log(const v8::Arguments& args);
+        static v8::Handle<v8::Value> GetGeometry(v8::Local<v8::String> propertyName, const v8::AccessorInfo& info);
+    private:
+        v8::Handle<v8::ObjectTemplate> CreateGlobalTemplate();
+        v8::Handle<v8::FunctionTemplate> CreateLogTemplate();
+        bool Execute(v8::Handle<v8::Script> script, v8::TryCatch *try_catch);
+        v8::Handle<v8::String> NextBundleName();
+        void DispatchAnimationEvent(const Event &event);
+        void ReportException(v8::TryCatch *try_catch);
+        
+        Backend *backend_;
+        GeometryBuffer geometry_;
+        Transaction transaction_;
+        ScriptCache script_cache_;
+        WrapperPool<View> view_pool_;
+        FinalizationRegistry finalizer_;
+        ShadowTree shadow_tree_;
+        LogChannel *log_;
+        LogRateLimiter log_limiter_;
+        std::map<int, v8::Persistent<v8::Function> > animation_callbacks_;
+        int next_animation_;
+        int next_bundle_;
+        std::shared_ptr<WorkerInbox> worker_inbox_;
+        std::map<int, v8::Persistent<v8::Object> > workers_;
+        std::set<Worker *> worker_objects_;
+        IdleStats idle_stats_;
+        bool idle_done_;
+        double idle_step_estimate_;
+        bool write_preparse_;
+        Clock clock_;
+        void *clock_data_;
+        v8::Isolate *isolate_;
+        TemplateCache templates_;
+        EventLoop event_loop_;
+        Marshaller marshaller_;
+        v8::Persistent<v8::Context> context_;
+    };
+}
+
+#endif  // ZB_RUNTIME_H_
@@ -0,0 +1,89 @@
+//
+//  script_cache.cc
+//  zb
+//
+//  Created by  on 12/03/07.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "script_cache.h"
+
+zb::ScriptCache::ScriptCache(size_t capacity)
+    : capacity_(capacity), clock_(0)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+zb::ScriptCache::~ScriptCache()
+{
+}
+
+// 64-bit FNV-1a; cheap next to the compile a hit saves.
+uint64_t zb::ScriptCache::Hash(const char *source, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(source[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Returns the cached script for the source, compiling and caching it on a
+// miss. An empty handle means a compile error, left in the caller's
+// TryCatch; failed compiles are not cached.
+v8::Local<v8::Script> zb::ScriptCache::Compile(const char *source, size_t length)
+{
+    uint64_t hash = Hash(source, length);
+    std::pair<EntryMap::iterator, EntryMap::iterator> range = entries_.equal_range(hash);
+    for (EntryMap::iterator it = range.first; it != range.second; ++it) {
+        Entry &entry = it->second;
+        if (entry.source.size() == length && memcmp(entry.source.data(), source, length) == 0) {
+            stats_.hits++;
+            entry.last_use = ++clock_;
+            return v8::Local<v8::Script>::New(entry.script);
+        }
+    }
+    
+    // Named after the miss so each distinct source shows up as its own
+    // script in stack frames.
+    stats_.misses++;
+    char name[32];
+    snprintf(name, sizeof(name), "zb:script:%lld", static_cast<long long>(stats_.misses));
+    v8::Local<v8::Script> script = v8::Script::New(v8::String::New(source, static_cast<int>(length)), v8::String::New(name));
+    if (script.IsEmpty() || capacity_ == 0) {
+        return script;
+    }
+    if (entries_.size() >= capacity_) {
+        EvictOldest();
+    }
+    EntryMap::iterator it = entries_.insert(std::make_pair(hash, Entry()));
+    it->second.source.assign(source, length);
+    it->second.script = v8::Persistent<v8::Script>::New(script);
+    it->second.last_use = ++clock_;
+    return script;
+}
+
+void zb::ScriptCache::EvictOldest()
+{
+    EntryMap::iterator oldest = entries_.begin();
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->second.last_use < oldest->second.last_use) {
+            oldest = it;
+        }
+    }
+    oldest->second.script.Dispose();
+    entries_.erase(oldest);
+    stats_.evictions++;
+}
+
+void zb::ScriptCache::Dispose()
+{
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        it->second.script.Dispose();
+    }
+    entries_.clear();
+}
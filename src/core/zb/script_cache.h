@@ -0,0 +1,58 @@
+//
+//  script_cache.h
+//  zb
+//
+//  Created by  on 12/03/07.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_SCRIPT_CACHE_H_
+#define ZB_SCRIPT_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#include "v8.h"
+
+namespace zb {
+    // Context-independent compiled scripts keyed by a hash of their source,
+    // so handlers run over and over skip scanning, parsing and codegen.
+    // Entries keep a copy of the source and a hit is only taken when it
+    // matches byte for byte. The least recently used entry is dropped once
+    // the cache is full. Use from inside the owning isolate.
+    class ScriptCache {
+    public:
+        struct Stats {
+            int64_t hits;
+            int64_t misses;
+            int64_t evictions;
+        };
+        
+        explicit ScriptCache(size_t capacity = 64);
+        ~ScriptCache();
+        v8::Local<v8::Script> Compile(const char *source, size_t length);
+        void Dispose();
+        size_t size() const { return entries_.size(); }
+        const Stats &stats() const { return stats_; }
+        
+        static uint64_t Hash(const char *source, size_t length);
+    private:
+        struct Entry {
+            std::string source;
+            v8::Persistent<v8::Script> script;
+            uint64_t last_use;
+        };
+        typedef std::unordered_multimap<uint64_t, Entry> EntryMap;
+        
+        void EvictOldest();
+        
+        EntryMap entries_;
+        size_t capacity_;
+        uint64_t clock_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_SCRIPT_CACHE_H_
@@ -0,0 +1,289 @@
+//
+//  script_thread.cc
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include "script_thread.h"
+
+zb::ScriptThread::ScriptThread(size_t command_capacity, size_t event_capacity)
+    : commands_(command_capacity), backend_(&commands_), events_(event_capacity),
+      stopping_(false), busy_(false), messages_(false), low_memory_(false), inbox_(NULL), drain_request_(NULL), drain_request_data_(NULL),
+      dropped_events_(0), frame_start_(Runtime::Now()), frame_interval_(1.0 / 60),
+      input_due_(0), last_frame_(0), timers_(false), finished_(false)
+{
+}
+
+zb::ScriptThread::~ScriptThread()
+{
+    Stop();
+}
+
+void zb::ScriptThread::SetDrainRequest(DrainRequest request, void *data)
+{
+    drain_request_ = request;
+    drain_request_data_ = data;
+}
+
+void zb::ScriptThread::Start()
+{
+    finished_.store(false, std::memory_order_relaxed);
+    thread_ = std::thread([this] {
+        Main();
+        finished_.store(true, std::memory_order_release);
+    });
+}
+
+// Runs whatever is still queued, then tears the runtime down on its own
+// thread. The script thread stalls on a full command ring, so this keeps
+// emptying it until the thread is done.
+void zb::ScriptThread::Stop(Backend *target)
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    while (!finished_.load(std::memory_order_acquire)) {
+        if (target != NULL) {
+            commands_.Drain(target);
+        } else {
+            commands_.Discard();
+        }
+        std::this_thread::yield();
+    }
+    thread_.join();
+    if (target != NULL) {
+        commands_.Drain(target);
+    }
+}
+
+void zb::ScriptThread::Post(const char *source)
+{
+    Script script = { source, NULL, NULL, NULL, NULL, NULL, false };
+    Enqueue(script);
+}
+
+void zb::ScriptThread::Post(v8::String::ExternalAsciiStringResource *source)
+{
+    Script script = { std::string(), source, NULL, NULL, NULL, NULL, false };
+    Enqueue(script);
+}
+
+void zb::ScriptThread::Post(v8::String::ExternalStringResource *source)
+{
+    Script script = { std::string(), NULL, source, NULL, NULL, NULL, false };
+    Enqueue(script);
+}
+
+// The file is opened on the script thread, which also looks for its
+// preparse data there.
+void zb::ScriptThread::PostFile(const std::string &path)
+{
+    Script script = { path, NULL, NULL, NULL, NULL, NULL, true };
+    Enqueue(script);
+}
+
+// Runs in order with the posted scripts. |done|, if given, is called on the
+// script thread with whatever the function returned.
+void zb::ScriptThread::PostCall(const std::string &function, Variant *argument, CallResult done, void *data)
+{
+    Script script = { function, NULL, NULL, argument != NULL ? argument : new Variant(), done, data, false };
+    Enqueue(script);
+}
+
+void zb::ScriptThread::Enqueue(const Script &script)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scripts_.push_back(script);
+    }
+    wake_.notify_one();
+}
+
+// The event ring is lock-free; the mutex is only taken so a sleeping
+// script thread cannot miss the wakeup.
+bool zb::ScriptThread::PostEvent(const Event &event)
+{
+    if (!events_.Push(event)) {
+        dropped_events_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+// For OS memory warnings. The runtime handles it after the current batch.
+void zb::ScriptThread::PostLowMemory()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        low_memory_ = true;
+    }
+    wake_.notify_one();
+}
+
+// True once every posted script and event has run and been committed, and
+// no worker has a job or message outstanding. Timers may still be pending;
+// see HasTimers. Commands may still be
+// waiting for Drain. There is deliberately no blocking wait: a full
+// command ring stalls the script thread until the UI thread drains, so the
+// UI thread must keep draining while it polls.
+bool zb::ScriptThread::IsIdle()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !busy_ && scripts_.empty() && events_.size() == 0 && !messages_ && (inbox_ == NULL || !inbox_->busy());
+}
+
+void zb::ScriptThread::WakeForMessages(void *data)
+{
+    ScriptThread *thread = static_cast<ScriptThread *>(data);
+    {
+        std::lock_guard<std::mutex> lock(thread->mutex_);
+        thread->messages_ = true;
+    }
+    thread->wake_.notify_one();
+}
+
+double zb::ScriptThread::NextFrame(double now) const
+{
+    double start = frame_start_.load(std::memory_order_relaxed);
+    return start + (floor((now - start) / frame_interval_) + 1) * frame_interval_;
+}
+
+// Runs whatever of the event loop is due: queued input once its frame has
+// come, expired timers, and frame callbacks once per frame. Returns whether
+// any script ran, committing if so.
+bool zb::ScriptThread::RunLoop(Runtime *runtime, double now)
+{
+    bool ran = false;
+    if (events_.size() > 0 && now >= input_due_) {
+        Event event;
+        input_.clear();
+        while (events_.Pop(&event)) {
+            input_.push_back(event);
+        }
+        runtime->DispatchEvents(&input_[0], static_cast<int>(input_.size()));
+        input_due_ = NextFrame(now);
+        ran = true;
+    }
+    if (runtime->NextTimer() <= now && runtime->RunTimers(now) > 0) {
+        ran = true;
+    }
+    double frame = NextFrame(now);
+    if (runtime->HasFrameCallbacks() && frame > last_frame_) {
+        runtime->RunFrame(now);
+        last_frame_ = frame;
+        ran = true;
+    }
+    if (ran) {
+        runtime->Commit();
+        if (drain_request_ != NULL && commands_.pending() > 0) {
+            drain_request_(drain_request_data_);
+        }
+    }
+    timers_.store(runtime->NextTimer() != HUGE_VAL || runtime->HasFrameCallbacks(), std::memory_order_release);
+    return ran;
+}
+
+void zb::ScriptThread::Main()
+{
+    Runtime runtime(&backend_);
+    runtime.worker_inbox()->SetWake(WakeForMessages, this);
+    std::deque<Script> scripts;
+    std::unique_lock<std::mutex> lock(mutex_);
+    inbox_ = runtime.worker_inbox().get();
+    for (;;) {
+        // Sleeps until the next thing due: queued input's frame, a timer,
+        // or the frame boundary when frame callbacks or GC work wait for
+        // it. Idle work stops short of the boundary by an eighth of a frame.
+        while (!HasWork()) {
+            busy_ = true;
+            lock.unlock();
+            double now = Runtime::Now();
+            if (RunLoop(&runtime, now)) {
+                lock.lock();
+                busy_ = false;
+                continue;
+            }
+            double frame = NextFrame(now);
+            double wake = runtime.NextTimer();
+            if (runtime.HasFrameCallbacks()) {
+                wake = std::min(wake, frame);
+            }
+            if (runtime.Idle(std::min(frame - frame_interval_ / 8, wake))) {
+                wake = std::min(wake, frame);
+            }
+            lock.lock();
+            busy_ = false;
+            // PostEvent only notifies; checked under the lock so an event
+            // pushed meanwhile is not slept through.
+            if (events_.size() > 0) {
+                wake = std::min(wake, input_due_);
+            }
+            if (HasWork()) {
+                break;
+            }
+            if (wake == HUGE_VAL) {
+                wake_.wait(lock);
+            } else if (wake > now) {
+                std::chrono::steady_clock::time_point until(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(wake)));
+                wake_.wait_until(lock, until);
+            }
+        }
+        if (stopping_ && scripts_.empty()) {
+            break;
+        }
+        busy_ = true;
+        messages_ = false;
+        bool low_memory = low_memory_;
+        low_memory_ = false;
+        scripts.swap(scripts_);
+        lock.unlock();
+        
+        for (size_t i = 0; i < scripts.size(); i++) {
+            if (scripts[i].argument != NULL) {
+                Variant result;
+                bool ok = runtime.Call(scripts[i].source.c_str(), scripts[i].argument, scripts[i].done != NULL ? &result : NULL);
+                delete scripts[i].argument;
+                if (scripts[i].done != NULL) {
+                    scripts[i].done(scripts[i].done_data, ok, &result);
+                }
+            } else if (scripts[i].file) {
+                runtime.RunFile(scripts[i].source.c_str());
+            } else if (scripts[i].ascii != NULL) {
+                runtime.Run(scripts[i].ascii);
+            } else if (scripts[i].utf16 != NULL) {
+                runtime.Run(scripts[i].utf16);
+            } else {
+                runtime.Run(scripts[i].source.c_str());
+            }
+        }
+        scripts.clear();
+        runtime.DeliverWorkerMessages();
+        runtime.Commit();
+        if (low_memory) {
+            runtime.LowMemory();
+        }
+        RunLoop(&runtime, Runtime::Now());
+        if (drain_request_ != NULL && commands_.pending() > 0) {
+            drain_request_(drain_request_data_);
+        }
+        
+        lock.lock();
+        busy_ = false;
+    }
+    inbox_ = NULL;
+}
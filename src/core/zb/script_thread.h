@@ -0,0 +1,127 @@
+//
+//  script_thread.h
+//  zb
+//
+//  Created by  on 12/03/05.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_SCRIPT_THREAD_H_
+#define ZB_SCRIPT_THREAD_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "v8.h"
+#include "command_queue.h"
+#include "event.h"
+#include "ring.h"
+#include "runtime.h"
+#include "worker.h"
+
+namespace zb {
+    // Runs a Runtime on its own thread so script work and GC pauses stay
+    // off the UI thread. Mutations reach the UI thread through a command
+    // ring drained with Drain; input comes back through an event ring, and
+    // messages from the runtime's workers wake the thread as they arrive.
+    //
+    // Input is delivered at most once a frame: the first event of a frame
+    // goes to the script at once, later ones wait for the next frame
+    // boundary and go together, their moves coalesced. Timers run as they
+    // come due and requestAnimationFrame callbacks once a frame. In the
+    // time left the thread gives V8 incremental GC steps, stopping a
+    // little before each frame boundary so the next frame is not held up
+    // by a collection. Frames are counted from the last BeginFrame, which
+    // hosts call from their display refresh.
+    //
+    // Threading: Post may be called from any thread; posted external
+    // resources are owned by the script thread from then on. PostEvent,
+    // Drain and Stop must each be called from a single UI thread. Stop
+    // keeps draining into |target| while the runtime is torn down, since
+    // teardown may fill the command ring; without a target, what is left
+    // is discarded.
+    class ScriptThread {
+    public:
+        // Called on the script thread after a batch left commands behind;
+        // hosts use it to schedule a Drain on the UI thread.
+        typedef void (*DrainRequest)(void *data);
+        
+        // Gets a PostCall's result on the script thread; the Variant is
+        // only valid during the call.
+        typedef void (*CallResult)(void *data, bool ok, Variant *result);
+        
+        explicit ScriptThread(size_t command_capacity = 16384, size_t event_capacity = 1024);
+        ~ScriptThread();
+        void SetDrainRequest(DrainRequest request, void *data);
+        void Start();
+        void Stop(Backend *target = NULL);
+        void Post(const char *source);
+        void Post(v8::String::ExternalAsciiStringResource *source);
+        void Post(v8::String::ExternalStringResource *source);
+        void PostFile(const std::string &path);
+        void PostCall(const std::string &function, Variant *argument, CallResult done = NULL, void *data = NULL);
+        bool PostEvent(const Event &event);
+        void PostLowMemory();
+        void BeginFrame() { frame_start_.store(Runtime::Now(), std::memory_order_relaxed); }
+        void set_frame_interval(double interval) { frame_interval_ = interval; }
+        int Drain(Backend *target) { return commands_.Drain(target); }
+        bool IsIdle();
+        bool HasTimers() const { return timers_.load(std::memory_order_acquire); }
+        
+        int64_t dropped_events() const { return dropped_events_.load(std::memory_order_relaxed); }
+        int64_t command_stalls() const { return commands_.stalls(); }
+    private:
+        // Either a copied source or an external resource the runtime takes
+        // over when it runs the script, a file, whose path is in source, or
+        // a call: then source names the function and argument is owned
+        // until it runs.
+        struct Script {
+            std::string source;
+            v8::String::ExternalAsciiStringResource *ascii;
+            v8::String::ExternalStringResource *utf16;
+            Variant *argument;
+            CallResult done;
+            void *done_data;
+            bool file;
+        };
+        
+        void Enqueue(const Script &script);
+        bool HasWork() const { return stopping_ || !scripts_.empty() || messages_ || low_memory_; }
+        double NextFrame(double now) const;
+        bool RunLoop(Runtime *runtime, double now);
+        void Main();
+        
+        static void WakeForMessages(void *data);
+        
+        CommandQueue commands_;
+        QueuedBackend backend_;
+        SpscRing<Event> events_;
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::deque<Script> scripts_;
+        bool stopping_;
+        bool busy_;
+        bool messages_;
+        bool low_memory_;
+        WorkerInbox *inbox_;
+        DrainRequest drain_request_;
+        void *drain_request_data_;
+        std::atomic<int64_t> dropped_events_;
+        std::atomic<double> frame_start_;
+        double frame_interval_;
+        double input_due_;
+        double last_frame_;
+        std::vector<Event> input_;
+        std::atomic<bool> timers_;
+        std::atomic<bool> finished_;
+    };
+}
+
+#endif  // ZB_SCRIPT_THREAD_H_
@@ -0,0 +1,420 @@
+//
+//  shadow_tree.cc
+//  zb
+//
+//  Created by  on 12/03/09.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <string.h>
+#include <unordered_map>
+
+#include "shadow_tree.h"
+#include "binding.h"
+#include "runtime.h"
+#include "view.h"
+
+using namespace v8;
+
+namespace {
+    enum Symbol {
+        kKey,
+        kX,
+        kY,
+        kWidth,
+        kHeight,
+        kAlpha,
+        kChildren,
+        kFlexDirection,
+        kJustifyContent,
+        kAlignItems,
+        kFlex,
+        kPadding,
+        kMargin,
+        kSymbolCount
+    };
+
+    const char *const kSymbolNames[kSymbolCount] = {
+        "key", "x", "y", "width", "height", "alpha", "children",
+        "flexDirection", "justifyContent", "alignItems", "flex", "padding", "margin"
+    };
+
+    struct AlignName {
+        const char *name;
+        zb::FlexAlign align;
+    };
+
+    const AlignName kJustifyNames[] = {
+        { "flex-start", zb::kAlignStart },
+        { "center", zb::kAlignCenter },
+        { "flex-end", zb::kAlignEnd },
+        { "space-between", zb::kAlignSpaceBetween },
+        { NULL, zb::kAlignStart }
+    };
+
+    const AlignName kAlignNames[] = {
+        { "flex-start", zb::kAlignStart },
+        { "center", zb::kAlignCenter },
+        { "flex-end", zb::kAlignEnd },
+        { "stretch", zb::kAlignStretch },
+        { NULL, zb::kAlignStart }
+    };
+
+    bool ParseAlign(v8::Handle<v8::Value> value, const AlignName *names, zb::FlexAlign *out)
+    {
+        std::string name;
+        if (value.IsEmpty() || !zb::Converter<std::string>::FromV8(value, &name)) {
+            return false;
+        }
+        for (; names->name != NULL; names++) {
+            if (name == names->name) {
+                *out = names->align;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void DeleteNodes(zb::ShadowNode *node)
+    {
+        for (size_t i = 0; i < node->children.size(); i++) {
+            DeleteNodes(node->children[i]);
+        }
+        delete node;
+    }
+}
+
+// Parsed form of one script description; Render parses the whole tree
+// before touching the retained one, so a bad description changes nothing.
+struct zb::ShadowTree::Description {
+    std::string key;
+    Frame frame;
+    float alpha;
+    LayoutStyle style;
+    std::vector<Description> children;
+};
+
+zb::ShadowTree::ShadowTree(Backend *backend)
+    : backend_(backend), root_(NULL), layout_(backend)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+// Like the natives of View wrappers, rendered views outlive the runtime;
+// only the shadow nodes go away with it.
+zb::ShadowTree::~ShadowTree()
+{
+    if (root_ != NULL) {
+        DeleteNodes(root_);
+    }
+}
+
+void zb::ShadowTree::Dispose()
+{
+    container_.Dispose();
+    container_.Clear();
+    for (int i = 0; i < kSymbolCount; i++) {
+        symbols_[i].Dispose();
+        symbols_[i].Clear();
+    }
+}
+
+// |container| is a View wrapper, or empty to render the tree detached.
+bool zb::ShadowTree::Render(v8::Handle<v8::Value> value, v8::Handle<v8::Object> container)
+{
+    if (symbols_[0].IsEmpty()) {
+        for (int i = 0; i < kSymbolCount; i++) {
+            symbols_[i] = v8::Persistent<v8::String>::New(v8::String::NewSymbol(kSymbolNames[i]));
+        }
+    }
+    Description description;
+    if (!Parse(value, &description)) {
+        return false;
+    }
+
+    NativeView native = container.IsEmpty() ? NULL : Unwrap<View>(container)->native();
+    bool moved = container_ != container;
+    stats_.renders++;
+    backend_->BeginCommit();
+    if (root_ != NULL && root_->key == description.key) {
+        Update(root_, description, false);
+        if (moved) {
+            if (native != NULL) {
+                backend_->AddSubview(native, root_->native);
+            } else {
+                backend_->RemoveFromSuperview(root_->native);
+            }
+            stats_.moved++;
+        }
+    } else {
+        if (root_ != NULL) {
+            Destroy(root_);
+        }
+        root_ = Create(description, false);
+        if (native != NULL) {
+            backend_->AddSubview(native, root_->native);
+        }
+    }
+    layout_.Layout(root_);
+    if (moved) {
+        container_.Dispose();
+        container_.Clear();
+        if (!container.IsEmpty()) {
+            container_ = v8::Persistent<v8::Object>::New(container);
+        }
+    }
+    backend_->EndCommit();
+    return true;
+}
+
+bool zb::ShadowTree::Parse(v8::Handle<v8::Value> value, Description *out)
+{
+    if (!value->IsObject()) {
+        return false;
+    }
+    v8::Local<v8::Object> object = value->ToObject();
+    v8::Local<v8::Value> key = object->Get(symbols_[kKey]);
+    if (key.IsEmpty() || (!key->IsUndefined() && !Converter<std::string>::FromV8(key, &out->key))) {
+        return false;
+    }
+
+    out->style = DefaultLayoutStyle();
+    float *fields[] = { &out->frame.x, &out->frame.y, &out->frame.width, &out->frame.height, &out->alpha };
+    const float defaults[] = { 0, 0, 0, 0, 1 };
+    for (int i = 0; i < 5; i++) {
+        v8::Local<v8::Value> field = object->Get(symbols_[kX + i]);
+        if (field.IsEmpty()) {
+            return false;
+        }
+        *fields[i] = defaults[i];
+        if (!field->IsUndefined()) {
+            Converter<float>::FromV8(field, fields[i]);
+            if (i == kWidth - kX) {
+                out->style.width = *fields[i];
+            } else if (i == kHeight - kX) {
+                out->style.height = *fields[i];
+            }
+        }
+    }
+
+    v8::Local<v8::Value> direction = object->Get(symbols_[kFlexDirection]);
+    if (direction.IsEmpty()) {
+        return false;
+    }
+    if (!direction->IsUndefined()) {
+        std::string name;
+        if (!Converter<std::string>::FromV8(direction, &name)) {
+            return false;
+        }
+        if (name == "row") {
+            out->style.direction = kFlexRow;
+        } else if (name == "column") {
+            out->style.direction = kFlexColumn;
+        } else {
+            return false;
+        }
+    }
+    v8::Local<v8::Value> justify = object->Get(symbols_[kJustifyContent]);
+    if (justify.IsEmpty() || (!justify->IsUndefined() && !ParseAlign(justify, kJustifyNames, &out->style.justify))) {
+        return false;
+    }
+    v8::Local<v8::Value> align = object->Get(symbols_[kAlignItems]);
+    if (align.IsEmpty() || (!align->IsUndefined() && !ParseAlign(align, kAlignNames, &out->style.align))) {
+        return false;
+    }
+    float *metrics[] = { &out->style.grow, &out->style.padding, &out->style.margin };
+    const Symbol metric_symbols[] = { kFlex, kPadding, kMargin };
+    for (int i = 0; i < 3; i++) {
+        v8::Local<v8::Value> field = object->Get(symbols_[metric_symbols[i]]);
+        if (field.IsEmpty()) {
+            return false;
+        }
+        if (!field->IsUndefined()) {
+            Converter<float>::FromV8(field, metrics[i]);
+        }
+    }
+
+    v8::Local<v8::Value> children = object->Get(symbols_[kChildren]);
+    if (children.IsEmpty()) {
+        return false;
+    }
+    if (children->IsArray()) {
+        v8::Local<v8::Array> array = v8::Local<v8::Array>::Cast(children);
+        uint32_t length = array->Length();
+        out->children.reserve(length);
+        for (uint32_t i = 0; i < length; i++) {
+            v8::Local<v8::Value> child = array->Get(i);
+            if (child.IsEmpty()) {
+                return false;
+            }
+            if (child->IsNull() || child->IsUndefined()) {
+                continue;
+            }
+            out->children.push_back(Description());
+            if (!Parse(child, &out->children.back())) {
+                return false;
+            }
+        }
+    } else if (!children->IsUndefined()) {
+        return false;
+    }
+    return true;
+}
+
+// A managed node sits in a flex container and gets its frame from the
+// layout pass instead of its description.
+zb::ShadowNode *zb::ShadowTree::Create(const Description &description, bool managed)
+{
+    const Frame zero = { 0, 0, 0, 0 };
+    ShadowNode *node = new ShadowNode();
+    node->key = description.key;
+    node->frame = managed ? zero : description.frame;
+    node->alpha = description.alpha;
+    node->style = description.style;
+    node->dirty = true;
+    node->dirty_descendant = !description.children.empty();
+    node->layout_width = kLayoutAuto;
+    node->layout_height = kLayoutAuto;
+    node->native = backend_->CreateView();
+    if (!SameFrame(node->frame, zero)) {
+        backend_->SetFrame(node->native, node->frame);
+    }
+    if (node->alpha != 1) {
+        backend_->SetAlpha(node->native, node->alpha);
+    }
+    stats_.created++;
+
+    node->children.reserve(description.children.size());
+    bool container = description.style.direction != kFlexNone;
+    for (size_t i = 0; i < description.children.size(); i++) {
+        ShadowNode *child = Create(description.children[i], container);
+        backend_->AddSubview(node->native, child->native);
+        node->children.push_back(child);
+    }
+    return node;
+}
+
+// Returns whether the node's layout style changed, which means its parent
+// has to lay out its children again.
+bool zb::ShadowTree::Update(ShadowNode *node, const Description &description, bool managed)
+{
+    bool changed = false;
+    if (!managed && !SameFrame(node->frame, description.frame)) {
+        node->frame = description.frame;
+        backend_->SetFrame(node->native, node->frame);
+        changed = true;
+    }
+    if (node->alpha != description.alpha) {
+        node->alpha = description.alpha;
+        backend_->SetAlpha(node->native, node->alpha);
+        changed = true;
+    }
+    if (changed) {
+        stats_.updated++;
+    }
+    bool restyled = node->style != description.style;
+    if (restyled) {
+        node->style = description.style;
+        node->dirty = true;
+    }
+    ReconcileChildren(node, description.children);
+    return restyled;
+}
+
+// Children without a key are matched by position. The backend can only
+// append subviews, so once a child has to be appended (because it is new
+// or came before an earlier kept sibling), every later child is appended
+// again to keep the order; appends and removals at the end move nothing.
+void zb::ShadowTree::ReconcileChildren(ShadowNode *node, const std::vector<Description> &descriptions)
+{
+    std::unordered_map<std::string, size_t> old_index;
+    std::vector<std::string> keys(node->children.size());
+    for (size_t i = 0; i < node->children.size(); i++) {
+        const std::string &key = node->children[i]->key;
+        keys[i] = key.empty() ? "#" + std::to_string(i) : key;
+        old_index[keys[i]] = i;
+    }
+
+    std::vector<ShadowNode *> old_children;
+    old_children.swap(node->children);
+    node->children.reserve(descriptions.size());
+    bool managed = node->style.direction != kFlexNone;
+    bool reordered = old_children.size() != descriptions.size();
+    bool append = false;
+    size_t last_kept = 0;
+    bool kept_any = false;
+    for (size_t i = 0; i < descriptions.size(); i++) {
+        const Description &description = descriptions[i];
+        std::string key = description.key.empty() ? "#" + std::to_string(i) : description.key;
+        std::unordered_map<std::string, size_t>::iterator match = old_index.find(key);
+        ShadowNode *child;
+        if (match == old_index.end() || old_children[match->second] == NULL) {
+            child = Create(description, managed);
+            backend_->AddSubview(node->native, child->native);
+            append = true;
+            reordered = true;
+        } else {
+            size_t index = match->second;
+            child = old_children[index];
+            old_children[index] = NULL;
+            if (Update(child, description, managed) || index != i) {
+                reordered = true;
+            }
+            if (append || (kept_any && index < last_kept)) {
+                backend_->AddSubview(node->native, child->native);
+                stats_.moved++;
+                append = true;
+            } else {
+                last_kept = index;
+                kept_any = true;
+            }
+        }
+        if (child->dirty || child->dirty_descendant) {
+            node->dirty_descendant = true;
+        }
+        node->children.push_back(child);
+    }
+    if (reordered) {
+        node->dirty = true;
+    }
+    for (size_t i = 0; i < old_children.size(); i++) {
+        if (old_children[i] != NULL) {
+            Destroy(old_children[i]);
+        }
+    }
+}
+
+void zb::ShadowTree::Destroy(ShadowNode *node)
+{
+    for (size_t i = 0; i < node->children.size(); i++) {
+        Destroy(node->children[i]);
+    }
+    backend_->DestroyView(node->native);
+    stats_.removed++;
+    delete node;
+}
+
+v8::Handle<v8::Value> zb::ShadowTree::Render(const v8::Arguments &args)
+{
+    Runtime *runtime = static_cast<Runtime *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    v8::Local<v8::Object> container;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        if (UnwrapChecked<View>(args[1]) == NULL) {
+            return ThrowArgumentError(1);
+        }
+        container = args[1]->ToObject();
+    }
+    v8::TryCatch try_catch;
+    if (!runtime->shadow_tree()->Render(args[0], container)) {
+        if (try_catch.HasCaught()) {
+            return try_catch.ReThrow();
+        }
+        return v8::ThrowException(v8::Exception::TypeError(v8::String::New("invalid view description")));
+    }
+    return v8::Undefined();
+}
+
+void zb::ShadowTree::InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime)
+{
+    global->Set(v8::String::NewSymbol("Render"), v8::FunctionTemplate::New(Trace<ShadowTree::Render>("Render"), v8::External::New(runtime)));
+}
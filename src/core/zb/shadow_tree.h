@@ -0,0 +1,95 @@
+//
+//  shadow_tree.h
+//  zb
+//
+//  Created by  on 12/03/09.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_SHADOW_TREE_H_
+#define ZB_SHADOW_TREE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+#include "backend.h"
+#include "layout.h"
+
+namespace zb {
+    class Runtime;
+
+    struct ShadowNode {
+        std::string key;
+        Frame frame;
+        float alpha;
+        NativeView native;
+        std::vector<ShadowNode *> children;
+        LayoutStyle style;
+        bool dirty;             // children need laying out again
+        bool dirty_descendant;  // some node below is dirty
+        float layout_width;     // size the children were last laid out for
+        float layout_height;
+    };
+
+    // Retained copy of the view tree a script last rendered. Render takes a
+    // plain description,
+    //
+    //   Render({ x: 0, y: 0, width: 320, height: 480, children: [
+    //       { key: 'title', y: 20, width: 320, height: 44, alpha: 0.8 } ] },
+    //       container);
+    //
+    // diffs it against the retained tree and sends the backend only the
+    // creates, frame and alpha writes, moves and removals that differ, all
+    // inside one backend commit. Children are matched by key, or by
+    // position when they have none. The container View is held while the
+    // tree is rendered into it, so its native view cannot be pooled and
+    // recycled from under the tree.
+    //
+    // A description with flexDirection ('row' or 'column') lays out its
+    // children instead of taking their x and y: justifyContent
+    // ('flex-start', 'center', 'flex-end', 'space-between'), alignItems
+    // ('flex-start', 'center', 'flex-end', 'stretch'), padding, and on the
+    // children flex, margin and optional width and height. Layout runs on
+    // the script thread right after the diff and only revisits containers
+    // whose children or size changed.
+    class ShadowTree {
+    public:
+        struct Stats {
+            int64_t renders;
+            int64_t created;
+            int64_t updated;
+            int64_t moved;
+            int64_t removed;
+        };
+
+        explicit ShadowTree(Backend *backend);
+        ~ShadowTree();
+        bool Render(v8::Handle<v8::Value> description, v8::Handle<v8::Object> container);
+        void Dispose();
+        const ShadowNode *root() const { return root_; }
+        const Stats &stats() const { return stats_; }
+        const LayoutEngine::Stats &layout_stats() const { return layout_.stats(); }
+
+        static v8::Handle<v8::Value> Render(const v8::Arguments &args);
+        static void InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime);
+    private:
+        struct Description;
+
+        bool Parse(v8::Handle<v8::Value> value, Description *out);
+        ShadowNode *Create(const Description &description, bool managed);
+        bool Update(ShadowNode *node, const Description &description, bool managed);
+        void ReconcileChildren(ShadowNode *node, const std::vector<Description> &descriptions);
+        void Destroy(ShadowNode *node);
+
+        Backend *backend_;
+        ShadowNode *root_;
+        v8::Persistent<v8::Object> container_;
+        v8::Persistent<v8::String> symbols_[13];
+        LayoutEngine layout_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_SHADOW_TREE_H_
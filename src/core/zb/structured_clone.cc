@@ -0,0 +1,441 @@
+//
+//  structured_clone.cc
+//  zb
+//
+//  Created by  on 12/03/14.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "structured_clone.h"
+
+namespace {
+    enum Tag {
+        kUndefined,
+        kNull,
+        kTrue,
+        kFalse,
+        kInt32,
+        kDouble,
+        kString,
+        kDate,
+        kArray,
+        kObject,
+        kExternalArray,
+        kBackReference
+    };
+
+    struct BufferType {
+        const char *name;
+        v8::ExternalArrayType type;
+    };
+
+    const BufferType kBufferTypes[] = {
+        { "int8", v8::kExternalByteArray },
+        { "uint8", v8::kExternalUnsignedByteArray },
+        { "int16", v8::kExternalShortArray },
+        { "uint16", v8::kExternalUnsignedShortArray },
+        { "int32", v8::kExternalIntArray },
+        { "uint32", v8::kExternalUnsignedIntArray },
+        { "float32", v8::kExternalFloatArray },
+        { "float64", v8::kExternalDoubleArray }
+    };
+
+    // An emptied Buffer still needs somewhere to point.
+    char empty_storage;
+
+    v8::Handle<v8::String> StoreKey()
+    {
+        return v8::String::NewSymbol("zb::Buffer");
+    }
+
+    v8::Handle<v8::Value> ThrowCloneError(const char *message)
+    {
+        return v8::ThrowException(v8::Exception::TypeError(v8::String::New(message)));
+    }
+
+    // Handle equality compares the objects themselves, inline.
+    int IndexOf(const std::vector<v8::Handle<v8::Object> > &objects, v8::Handle<v8::Object> object)
+    {
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (objects[i] == object) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+}
+
+struct zb::Buffer::Store {
+    void *data;
+    size_t bytes;
+};
+
+v8::Handle<v8::Value> zb::Buffer::New(const v8::Arguments &args)
+{
+    if (!args.IsConstructCall()) {
+        return ThrowCloneError("Buffer must be called with new");
+    }
+    int32_t length = args[0]->Int32Value();
+    if (length < 0) {
+        return v8::ThrowException(v8::Exception::RangeError(v8::String::New("invalid Buffer length")));
+    }
+    v8::ExternalArrayType type = v8::kExternalDoubleArray;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        v8::String::Utf8Value name(args[1]);
+        size_t index = 0;
+        while (index < sizeof(kBufferTypes) / sizeof(kBufferTypes[0]) && (*name == NULL || strcmp(*name, kBufferTypes[index].name) != 0)) {
+            index++;
+        }
+        if (index == sizeof(kBufferTypes) / sizeof(kBufferTypes[0])) {
+            return ThrowCloneError("unknown Buffer type");
+        }
+        type = kBufferTypes[index].type;
+    }
+    void *data = calloc(length > 0 ? length : 1, ElementSize(type));
+    Attach(args.This(), data, type, length);
+    return args.This();
+}
+
+v8::Handle<v8::Object> zb::Buffer::Adopt(void *data, v8::ExternalArrayType type, int length)
+{
+    v8::HandleScope handle_scope;
+    v8::Local<v8::Object> object = v8::Object::New();
+    Attach(object, data != NULL ? data : malloc(1), type, length);
+    return handle_scope.Close(object);
+}
+
+bool zb::Buffer::IsOwned(v8::Handle<v8::Object> object)
+{
+    return !object->GetHiddenValue(StoreKey()).IsEmpty();
+}
+
+void *zb::Buffer::Detach(v8::Handle<v8::Object> object)
+{
+    v8::Local<v8::Value> value = object->GetHiddenValue(StoreKey());
+    Store *store = static_cast<Store *>(v8::Local<v8::External>::Cast(value)->Value());
+    void *data = store->data;
+    v8::V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(store->bytes));
+    store->data = NULL;
+    store->bytes = 0;
+    object->SetIndexedPropertiesToExternalArrayData(&empty_storage, object->GetIndexedPropertiesExternalArrayDataType(), 0);
+    object->Set(v8::String::NewSymbol("length"), v8::Integer::New(0));
+    return data;
+}
+
+size_t zb::Buffer::ElementSize(v8::ExternalArrayType type)
+{
+    switch (type) {
+        case v8::kExternalByteArray:
+        case v8::kExternalUnsignedByteArray:
+        case v8::kExternalPixelArray:
+            return 1;
+        case v8::kExternalShortArray:
+        case v8::kExternalUnsignedShortArray:
+            return 2;
+        case v8::kExternalIntArray:
+        case v8::kExternalUnsignedIntArray:
+        case v8::kExternalFloatArray:
+            return 4;
+        case v8::kExternalDoubleArray:
+            return 8;
+    }
+    return 1;
+}
+
+void zb::Buffer::Attach(v8::Handle<v8::Object> object, void *data, v8::ExternalArrayType type, int length)
+{
+    Store *store = new Store;
+    store->data = data;
+    store->bytes = length * ElementSize(type);
+    object->SetIndexedPropertiesToExternalArrayData(data, type, length);
+    object->Set(v8::String::NewSymbol("length"), v8::Integer::New(length));
+    object->SetHiddenValue(StoreKey(), v8::External::New(store));
+    v8::V8::AdjustAmountOfExternalAllocatedMemory(static_cast<int>(store->bytes));
+    v8::Persistent<v8::Object> holder = v8::Persistent<v8::Object>::New(object);
+    holder.MakeWeak(store, Dispose);
+}
+
+void zb::Buffer::Dispose(v8::Persistent<v8::Value> handle, void *parameter)
+{
+    Store *store = static_cast<Store *>(parameter);
+    if (store->data != NULL) {
+        v8::V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(store->bytes));
+        free(store->data);
+    }
+    delete store;
+    handle.Dispose();
+    handle.Clear();
+}
+
+zb::SerializedValue::SerializedValue()
+{
+}
+
+// Chunks nobody read are still ours to free.
+zb::SerializedValue::~SerializedValue()
+{
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        if (chunks_[i].owned) {
+            free(chunks_[i].data);
+        }
+    }
+}
+
+// Transferred Buffers are only detached once the whole value has been
+// written, so a value that fails halfway leaves the sender untouched.
+bool zb::SerializedValue::Write(v8::Handle<v8::Value> value, v8::Handle<v8::Value> transfer)
+{
+    v8::HandleScope handle_scope;
+    v8::Handle<v8::Array> transfer_list;
+    if (!transfer.IsEmpty() && !transfer->IsUndefined()) {
+        if (!transfer->IsArray()) {
+            ThrowCloneError("the transfer list must be an array");
+            return false;
+        }
+        transfer_list = v8::Handle<v8::Array>::Cast(transfer);
+        std::vector<v8::Handle<v8::Object> > listed;
+        for (uint32_t i = 0; i < transfer_list->Length(); i++) {
+            v8::Local<v8::Value> item = transfer_list->Get(i);
+            if (!item->IsObject() || !Buffer::IsOwned(item->ToObject())) {
+                ThrowCloneError("only Buffers can be transferred");
+                return false;
+            }
+            if (IndexOf(listed, item->ToObject()) >= 0) {
+                ThrowCloneError("a transferred Buffer can only be sent once");
+                return false;
+            }
+            listed.push_back(item->ToObject());
+        }
+    }
+    // No inner handle scopes: the handles in |seen| must outlive the
+    // values they were written for.
+    std::vector<v8::Handle<v8::Object> > stack;
+    std::vector<v8::Handle<v8::Object> > seen;
+    std::vector<uint32_t> transferred;
+    if (!WriteValue(value, transfer_list, &stack, &seen, &transferred)) {
+        for (size_t i = 0; i < chunks_.size(); i++) {
+            if (chunks_[i].owned) {
+                free(chunks_[i].data);
+            }
+        }
+        data_.clear();
+        chunks_.clear();
+        return false;
+    }
+    // Copies are owned already; the rest are the transfers, in order.
+    size_t next = 0;
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        if (!chunks_[i].owned) {
+            chunks_[i].data = Buffer::Detach(transfer_list->Get(transferred[next++])->ToObject());
+            chunks_[i].owned = true;
+        }
+    }
+    return true;
+}
+
+// Objects, arrays and external arrays are numbered in the order they are
+// first written; reaching one again writes its number instead.
+bool zb::SerializedValue::WriteValue(v8::Handle<v8::Value> value, v8::Handle<v8::Array> transfer,
+                                     std::vector<v8::Handle<v8::Object> > *stack,
+                                     std::vector<v8::Handle<v8::Object> > *seen,
+                                     std::vector<uint32_t> *transferred)
+{
+    if (value->IsUndefined()) {
+        WriteTag(kUndefined);
+    } else if (value->IsNull()) {
+        WriteTag(kNull);
+    } else if (value->IsTrue()) {
+        WriteTag(kTrue);
+    } else if (value->IsFalse()) {
+        WriteTag(kFalse);
+    } else if (value->IsInt32()) {
+        WriteTag(kInt32);
+        WriteInt(value->Int32Value());
+    } else if (value->IsNumber()) {
+        WriteTag(kDouble);
+        WriteDouble(value->NumberValue());
+    } else if (value->IsString()) {
+        WriteTag(kString);
+        WriteString(v8::Handle<v8::String>::Cast(value));
+    } else if (value->IsDate()) {
+        WriteTag(kDate);
+        WriteDouble(value->NumberValue());
+    } else if (value->IsFunction()) {
+        ThrowCloneError("functions cannot be sent to a worker");
+        return false;
+    } else if (value->IsObject()) {
+        v8::Handle<v8::Object> object = v8::Handle<v8::Object>::Cast(value);
+        int index = IndexOf(*seen, object);
+        if (index >= 0) {
+            if (IndexOf(*stack, object) >= 0) {
+                ThrowCloneError("cyclic values cannot be sent to a worker");
+                return false;
+            }
+            WriteTag(kBackReference);
+            WriteInt(index);
+            return true;
+        }
+        seen->push_back(object);
+        if (object->HasIndexedPropertiesInExternalArrayData()) {
+            Chunk chunk;
+            chunk.type = object->GetIndexedPropertiesExternalArrayDataType();
+            chunk.length = object->GetIndexedPropertiesExternalArrayDataLength();
+            chunk.data = NULL;
+            chunk.owned = false;
+            uint32_t listed = 0;
+            uint32_t count = transfer.IsEmpty() ? 0 : transfer->Length();
+            while (listed < count && !transfer->Get(listed)->StrictEquals(object)) {
+                listed++;
+            }
+            if (listed < count) {
+                transferred->push_back(listed);
+            } else {
+                size_t bytes = chunk.length * Buffer::ElementSize(chunk.type);
+                chunk.data = malloc(bytes > 0 ? bytes : 1);
+                memcpy(chunk.data, object->GetIndexedPropertiesExternalArrayData(), bytes);
+                chunk.owned = true;
+            }
+            WriteTag(kExternalArray);
+            WriteInt(static_cast<int32_t>(chunks_.size()));
+            chunks_.push_back(chunk);
+            return true;
+        }
+        stack->push_back(object);
+        if (object->IsArray()) {
+            v8::Handle<v8::Array> array = v8::Handle<v8::Array>::Cast(object);
+            WriteTag(kArray);
+            WriteInt(array->Length());
+            for (uint32_t i = 0; i < array->Length(); i++) {
+                v8::Local<v8::Value> element = array->Get(i);
+                if (element.IsEmpty() || !WriteValue(element, transfer, stack, seen, transferred)) {
+                    return false;
+                }
+            }
+        } else {
+            v8::Local<v8::Array> names = object->GetOwnPropertyNames();
+            if (names.IsEmpty()) {
+                return false;
+            }
+            WriteTag(kObject);
+            WriteInt(names->Length());
+            for (uint32_t i = 0; i < names->Length(); i++) {
+                v8::Local<v8::Value> name = names->Get(i);
+                v8::Local<v8::Value> property = object->Get(name);
+                if (property.IsEmpty() || !WriteValue(name->ToString(), transfer, stack, seen, transferred) ||
+                    !WriteValue(property, transfer, stack, seen, transferred)) {
+                    return false;
+                }
+            }
+        }
+        stack->pop_back();
+    } else {
+        ThrowCloneError("value cannot be sent to a worker");
+        return false;
+    }
+    return true;
+}
+
+void zb::SerializedValue::WriteInt(int32_t value)
+{
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void zb::SerializedValue::WriteDouble(double value)
+{
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void zb::SerializedValue::WriteString(v8::Handle<v8::String> string)
+{
+    int length = string->Utf8Length();
+    WriteInt(length);
+    size_t offset = data_.size();
+    data_.resize(offset + length);
+    if (length > 0) {
+        string->WriteUtf8(&data_[offset], length, NULL, v8::String::NO_NULL_TERMINATION);
+    }
+}
+
+v8::Handle<v8::Value> zb::SerializedValue::Read()
+{
+    v8::HandleScope handle_scope;
+    size_t offset = 0;
+    std::vector<v8::Handle<v8::Object> > objects;
+    return handle_scope.Close(ReadValue(&offset, &objects));
+}
+
+// Objects are numbered as they are created, before their contents are
+// read, the same order Write numbered them in.
+v8::Handle<v8::Value> zb::SerializedValue::ReadValue(size_t *offset, std::vector<v8::Handle<v8::Object> > *objects)
+{
+    switch (data_[(*offset)++]) {
+        case kUndefined:
+            return v8::Undefined();
+        case kNull:
+            return v8::Null();
+        case kTrue:
+            return v8::True();
+        case kFalse:
+            return v8::False();
+        case kInt32:
+            return v8::Integer::New(ReadInt(offset));
+        case kDouble:
+            return v8::Number::New(ReadDouble(offset));
+        case kString: {
+            int length = ReadInt(offset);
+            v8::Local<v8::String> string = v8::String::New(data_.data() + *offset, length);
+            *offset += length;
+            return string;
+        }
+        case kDate:
+            return v8::Date::New(ReadDouble(offset));
+        case kArray: {
+            int length = ReadInt(offset);
+            v8::Local<v8::Array> array = v8::Array::New(length);
+            objects->push_back(array);
+            for (int i = 0; i < length; i++) {
+                array->Set(i, ReadValue(offset, objects));
+            }
+            return array;
+        }
+        case kObject: {
+            int count = ReadInt(offset);
+            v8::Local<v8::Object> object = v8::Object::New();
+            objects->push_back(object);
+            for (int i = 0; i < count; i++) {
+                v8::Handle<v8::Value> name = ReadValue(offset, objects);
+                object->Set(name, ReadValue(offset, objects));
+            }
+            return object;
+        }
+        case kExternalArray: {
+            Chunk &chunk = chunks_[ReadInt(offset)];
+            v8::Handle<v8::Object> buffer = Buffer::Adopt(chunk.data, chunk.type, chunk.length);
+            chunk.owned = false;
+            objects->push_back(buffer);
+            return buffer;
+        }
+        case kBackReference:
+            return (*objects)[ReadInt(offset)];
+    }
+    return v8::Undefined();
+}
+
+int32_t zb::SerializedValue::ReadInt(size_t *offset)
+{
+    int32_t value;
+    memcpy(&value, data_.data() + *offset, sizeof(value));
+    *offset += sizeof(value);
+    return value;
+}
+
+double zb::SerializedValue::ReadDouble(size_t *offset)
+{
+    double value;
+    memcpy(&value, data_.data() + *offset, sizeof(value));
+    *offset += sizeof(value);
+    return value;
+}
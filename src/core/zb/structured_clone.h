@@ -0,0 +1,98 @@
+//
+//  structured_clone.h
+//  zb
+//
+//  Created by  on 12/03/14.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_STRUCTURED_CLONE_H_
+#define ZB_STRUCTURED_CLONE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+
+namespace zb {
+    // Typed memory outside the V8 heap, created from script as
+    //
+    //   var samples = new Buffer(4096, 'float64');
+    //
+    // and indexed like an array. Types are int8, uint8, int16, uint16,
+    // int32, uint32, float32 and float64 (the default). The memory is
+    // freed when the object is collected, unless it was transferred to
+    // another isolate first.
+    class Buffer {
+    public:
+        static v8::Handle<v8::Value> New(const v8::Arguments &args);
+
+        // Takes over |data|, which must come from malloc.
+        static v8::Handle<v8::Object> Adopt(void *data, v8::ExternalArrayType type, int length);
+
+        // True for objects made by New or Adopt, the only ones whose memory
+        // can change owners.
+        static bool IsOwned(v8::Handle<v8::Object> object);
+
+        // Hands the memory to the caller and leaves the object empty.
+        static void *Detach(v8::Handle<v8::Object> object);
+
+        static size_t ElementSize(v8::ExternalArrayType type);
+    private:
+        struct Store;
+
+        static void Attach(v8::Handle<v8::Object> object, void *data, v8::ExternalArrayType type, int length);
+        static void Dispose(v8::Persistent<v8::Value> handle, void *parameter);
+    };
+
+    // A script value copied out of one isolate so it can be rebuilt in
+    // another. Handles undefined, null, booleans, numbers, strings, dates,
+    // arrays, plain objects and external arrays; functions, cycles and other
+    // host objects are refused. An object, array or external array reached
+    // along several paths is written once and read back as one object;
+    // dates are copied per path.
+    //
+    // External arrays are copied, unless they are Buffers listed in the
+    // transfer array: those are moved, leaving the sender's object empty.
+    class SerializedValue {
+    public:
+        SerializedValue();
+        ~SerializedValue();
+
+        // Throws in the current isolate and returns false when the value
+        // cannot be sent. Nothing is transferred then.
+        bool Write(v8::Handle<v8::Value> value, v8::Handle<v8::Value> transfer);
+
+        // Rebuilds the value in the current context. May be called once.
+        v8::Handle<v8::Value> Read();
+
+        size_t size() const { return data_.size(); }
+    private:
+        struct Chunk {
+            void *data;
+            v8::ExternalArrayType type;
+            int length;
+            bool owned;
+        };
+
+        bool WriteValue(v8::Handle<v8::Value> value, v8::Handle<v8::Array> transfer,
+                        std::vector<v8::Handle<v8::Object> > *stack,
+                        std::vector<v8::Handle<v8::Object> > *seen,
+                        std::vector<uint32_t> *transferred);
+        void WriteTag(char tag) { data_.push_back(tag); }
+        void WriteInt(int32_t value);
+        void WriteDouble(double value);
+        void WriteString(v8::Handle<v8::String> string);
+
+        v8::Handle<v8::Value> ReadValue(size_t *offset, std::vector<v8::Handle<v8::Object> > *objects);
+        int32_t ReadInt(size_t *offset);
+        double ReadDouble(size_t *offset);
+
+        std::string data_;
+        std::vector<Chunk> chunks_;
+    };
+}
+
+#endif  // ZB_STRUCTURED_CLONE_H_
@@ -0,0 +1,53 @@
+//
+//  template_cache.cc
+//  zb
+//
+//  Created by  on 12/03/15.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "template_cache.h"
+
+namespace {
+    const char *const kSymbolNames[] = {
+#define SYMBOL_NAME(name, string) string,
+        ZB_CACHED_SYMBOLS(SYMBOL_NAME)
+#undef SYMBOL_NAME
+    };
+}
+
+zb::TemplateCache::TemplateCache()
+{
+}
+
+zb::TemplateCache::~TemplateCache()
+{
+}
+
+void zb::TemplateCache::Initialize()
+{
+    v8::HandleScope handle_scope;
+    for (int i = 0; i < kSymbolCount; i++) {
+        symbols_[i] = v8::Persistent<v8::String>::New(v8::String::NewSymbol(kSymbolNames[i]));
+    }
+}
+
+void zb::TemplateCache::Dispose()
+{
+    for (int i = 0; i < kSymbolCount; i++) {
+        symbols_[i].Dispose();
+        symbols_[i].Clear();
+    }
+    for (ClassMap::iterator it = classes_.begin(); it != classes_.end(); ++it) {
+        it->second.Dispose();
+    }
+    classes_.clear();
+    global_.Dispose();
+    global_.Clear();
+}
+
+void zb::TemplateCache::set_global(v8::Handle<v8::ObjectTemplate> global)
+{
+    global_.Dispose();
+    global_ = v8::Persistent<v8::ObjectTemplate>::New(global);
+}
@@ -0,0 +1,89 @@
+//
+//  template_cache.h
+//  zb
+//
+//  Created by  on 12/03/15.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_TEMPLATE_CACHE_H_
+#define ZB_TEMPLATE_CACHE_H_
+
+#include <map>
+
+#include "v8.h"
+#include "binding.h"
+
+// Property names the bridge reads or writes on every event or call:
+// V(enum name, string). The touch types follow Event::Type's order.
+#define ZB_CACHED_SYMBOLS(V)              \
+    V(kOnEvent, "onEvent")                \
+    V(kOnEvents, "onEvents")              \
+    V(kOnMessage, "onmessage")            \
+    V(kPreloaded, "__zbPreloaded__")      \
+    V(kType, "type")                      \
+    V(kPointer, "pointer")                \
+    V(kTimestamp, "timestamp")            \
+    V(kTouchBegan, "touchbegan")          \
+    V(kTouchMoved, "touchmoved")          \
+    V(kTouchEnded, "touchended")          \
+    V(kTouchCancelled, "touchcancelled")  \
+    V(kX, "x")                            \
+    V(kY, "y")                            \
+    V(kWidth, "width")                    \
+    V(kHeight, "height")                  \
+    V(kAlpha, "alpha")                    \
+    V(kDuration, "duration")              \
+    V(kDelay, "delay")                    \
+    V(kCurve, "curve")                    \
+    V(kLength, "length")
+
+namespace zb {
+    // Everything an isolate's contexts share: the global template, each
+    // bridged class's FunctionTemplate and the symbols above. Built once
+    // per isolate, so a further context only pays for V8's own setup. Use
+    // from inside the owning isolate.
+    class TemplateCache {
+    public:
+        enum Symbol {
+#define DECLARE_SYMBOL(name, string) name,
+            ZB_CACHED_SYMBOLS(DECLARE_SYMBOL)
+#undef DECLARE_SYMBOL
+            kSymbolCount
+        };
+
+        TemplateCache();
+        ~TemplateCache();
+        void Initialize();
+        void Dispose();
+
+        v8::Handle<v8::String> symbol(Symbol id) const { return symbols_[id]; }
+        v8::Handle<v8::ObjectTemplate> global() const { return global_; }
+        void set_global(v8::Handle<v8::ObjectTemplate> global);
+
+        // Empty until AddClass is called for C.
+        template <class C>
+        v8::Handle<v8::FunctionTemplate> Class() const
+        {
+            ClassMap::const_iterator it = classes_.find(&ClassTag<C>::id);
+            if (it == classes_.end()) {
+                return v8::Handle<v8::FunctionTemplate>();
+            }
+            return it->second;
+        }
+
+        template <class C>
+        void AddClass(v8::Handle<v8::FunctionTemplate> klass)
+        {
+            classes_[&ClassTag<C>::id] = v8::Persistent<v8::FunctionTemplate>::New(klass);
+        }
+    private:
+        typedef std::map<const char *, v8::Persistent<v8::FunctionTemplate> > ClassMap;
+
+        v8::Persistent<v8::String> symbols_[kSymbolCount];
+        v8::Persistent<v8::ObjectTemplate> global_;
+        ClassMap classes_;
+    };
+}
+
+#endif  // ZB_TEMPLATE_CACHE_H_
@@ -0,0 +1,154 @@
+//
+//  timer_wheel.cc
+//  zb
+//
+//  Created by  on 12/03/16.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "timer_wheel.h"
+
+zb::TimerWheel::TimerWheel(uint64_t now)
+    : now_(now), size_(0)
+{
+    for (int level = 0; level < kLevels; level++) {
+        counts_[level] = 0;
+        for (int index = 0; index < kSlots; index++) {
+            Timer *head = &slots_[level][index].head;
+            head->prev = head;
+            head->next = head;
+        }
+    }
+}
+
+void zb::TimerWheel::Add(Timer *timer, uint64_t expiry)
+{
+    if (timer->scheduled()) {
+        Remove(timer);
+    }
+    timer->expiry = expiry > now_ ? expiry : now_ + 1;
+    Insert(timer);
+    size_++;
+}
+
+void zb::TimerWheel::Remove(Timer *timer)
+{
+    if (!timer->scheduled()) {
+        return;
+    }
+    counts_[timer->level]--;
+    Unlink(timer);
+    size_--;
+}
+
+// Level k holds expiries 64^k to 64^(k+1) ticks ahead, indexed by the
+// expiry's k-th group of six bits. Cascading can file a timer due this very
+// tick; its slot is processed right after.
+void zb::TimerWheel::Insert(Timer *timer)
+{
+    uint64_t expiry = timer->expiry;
+    uint64_t delta = expiry - now_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (static_cast<uint64_t>(1) << (kSlotBits * (level + 1)))) {
+        level++;
+    }
+    uint64_t index;
+    if (delta >> (kSlotBits * kLevels)) {
+        index = (now_ >> (kSlotBits * level)) - 1;
+    } else {
+        index = expiry >> (kSlotBits * level);
+    }
+    Timer *head = &slots_[level][index & (kSlots - 1)].head;
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+    timer->level = level;
+    counts_[level]++;
+}
+
+void zb::TimerWheel::Unlink(Timer *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+void zb::TimerWheel::Cascade(int level, int index)
+{
+    Timer *head = &slots_[level][index].head;
+    Timer *timer = head->next;
+    head->prev = head;
+    head->next = head;
+    while (timer != head) {
+        Timer *next = timer->next;
+        counts_[level]--;
+        Insert(timer);
+        timer = next;
+    }
+}
+
+void zb::TimerWheel::Advance(uint64_t now, std::vector<Timer *> *expired)
+{
+    while (now_ < now) {
+        if (size_ == 0) {
+            now_ = now;
+            break;
+        }
+        // Below the lowest occupied level nothing happens until that
+        // level's next slot boundary, so go straight there.
+        int lowest = 0;
+        while (counts_[lowest] == 0) {
+            lowest++;
+        }
+        if (lowest > 0) {
+            int shift = kSlotBits * lowest;
+            uint64_t boundary = ((now_ >> shift) + 1) << shift;
+            if (boundary > now) {
+                now_ = now;
+                break;
+            }
+            now_ = boundary - 1;
+        }
+        now_++;
+
+        int index = static_cast<int>(now_ & (kSlots - 1));
+        for (int level = 1; level < kLevels && index == 0; level++) {
+            index = static_cast<int>((now_ >> (kSlotBits * level)) & (kSlots - 1));
+            Cascade(level, index);
+        }
+
+        Timer *head = &slots_[0][now_ & (kSlots - 1)].head;
+        while (head->next != head) {
+            Timer *timer = head->next;
+            Unlink(timer);
+            counts_[0]--;
+            size_--;
+            expired->push_back(timer);
+        }
+    }
+}
+
+// The first occupied slot on the lowest occupied level bounds the answer:
+// everything on a coarser level lies past that level's next boundary.
+uint64_t zb::TimerWheel::NextExpiry() const
+{
+    if (size_ == 0) {
+        return UINT64_MAX;
+    }
+    for (int level = 0; level < kLevels; level++) {
+        if (counts_[level] == 0) {
+            continue;
+        }
+        int shift = kSlotBits * level;
+        uint64_t slot = now_ >> shift;
+        for (int i = 1; i <= kSlots; i++) {
+            const Timer *head = &slots_[level][(slot + i) & (kSlots - 1)].head;
+            if (head->next != head) {
+                return (slot + i) << shift;
+            }
+        }
+    }
+    return now_ + 1;
+}
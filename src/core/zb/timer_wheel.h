@@ -0,0 +1,76 @@
+//
+//  timer_wheel.h
+//  zb
+//
+//  Created by  on 12/03/16.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_TIMER_WHEEL_H_
+#define ZB_TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace zb {
+    // Hierarchical timing wheel: four levels of 64 slots, the first one
+    // tick wide per slot, each next level 64 times coarser. Adding and
+    // removing a timer is O(1); a timer is moved down a level at most three
+    // times before it expires, and advancing over empty stretches skips
+    // whole slots. Delays past the last level's range (64^4 ticks) are
+    // parked in its farthest slot and filed again when it comes round.
+    //
+    // Timers are intrusive: callers derive from Timer and own the objects.
+    class TimerWheel {
+    public:
+        struct Timer {
+            Timer() : expiry(0), level(0), prev(NULL), next(NULL) {}
+            bool scheduled() const { return next != NULL; }
+
+            uint64_t expiry;
+            int level;
+            Timer *prev;
+            Timer *next;
+        };
+
+        enum {
+            kLevels = 4,
+            kSlotBits = 6,
+            kSlots = 1 << kSlotBits
+        };
+
+        explicit TimerWheel(uint64_t now = 0);
+
+        // An expiry at or before now() becomes the next tick.
+        void Add(Timer *timer, uint64_t expiry);
+        void Remove(Timer *timer);
+
+        // Moves the wheel to |now|, appending expired timers to |expired|
+        // in expiry order, slot by slot. They are unscheduled by then.
+        void Advance(uint64_t now, std::vector<Timer *> *expired);
+
+        // No timer expires before this; it can be earlier than the actual
+        // next expiry for timers still on the coarser levels. UINT64_MAX
+        // when empty.
+        uint64_t NextExpiry() const;
+
+        uint64_t now() const { return now_; }
+        size_t size() const { return size_; }
+    private:
+        struct Slot {
+            Timer head;
+        };
+
+        void Insert(Timer *timer);
+        void Cascade(int level, int index);
+        static void Unlink(Timer *timer);
+
+        Slot slots_[kLevels][kSlots];
+        size_t counts_[kLevels];
+        uint64_t now_;
+        size_t size_;
+    };
+}
+
+#endif  // ZB_TIMER_WHEEL_H_
@@ -0,0 +1,153 @@
+//
+//  trace.cc
+//  zb
+//
+//  Created by  on 12/03/12.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+namespace {
+    std::mutex mutex;
+    // std::map nodes never move, so V8 can keep the int pointers it got.
+    std::map<std::string, int> counters;
+    std::map<std::string, zb::Histogram *> histograms;
+}
+
+bool zb::Tracer::enabled_ = false;
+
+zb::Histogram::Histogram(const char *name, const char *unit, int id)
+    : name_(name), unit_(unit), id_(id), count_(0), sum_(0), max_(0)
+{
+    for (int i = 0; i < kBuckets; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void zb::Histogram::Add(int64_t sample)
+{
+    if (sample < 0) {
+        sample = 0;
+    }
+    int bucket = 0;
+    while (bucket < kBuckets - 1 && (sample >> bucket) != 0) {
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(sample, std::memory_order_relaxed);
+    int64_t max = max_.load(std::memory_order_relaxed);
+    while (sample > max && !max_.compare_exchange_weak(max, sample, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t zb::Histogram::Percentile(double fraction) const
+{
+    int64_t total = count();
+    int64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (total > 0 && seen >= fraction * total) {
+            int64_t bound = i == 0 ? 0 : (static_cast<int64_t>(1) << i) - 1;
+            return bound < max() ? bound : max();
+        }
+    }
+    return max();
+}
+
+// Call before creating the runtimes to trace; it does not reach back into
+// templates that already exist.
+void zb::Tracer::Enable()
+{
+    enabled_ = true;
+}
+
+// Called by each runtime with its isolate entered, before any context
+// exists, since V8 looks its counters up only once.
+void zb::Tracer::Install()
+{
+    v8::V8::SetCounterFunction(Tracer::LookupCounter);
+    v8::V8::SetCreateHistogramFunction(Tracer::CreateHistogram);
+    v8::V8::SetAddHistogramSampleFunction(Tracer::AddHistogramSample);
+}
+
+zb::Histogram *zb::Tracer::Binding(const char *name)
+{
+    return FindOrCreate(name, "ns");
+}
+
+// Picks the wrapper slot of one callback for |name|: the slot already
+// holding its histogram, or the first free one. -1 when all are taken by
+// other names.
+int zb::Tracer::Slot(Histogram **histograms, const char *name)
+{
+    Histogram *histogram = Binding(name);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = 0; i < kSlots; i++) {
+        if (histograms[i] == NULL) {
+            histograms[i] = histogram;
+        }
+        if (histograms[i] == histogram) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+zb::Histogram *zb::Tracer::FindOrCreate(const char *name, const char *unit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Histogram *&histogram = histograms[name];
+    if (histogram == NULL) {
+        histogram = new Histogram(name, unit, static_cast<int>(histograms.size()) - 1);
+    }
+    return histogram;
+}
+
+// Counters are shared by every isolate. V8 bumps them without locking, so
+// with several runtimes running at once they are approximate.
+int *zb::Tracer::LookupCounter(const char *name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return &counters[name];
+}
+
+// V8's HistogramTimers all use this range and sample milliseconds; the
+// few other histograms count V8-specific values.
+void *zb::Tracer::CreateHistogram(const char *name, int min, int max, size_t buckets)
+{
+    return FindOrCreate(name, min == 0 && max == 10000 && buckets == 50 ? "ms" : "");
+}
+
+void zb::Tracer::AddHistogramSample(void *histogram, int sample)
+{
+    static_cast<Histogram *>(histogram)->Add(sample);
+}
+
+void zb::Tracer::WriteCSV(FILE *out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fprintf(out, "type,name,unit,count,sum,mean,p50,p90,p99,max\n");
+    for (std::map<std::string, int>::const_iterator it = counters.begin(); it != counters.end(); ++it) {
+        if (it->second != 0) {
+            fprintf(out, "counter,%s,,%d,,,,,,\n", it->first.c_str(), it->second);
+        }
+    }
+    for (std::map<std::string, Histogram *>::const_iterator it = histograms.begin(); it != histograms.end(); ++it) {
+        const Histogram *histogram = it->second;
+        int64_t count = histogram->count();
+        if (count == 0) {
+            continue;
+        }
+        fprintf(out, "histogram,%s,%s,%lld,%lld,%.1f,%lld,%lld,%lld,%lld\n",
+                histogram->name().c_str(), histogram->unit(), static_cast<long long>(count),
+                static_cast<long long>(histogram->sum()), static_cast<double>(histogram->sum()) / count,
+                static_cast<long long>(histogram->Percentile(0.5)), static_cast<long long>(histogram->Percentile(0.9)),
+                static_cast<long long>(histogram->Percentile(0.99)), static_cast<long long>(histogram->max()));
+    }
+}
@@ -0,0 +1,189 @@
+//
+//  trace.h
+//  zb
+//
+//  Created by  on 12/03/12.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_TRACE_H_
+#define ZB_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "v8.h"
+#include "recorder.h"
+
+namespace zb {
+    // Counts samples in power-of-two buckets: bucket i holds samples below
+    // 2^i units. Safe to add to from several threads.
+    class Histogram {
+    public:
+        enum { kBuckets = 48 };
+        
+        Histogram(const char *name, const char *unit, int id = 0);
+        void Add(int64_t sample);
+        int64_t Percentile(double fraction) const;
+        const std::string &name() const { return name_; }
+        int id() const { return id_; }
+        const char *unit() const { return unit_; }
+        int64_t count() const { return count_.load(std::memory_order_relaxed); }
+        int64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+        int64_t max() const { return max_.load(std::memory_order_relaxed); }
+    private:
+        std::string name_;
+        const char *unit_;
+        int id_;
+        std::atomic<int64_t> buckets_[kBuckets];
+        std::atomic<int64_t> count_;
+        std::atomic<int64_t> sum_;
+        std::atomic<int64_t> max_;
+    };
+    
+    // Opt-in bridge instrumentation. Once Enable has run, runtimes created
+    // afterwards register their callbacks through Trace, which times every
+    // call into a per-binding histogram (in ns), and hand V8 the counter
+    // and histogram functions so its own statistics land in the same
+    // table. With tracing off, Trace returns the callback itself and costs
+    // nothing per call. Under a Recorder the wrappers also record each
+    // call before timing it.
+    //
+    // WriteCSV prints one row per counter and histogram:
+    //
+    //   type,name,unit,count,sum,mean,p50,p90,p99,max
+    //
+    // Percentiles are bucket upper bounds.
+    class Tracer {
+    public:
+        enum { kSlots = 4 };
+        
+        static void Enable();
+        static bool enabled() { return enabled_; }
+        static void Install();
+        static Histogram *Binding(const char *name);
+        static int Slot(Histogram **histograms, const char *name);
+        static void WriteCSV(FILE *out);
+        
+        static int *LookupCounter(const char *name);
+        static void *CreateHistogram(const char *name, int min, int max, size_t buckets);
+        static void AddHistogramSample(void *histogram, int sample);
+    private:
+        static Histogram *FindOrCreate(const char *name, const char *unit);
+        
+        static bool enabled_;
+    };
+    
+    // One callback can be registered under several names (clearTimeout
+    // and clearInterval, Log and Log.info), so each traced callback gets
+    // kSlots wrappers, one per name, each reading its own histogram.
+    // Names past kSlots for the same callback are left untraced.
+    template <v8::InvocationCallback F>
+    struct TracedFunction {
+        static Histogram *histograms[Tracer::kSlots];
+        
+        template <int N>
+        static v8::Handle<v8::Value> Call(const v8::Arguments &args)
+        {
+            Histogram *histogram = histograms[N];
+            if (Recorder::enabled()) {
+                Recorder::RecordBinding(histogram, args);
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            v8::Handle<v8::Value> result = F(args);
+            histogram->Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            return result;
+        }
+    };
+    
+    template <v8::InvocationCallback F>
+    Histogram *TracedFunction<F>::histograms[Tracer::kSlots];
+    
+    template <v8::AccessorGetter G>
+    struct TracedGetter {
+        static Histogram *histograms[Tracer::kSlots];
+        
+        template <int N>
+        static v8::Handle<v8::Value> Get(v8::Local<v8::String> propertyName, const v8::AccessorInfo &info)
+        {
+            Histogram *histogram = histograms[N];
+            if (Recorder::enabled()) {
+                Recorder::RecordBinding(histogram, v8::Handle<v8::Value>());
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            v8::Handle<v8::Value> result = G(propertyName, info);
+            histogram->Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            return result;
+        }
+    };
+    
+    template <v8::AccessorGetter G>
+    Histogram *TracedGetter<G>::histograms[Tracer::kSlots];
+    
+    template <v8::AccessorSetter S>
+    struct TracedSetter {
+        static Histogram *histograms[Tracer::kSlots];
+        
+        template <int N>
+        static void Set(v8::Local<v8::String> propertyName, v8::Local<v8::Value> value, const v8::AccessorInfo &info)
+        {
+            Histogram *histogram = histograms[N];
+            if (Recorder::enabled()) {
+                Recorder::RecordBinding(histogram, value);
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            S(propertyName, value, info);
+            histogram->Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    };
+    
+    template <v8::AccessorSetter S>
+    Histogram *TracedSetter<S>::histograms[Tracer::kSlots];
+    
+    template <v8::InvocationCallback F>
+    v8::InvocationCallback Trace(const char *name)
+    {
+        static const v8::InvocationCallback calls[Tracer::kSlots] = {
+            TracedFunction<F>::template Call<0>, TracedFunction<F>::template Call<1>,
+            TracedFunction<F>::template Call<2>, TracedFunction<F>::template Call<3>
+        };
+        if (!Tracer::enabled()) {
+            return F;
+        }
+        int slot = Tracer::Slot(TracedFunction<F>::histograms, name);
+        return slot < 0 ? F : calls[slot];
+    }
+    
+    template <v8::AccessorGetter G>
+    v8::AccessorGetter TraceGetter(const char *name)
+    {
+        static const v8::AccessorGetter gets[Tracer::kSlots] = {
+            TracedGetter<G>::template Get<0>, TracedGetter<G>::template Get<1>,
+            TracedGetter<G>::template Get<2>, TracedGetter<G>::template Get<3>
+        };
+        if (!Tracer::enabled()) {
+            return G;
+        }
+        int slot = Tracer::Slot(TracedGetter<G>::histograms, name);
+        return slot < 0 ? G : gets[slot];
+    }
+    
+    template <v8::AccessorSetter S>
+    v8::AccessorSetter TraceSetter(const char *name)
+    {
+        static const v8::AccessorSetter sets[Tracer::kSlots] = {
+            TracedSetter<S>::template Set<0>, TracedSetter<S>::template Set<1>,
+            TracedSetter<S>::template Set<2>, TracedSetter<S>::template Set<3>
+        };
+        if (!Tracer::enabled()) {
+            return S;
+        }
+        int slot = Tracer::Slot(TracedSetter<S>::histograms, name);
+        return slot < 0 ? S : sets[slot];
+    }
+}
+
+#endif  // ZB_TRACE_H_
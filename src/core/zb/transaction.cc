@@ -0,0 +1,24 @@
+//
+//  transaction.cc
+//  zb
+//
+//  Created by  on 12/02/26.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "transaction.h"
+
+zb::Transaction::Transaction(Backend *backend, GeometryBuffer *geometry)
+    : backend_(backend), geometry_(geometry)
+{
+}
+
+void zb::Transaction::Commit()
+{
+    if (!geometry_->HasPending()) {
+        return;
+    }
+    backend_->BeginCommit();
+    geometry_->Commit(backend_);
+    backend_->EndCommit();
+}
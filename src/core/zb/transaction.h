@@ -0,0 +1,28 @@
+//
+//  transaction.h
+//  zb
+//
+//  Created by  on 12/02/26.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_TRANSACTION_H_
+#define ZB_TRANSACTION_H_
+
+#include "backend.h"
+#include "geometry.h"
+
+namespace zb {
+    // Setters only touch the model in the geometry buffer; Commit pushes
+    // each changed view to the backend once, inside one backend commit.
+    class Transaction {
+    public:
+        Transaction(Backend *backend, GeometryBuffer *geometry);
+        void Commit();
+    private:
+        Backend *backend_;
+        GeometryBuffer *geometry_;
+    };
+}
+
+#endif  // ZB_TRANSACTION_H_
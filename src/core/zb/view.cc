@@ -0,0 +1,209 @@
+//
+//  view.cc
+//  zb
+//
+//  Created by  on 12/02/04.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "view.h"
+#include "binding.h"
+#include "runtime.h"
+
+using namespace v8;
+
+zb::View::View(Runtime *runtime)
+    : runtime_(runtime), native_(runtime->backend()->CreateView())
+{
+    slot_ = geometry()->Allocate(native_, backend()->GetFrame(native_), backend()->GetAlpha(native_));
+}
+
+zb::View::~View()
+{
+    geometry()->Release(slot_);
+    backend()->DestroyView(native_);
+}
+
+zb::Backend *zb::View::backend() const
+{
+    return runtime_->backend();
+}
+
+zb::GeometryBuffer *zb::View::geometry() const
+{
+    return runtime_->geometry();
+}
+
+// Called when the wrapper goes back to the runtime's pool: the native view
+// is detached and reset, and the model follows without a commit.
+void zb::View::Recycle()
+{
+    backend()->RecycleView(native_);
+    geometry()->Reset(slot_, backend()->GetFrame(native_), backend()->GetAlpha(native_));
+}
+
+void zb::View::AddSubview(View *child)
+{
+    backend()->AddSubview(native_, child->native());
+}
+
+void zb::View::RemoveFromSuperview()
+{
+    backend()->RemoveFromSuperview(native_);
+}
+
+v8::Handle<v8::Value> zb::View::New(const v8::Arguments &args)
+{
+    Runtime *runtime = static_cast<Runtime *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    v8::Local<v8::Object> thisObject = args.This();
+    v8::Local<v8::Object> pooled = runtime->view_pool()->Take(thisObject);
+    if (!pooled.IsEmpty()) {
+        return pooled;
+    }
+    View *view = new View(runtime);
+    
+    Wrap(thisObject, view);
+    v8::Persistent<v8::Object> holder = v8::Persistent<v8::Object>::New(thisObject);
+    holder.MakeWeak(view, zb::View::Dispose);
+    
+    return thisObject;
+}
+
+// view.animate({ x: 100, alpha: 0 }[, { duration: 0.3, delay: 0,
+// curve: 'ease-in-out' } or duration][, function (finished) { ... }])
+//
+// Times are in seconds. The model jumps to the targets right away, so
+// scripts read the end state while the UI side interpolates towards it.
+// Writes made before the call are committed first so the animation starts
+// from them.
+v8::Handle<v8::Value> zb::View::Animate(const v8::Arguments &args)
+{
+    static const char *const kCurveNames[] = { "linear", "ease-in", "ease-out", "ease-in-out" };
+    
+    View *view = Unwrap<View>(args.Holder());
+    if (args.Length() < 1 || !args[0]->IsObject()) {
+        return ThrowArgumentError(0);
+    }
+    TemplateCache *templates = view->runtime_->templates();
+    v8::Local<v8::Object> targets = args[0]->ToObject();
+    float values[GeometryBuffer::kStride] = { 0 };
+    int fields = 0;
+    
+    // Animation field bits follow the geometry buffer's field order.
+#define READ_GEOMETRY_TARGET(name, field)                                                   \
+    {                                                                                       \
+        v8::Local<v8::Value> value = targets->Get(templates->symbol(TemplateCache::field)); \
+        if (value.IsEmpty()) {                                                              \
+            return value;                                                                   \
+        }                                                                                   \
+        if (!value->IsUndefined()) {                                                        \
+            if (!Converter<float>::FromV8(value, &values[GeometryBuffer::field])) {         \
+                return ThrowArgumentError(0);                                               \
+            }                                                                               \
+            fields |= 1 << GeometryBuffer::field;                                           \
+        }                                                                                   \
+    }
+    ZB_VIEW_GEOMETRY_PROPERTIES(READ_GEOMETRY_TARGET)
+#undef READ_GEOMETRY_TARGET
+    
+    Animation animation;
+    animation.id = 0;
+    animation.fields = fields;
+    animation.frame.x = values[GeometryBuffer::kX];
+    animation.frame.y = values[GeometryBuffer::kY];
+    animation.frame.width = values[GeometryBuffer::kWidth];
+    animation.frame.height = values[GeometryBuffer::kHeight];
+    animation.alpha = values[GeometryBuffer::kAlpha];
+    animation.duration = 0.25;
+    animation.delay = 0;
+    animation.curve = Animation::kEaseInOut;
+    
+    if (args.Length() > 1 && args[1]->IsNumber()) {
+        animation.duration = args[1]->NumberValue();
+    } else if (args.Length() > 1 && args[1]->IsObject()) {
+        v8::Local<v8::Object> options = args[1]->ToObject();
+        v8::Local<v8::Value> duration = options->Get(templates->symbol(TemplateCache::kDuration));
+        v8::Local<v8::Value> delay = options->Get(templates->symbol(TemplateCache::kDelay));
+        v8::Local<v8::Value> curve = options->Get(templates->symbol(TemplateCache::kCurve));
+        if (duration.IsEmpty() || delay.IsEmpty() || curve.IsEmpty()) {
+            return v8::Local<v8::Value>();
+        }
+        if ((!duration->IsUndefined() && !Converter<double>::FromV8(duration, &animation.duration)) ||
+            (!delay->IsUndefined() && !Converter<double>::FromV8(delay, &animation.delay))) {
+            return ThrowArgumentError(1);
+        }
+        if (!curve->IsUndefined()) {
+            std::string name;
+            Converter<std::string>::FromV8(curve, &name);
+            int index = 0;
+            while (index < 4 && name != kCurveNames[index]) {
+                index++;
+            }
+            if (index == 4) {
+                return ThrowArgumentError(1);
+            }
+            animation.curve = static_cast<Animation::Curve>(index);
+        }
+    } else if (args.Length() > 1 && !args[1]->IsUndefined() && !args[1]->IsFunction()) {
+        return ThrowArgumentError(1);
+    }
+    
+    v8::Local<v8::Value> callback = args.Length() > 2 ? args[2] : (args.Length() > 1 ? args[1] : v8::Local<v8::Value>());
+    if (!callback.IsEmpty() && callback->IsFunction()) {
+        animation.id = view->runtime_->AddAnimationCallback(v8::Local<v8::Function>::Cast(callback));
+    }
+    
+    view->runtime_->Commit();
+    for (int field = 0; field < GeometryBuffer::kStride; field++) {
+        if (fields & (1 << field)) {
+            view->geometry()->Settle(view->slot_, field, values[field]);
+        }
+    }
+    view->backend()->Animate(view->native_, animation);
+    return v8::Undefined();
+}
+
+// Weak callback, run inside the GC: decides between pooling and release
+// and leaves the native work to Finalize.
+void zb::View::Dispose(v8::Persistent<v8::Value> handle, void* parameter)
+{
+    View *view = static_cast<View *>(parameter);
+    Runtime *runtime = view->runtime_;
+    if (runtime->view_pool()->Reserve()) {
+        handle.ClearWeak();
+    } else {
+        handle.Dispose();
+        handle.Clear();
+    }
+    runtime->finalizer()->Defer(handle, view, View::Finalize);
+}
+
+void zb::View::Finalize(v8::Persistent<v8::Value> handle, void *native)
+{
+    View *view = static_cast<View *>(native);
+    if (handle.IsEmpty()) {
+        delete view;
+        return;
+    }
+    view->runtime_->view_pool()->Give(handle, view);
+}
+
+void zb::View::InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime)
+{
+    TemplateCache *templates = runtime->templates();
+    if (templates->Class<View>().IsEmpty()) {
+        ClassBinding<View> binding("View", Trace<View::New>("View"), v8::External::New(runtime));
+        
+#define BIND_GEOMETRY_PROPERTY(name, field) \
+        binding.Property<float, &View::get<GeometryBuffer::field>, &View::set<GeometryBuffer::field> >(#name);
+        ZB_VIEW_GEOMETRY_PROPERTIES(BIND_GEOMETRY_PROPERTY)
+#undef BIND_GEOMETRY_PROPERTY
+        
+        binding.ReadOnlyProperty<int, &View::slot>("slot");
+        binding.Method<void, View *, &View::AddSubview>("addSubview");
+        binding.Method<void, &View::RemoveFromSuperview>("removeFromSuperview");
+        binding.Method<View::Animate>("animate");
+        templates->AddClass<View>(binding.klass());
+    }
+    global->Set(v8::String::NewSymbol("View"), templates->Class<View>());
+}
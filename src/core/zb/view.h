@@ -0,0 +1,67 @@
+//
+//  view.h
+//  zb
+//
+//  Created by  on 12/02/04.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_VIEW_H_
+#define ZB_VIEW_H_
+
+#include "v8.h"
+#include "v8stdint.h"
+#include "backend.h"
+#include "geometry.h"
+
+// Script-visible View properties backed by geometry buffer fields:
+// V(property name, GeometryBuffer field).
+#define ZB_VIEW_GEOMETRY_PROPERTIES(V) \
+    V(x, kX)                           \
+    V(y, kY)                           \
+    V(width, kWidth)                   \
+    V(height, kHeight)                 \
+    V(alpha, kAlpha)
+
+namespace zb {
+    class Runtime;
+    
+    // JS-visible view. Its model lives in the runtime's geometry buffer;
+    // setters write the buffer and the next commit pushes it to the backend.
+    class View {
+    public:
+        explicit View(Runtime *runtime);
+        ~View();
+        Backend *backend() const;
+        NativeView native() const { return native_; }
+        int slot() const { return slot_; }
+        
+        template <int Field>
+        float get() const { return geometry()->At(slot_)[Field]; }
+        
+        template <int Field>
+        void set(float value)
+        {
+            geometry()->At(slot_)[Field] = value;
+            geometry()->MarkDirty(slot_);
+        }
+        
+        void Recycle();
+        void AddSubview(View *child);
+        void RemoveFromSuperview();
+        
+        static v8::Handle<v8::Value> New(const v8::Arguments &args);
+        static v8::Handle<v8::Value> Animate(const v8::Arguments &args);
+        static void Dispose(v8::Persistent<v8::Value> handle, void* parameter);
+        static void Finalize(v8::Persistent<v8::Value> handle, void *native);
+        static void InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime);
+    private:
+        GeometryBuffer *geometry() const;
+        
+        Runtime *runtime_;
+        NativeView native_;
+        int slot_;
+    };
+}
+
+#endif  // ZB_VIEW_H_
@@ -0,0 +1,474 @@
+//
+//  worker.cc
+//  zb
+//
+//  Created by  on 12/03/14.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include <stdio.h>
+#include <condition_variable>
+#include <map>
+#include <thread>
+
+#include "worker.h"
+#include "binding.h"
+#include "invoke.h"
+#include "log_channel.h"
+#include "runtime.h"
+#include "template_cache.h"
+
+namespace {
+    void ReportWorkerException(int worker, v8::TryCatch *try_catch)
+    {
+        v8::String::Utf8Value exception(try_catch->Exception());
+        char message[zb::LogChannel::kMaxMessage];
+        int length = snprintf(message, sizeof(message), "Worker %d: %s", worker, *exception ? *exception : "<string conversion failed>");
+        zb::LogChannel::Shared()->Write(zb::LogChannel::kError, message, length < static_cast<int>(sizeof(message)) ? length : sizeof(message) - 1);
+    }
+}
+
+zb::WorkerInbox::WorkerInbox()
+    : closed_(false), wake_(NULL), wake_data_(NULL), pending_(0)
+{
+}
+
+zb::WorkerInbox::~WorkerInbox()
+{
+    Close();
+}
+
+void zb::WorkerInbox::SetWake(Wake wake, void *data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_ = wake;
+    wake_data_ = data;
+}
+
+// The wake runs under the lock, so once Close returns it is not called
+// again.
+void zb::WorkerInbox::Post(int worker, SerializedValue *value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        delete value;
+        return;
+    }
+    Message message = { worker, value };
+    messages_.push_back(message);
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+    if (wake_ != NULL) {
+        wake_(wake_data_);
+    }
+}
+
+void zb::WorkerInbox::Take(std::deque<Message> *out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.fetch_sub(static_cast<int>(messages_.size()), std::memory_order_acq_rel);
+    out->swap(messages_);
+}
+
+void zb::WorkerInbox::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    wake_ = NULL;
+    pending_.fetch_sub(static_cast<int>(messages_.size()), std::memory_order_acq_rel);
+    for (size_t i = 0; i < messages_.size(); i++) {
+        delete messages_[i].value;
+    }
+    messages_.clear();
+}
+
+// One isolate and the contexts of the workers assigned to it. Everything
+// but the job queue is only touched on the thread itself.
+class zb::WorkerPool::Thread {
+public:
+    Thread();
+    ~Thread();
+    void Start(int worker, const std::string &source, const std::shared_ptr<WorkerInbox> &inbox);
+    void Post(int worker, SerializedValue *value);
+    void Terminate(int worker);
+    void LowMemory();
+private:
+    struct Job {
+        enum Type {
+            kStart,
+            kMessage,
+            kTerminate,
+            kLowMemory
+        };
+
+        Type type;
+        int worker;
+        std::string source;
+        SerializedValue *value;
+        std::shared_ptr<WorkerInbox> inbox;
+    };
+
+    struct Context {
+        int worker;
+        std::shared_ptr<WorkerInbox> inbox;
+        v8::Persistent<v8::Context> context;
+    };
+
+    void Main();
+    void Run(const Job &job);
+    void RunStart(const Job &job);
+    void RunMessage(const Job &job);
+
+    static v8::Handle<v8::Value> PostMessage(const v8::Arguments &args);
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Job> jobs_;
+    std::map<int, std::shared_ptr<WorkerInbox> > inboxes_;
+    bool stopping_;
+    std::map<int, Context *> contexts_;
+    Context *current_;
+    TemplateCache templates_;
+    LogRateLimiter log_limiter_;
+};
+
+zb::WorkerPool::Thread::Thread()
+    : stopping_(false), current_(NULL)
+{
+}
+
+zb::WorkerPool::Thread::~Thread()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void zb::WorkerPool::Thread::Start(int worker, const std::string &source, const std::shared_ptr<WorkerInbox> &inbox)
+{
+    Job job = { Job::kStart, worker, source, NULL, inbox };
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The isolate is only made once the thread gets its first worker.
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&Thread::Main, this);
+    }
+    inboxes_[worker] = inbox;
+    inbox->BeginJob();
+    jobs_.push_back(job);
+    wake_.notify_one();
+}
+
+void zb::WorkerPool::Thread::Post(int worker, SerializedValue *value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, std::shared_ptr<WorkerInbox> >::iterator it = inboxes_.find(worker);
+    if (it == inboxes_.end()) {
+        delete value;
+        return;
+    }
+    Job job = { Job::kMessage, worker, std::string(), value, it->second };
+    it->second->BeginJob();
+    jobs_.push_back(job);
+    wake_.notify_one();
+}
+
+// Messages the worker has not started on are dropped. One it is running
+// finishes first.
+void zb::WorkerPool::Thread::Terminate(int worker)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inboxes_.erase(worker) == 0) {
+        return;
+    }
+    for (std::deque<Job>::iterator it = jobs_.begin(); it != jobs_.end();) {
+        if (it->worker == worker) {
+            delete it->value;
+            it->inbox->EndJob();
+            it = jobs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    Job job = { Job::kTerminate, worker, std::string(), NULL, std::shared_ptr<WorkerInbox>() };
+    jobs_.push_back(job);
+    wake_.notify_one();
+}
+
+// Threads that never got a worker have no isolate to notify.
+void zb::WorkerPool::Thread::LowMemory()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        return;
+    }
+    Job job = { Job::kLowMemory, 0, std::string(), NULL, std::shared_ptr<WorkerInbox>() };
+    jobs_.push_back(job);
+    wake_.notify_one();
+}
+
+void zb::WorkerPool::Thread::Main()
+{
+    v8::Isolate *isolate = v8::Isolate::New();
+    {
+        v8::Locker locker(isolate);
+        v8::Isolate::Scope isolate_scope(isolate);
+        templates_.Initialize();
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            while (!stopping_ && jobs_.empty()) {
+                wake_.wait(lock);
+            }
+            if (stopping_) {
+                break;
+            }
+            Job job = jobs_.front();
+            jobs_.pop_front();
+            lock.unlock();
+            Run(job);
+            if (job.inbox) {
+                job.inbox->EndJob();
+            }
+            lock.lock();
+        }
+        for (std::deque<Job>::iterator it = jobs_.begin(); it != jobs_.end(); ++it) {
+            delete it->value;
+            if (it->inbox) {
+                it->inbox->EndJob();
+            }
+        }
+        jobs_.clear();
+        lock.unlock();
+        for (std::map<int, Context *>::iterator it = contexts_.begin(); it != contexts_.end(); ++it) {
+            it->second->context.Dispose();
+            delete it->second;
+        }
+        contexts_.clear();
+        templates_.Dispose();
+    }
+    isolate->Dispose();
+}
+
+void zb::WorkerPool::Thread::Run(const Job &job)
+{
+    switch (job.type) {
+        case Job::kStart:
+            RunStart(job);
+            break;
+        case Job::kMessage:
+            RunMessage(job);
+            break;
+        case Job::kTerminate: {
+            std::map<int, Context *>::iterator it = contexts_.find(job.worker);
+            if (it != contexts_.end()) {
+                it->second->context.Dispose();
+                delete it->second;
+                contexts_.erase(it);
+            }
+            break;
+        }
+        case Job::kLowMemory:
+            v8::V8::LowMemoryNotification();
+            break;
+    }
+}
+
+// Every worker on the thread gets its context from the same global
+// template; postMessage finds the sender through current_.
+void zb::WorkerPool::Thread::RunStart(const Job &job)
+{
+    v8::HandleScope handle_scope;
+    if (templates_.global().IsEmpty()) {
+        v8::Handle<v8::ObjectTemplate> global = v8::ObjectTemplate::New();
+        global->Set(v8::String::NewSymbol("postMessage"), v8::FunctionTemplate::New(PostMessage, v8::External::New(this)));
+        global->Set(v8::String::NewSymbol("Print"), v8::FunctionTemplate::New(Invoke::Print, v8::External::New(&log_limiter_)));
+        global->Set(v8::String::NewSymbol("Buffer"), v8::FunctionTemplate::New(Buffer::New));
+        templates_.set_global(global);
+    }
+    Context *context = new Context;
+    context->worker = job.worker;
+    context->inbox = job.inbox;
+    context->context = v8::Context::New(NULL, templates_.global());
+    contexts_[job.worker] = context;
+
+    current_ = context;
+    v8::Context::Scope context_scope(context->context);
+    v8::TryCatch try_catch;
+    v8::Local<v8::Script> script = v8::Script::Compile(v8::String::New(job.source.data(), static_cast<int>(job.source.size())));
+    if (script.IsEmpty() || script->Run().IsEmpty()) {
+        ReportWorkerException(job.worker, &try_catch);
+    }
+    current_ = NULL;
+}
+
+void zb::WorkerPool::Thread::RunMessage(const Job &job)
+{
+    std::map<int, Context *>::iterator it = contexts_.find(job.worker);
+    if (it == contexts_.end()) {
+        delete job.value;
+        return;
+    }
+    v8::HandleScope handle_scope;
+    v8::Context::Scope context_scope(it->second->context);
+    v8::Handle<v8::Value> value = job.value->Read();
+    delete job.value;
+    v8::Local<v8::Object> global = it->second->context->Global();
+    v8::Local<v8::Value> handler = global->Get(templates_.symbol(TemplateCache::kOnMessage));
+    if (!handler->IsFunction()) {
+        return;
+    }
+    current_ = it->second;
+    v8::TryCatch try_catch;
+    if (v8::Local<v8::Function>::Cast(handler)->Call(global, 1, &value).IsEmpty()) {
+        ReportWorkerException(job.worker, &try_catch);
+    }
+    current_ = NULL;
+}
+
+v8::Handle<v8::Value> zb::WorkerPool::Thread::PostMessage(const v8::Arguments &args)
+{
+    Context *context = static_cast<Thread *>(v8::Local<v8::External>::Cast(args.Data())->Value())->current_;
+    SerializedValue *value = new SerializedValue;
+    if (!value->Write(args[0], args[1])) {
+        delete value;
+        return v8::Handle<v8::Value>();
+    }
+    context->inbox->Post(context->worker, value);
+    return v8::Undefined();
+}
+
+zb::WorkerPool::WorkerPool(int threads)
+    : next_worker_(1)
+{
+    for (int i = 0; i < threads; i++) {
+        threads_.push_back(new Thread());
+    }
+}
+
+zb::WorkerPool::~WorkerPool()
+{
+    for (size_t i = 0; i < threads_.size(); i++) {
+        delete threads_[i];
+    }
+}
+
+zb::WorkerPool *zb::WorkerPool::Shared()
+{
+    static WorkerPool *shared = NULL;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        shared = new WorkerPool(cores > 2 ? cores - 1 : 1);
+    });
+    return shared;
+}
+
+int zb::WorkerPool::Start(const std::string &source, const std::shared_ptr<WorkerInbox> &inbox)
+{
+    int worker = next_worker_.fetch_add(1, std::memory_order_relaxed);
+    ThreadFor(worker)->Start(worker, source, inbox);
+    return worker;
+}
+
+void zb::WorkerPool::Post(int worker, SerializedValue *value)
+{
+    ThreadFor(worker)->Post(worker, value);
+}
+
+void zb::WorkerPool::Terminate(int worker)
+{
+    ThreadFor(worker)->Terminate(worker);
+}
+
+void zb::WorkerPool::LowMemory()
+{
+    for (size_t i = 0; i < threads_.size(); i++) {
+        threads_[i]->LowMemory();
+    }
+}
+
+// The runtime keeps track of every Worker object so it can delete the ones
+// still around when it goes.
+zb::Worker::Worker(Runtime *runtime, int id)
+    : runtime_(runtime), id_(id)
+{
+    runtime_->worker_objects()->insert(this);
+}
+
+zb::Worker::~Worker()
+{
+    runtime_->worker_objects()->erase(this);
+}
+
+void zb::Worker::Terminate()
+{
+    if (id_ == 0) {
+        return;
+    }
+    WorkerPool::Shared()->Terminate(id_);
+    runtime_->RemoveWorker(id_);
+    id_ = 0;
+}
+
+v8::Handle<v8::Value> zb::Worker::New(const v8::Arguments &args)
+{
+    Runtime *runtime = static_cast<Runtime *>(v8::Local<v8::External>::Cast(args.Data())->Value());
+    if (!args.IsConstructCall()) {
+        return v8::ThrowException(v8::Exception::TypeError(v8::String::New("Worker must be called with new")));
+    }
+    std::string source;
+    if (args.Length() < 1 || !args[0]->IsString() || !Converter<std::string>::FromV8(args[0], &source)) {
+        return ThrowArgumentError(0);
+    }
+    Worker *worker = new Worker(runtime, WorkerPool::Shared()->Start(source, runtime->worker_inbox()));
+
+    v8::Local<v8::Object> thisObject = args.This();
+    Wrap(thisObject, worker);
+    v8::Persistent<v8::Object> holder = v8::Persistent<v8::Object>::New(thisObject);
+    holder.MakeWeak(worker, zb::Worker::Dispose);
+    runtime->AddWorker(worker->id(), thisObject);
+
+    return thisObject;
+}
+
+// worker.postMessage(value[, [buffer, ...]])
+v8::Handle<v8::Value> zb::Worker::PostMessage(const v8::Arguments &args)
+{
+    Worker *worker = Unwrap<Worker>(args.Holder());
+    if (worker->id_ == 0) {
+        return v8::ThrowException(v8::Exception::Error(v8::String::New("the worker was terminated")));
+    }
+    SerializedValue *value = new SerializedValue;
+    if (!value->Write(args[0], args[1])) {
+        delete value;
+        return v8::Handle<v8::Value>();
+    }
+    WorkerPool::Shared()->Post(worker->id_, value);
+    return v8::Undefined();
+}
+
+void zb::Worker::Dispose(v8::Persistent<v8::Value> handle, void *parameter)
+{
+    delete static_cast<Worker *>(parameter);
+    handle.Dispose();
+    handle.Clear();
+}
+
+void zb::Worker::InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime)
+{
+    TemplateCache *templates = runtime->templates();
+    if (templates->Class<Worker>().IsEmpty()) {
+        ClassBinding<Worker> binding("Worker", Trace<Worker::New>("Worker"), v8::External::New(runtime));
+        binding.Method<Worker::PostMessage>("postMessage");
+        binding.Method<void, &Worker::Terminate>("terminate");
+        binding.klass()->Set(v8::String::NewSymbol("threads"), v8::Integer::New(WorkerPool::Shared()->size()), v8::ReadOnly);
+        templates->AddClass<Worker>(binding.klass());
+    }
+    global->Set(v8::String::NewSymbol("Worker"), templates->Class<Worker>());
+    global->Set(v8::String::NewSymbol("Buffer"), v8::FunctionTemplate::New(Buffer::New));
+}
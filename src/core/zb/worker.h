@@ -0,0 +1,115 @@
+//
+//  worker.h
+//  zb
+//
+//  Created by  on 12/03/14.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_WORKER_H_
+#define ZB_WORKER_H_
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "v8.h"
+#include "structured_clone.h"
+
+namespace zb {
+    class Runtime;
+
+    // Messages from workers on their way to the runtime that started them.
+    // Workers post from their pool threads; the runtime takes them on its
+    // own thread. Closing it, when the runtime goes away, drops anything
+    // posted later.
+    class WorkerInbox {
+    public:
+        // Called on the posting worker's thread so a sleeping host can wake
+        // up and deliver.
+        typedef void (*Wake)(void *data);
+
+        struct Message {
+            int worker;
+            SerializedValue *value;
+        };
+
+        WorkerInbox();
+        ~WorkerInbox();
+        void SetWake(Wake wake, void *data);
+        void Post(int worker, SerializedValue *value);
+        void Take(std::deque<Message> *out);
+        void Close();
+
+        // Jobs sent to workers and not yet run, plus messages not yet
+        // taken. Safe to read from any thread.
+        bool busy() const { return pending_.load(std::memory_order_acquire) > 0; }
+        void BeginJob() { pending_.fetch_add(1, std::memory_order_acq_rel); }
+        void EndJob() { pending_.fetch_sub(1, std::memory_order_acq_rel); }
+    private:
+        std::mutex mutex_;
+        std::deque<Message> messages_;
+        bool closed_;
+        Wake wake_;
+        void *wake_data_;
+        std::atomic<int> pending_;
+    };
+
+    // Threads that each own an isolate and run any number of workers, one
+    // context per worker. A worker stays on the thread it was started on,
+    // so its messages are handled in order; separate workers spread over
+    // the threads round-robin.
+    class WorkerPool {
+    public:
+        explicit WorkerPool(int threads);
+        ~WorkerPool();
+        int Start(const std::string &source, const std::shared_ptr<WorkerInbox> &inbox);
+        void Post(int worker, SerializedValue *value);
+        void Terminate(int worker);
+        void LowMemory();
+        int size() const { return static_cast<int>(threads_.size()); }
+
+        // One thread fewer than there are cores, but at least one. Never
+        // destroyed, so workers may still be running at exit.
+        static WorkerPool *Shared();
+    private:
+        class Thread;
+
+        Thread *ThreadFor(int worker) { return threads_[(worker - 1) % threads_.size()]; }
+
+        std::vector<Thread *> threads_;
+        std::atomic<int> next_worker_;
+    };
+
+    // Script side of a worker:
+    //
+    //   var worker = new Worker('onmessage = function (data) {' +
+    //                           '    postMessage(data.sort()); };');
+    //   worker.onmessage = function (sorted) { ... };
+    //   worker.postMessage(values);
+    //
+    // The source runs in a fresh context with only postMessage, Print and
+    // Buffer defined. Values are copied as SerializedValue describes;
+    // postMessage(value, [buffer]) moves a Buffer instead. Handlers get the
+    // value itself. A worker and its object live until terminate().
+    class Worker {
+    public:
+        Worker(Runtime *runtime, int id);
+        ~Worker();
+        int id() const { return id_; }
+        void Terminate();
+
+        static v8::Handle<v8::Value> New(const v8::Arguments &args);
+        static v8::Handle<v8::Value> PostMessage(const v8::Arguments &args);
+        static void Dispose(v8::Persistent<v8::Value> handle, void *parameter);
+        static void InitializeTemplate(v8::Handle<v8::ObjectTemplate> global, Runtime *runtime);
+    private:
+        Runtime *runtime_;
+        int id_;
+    };
+}
+
+#endif  // ZB_WORKER_H_
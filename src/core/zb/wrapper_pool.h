@@ -0,0 +1,134 @@
+//
+//  wrapper_pool.h
+//  zb
+//
+//  Created by  on 12/03/08.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#ifndef ZB_WRAPPER_POOL_H_
+#define ZB_WRAPPER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "v8.h"
+#include "binding.h"
+
+namespace zb {
+    // Free list of dead wrappers of one bridged class, kept together with
+    // their natives so churning objects skip the native allocation, the
+    // new Persistent and its finalization. C provides Recycle(), which
+    // resets its native side, and the static weak callback Dispose.
+    //
+    // A wrapper's weak callback calls Reserve and, if it gets room, keeps
+    // the handle strong; Give files it once the finalization registry
+    // flushes, so recycling stays out of the GC pause.
+    template <class C>
+    class WrapperPool {
+    public:
+        struct Stats {
+            int64_t hits;
+            int64_t misses;
+            int64_t evictions;
+            int64_t rejections;   // pooled wrappers scripts had changed too much to reuse
+        };
+        
+        explicit WrapperPool(size_t budget = 256) : budget_(budget), reserved_(0)
+        {
+            stats_.hits = 0;
+            stats_.misses = 0;
+            stats_.evictions = 0;
+            stats_.rejections = 0;
+        }
+        
+        // False once pooled and reserved wrappers fill the budget; the
+        // caller then releases its wrapper for good.
+        bool Reserve()
+        {
+            if (entries_.size() + reserved_ >= budget_) {
+                stats_.evictions++;
+                return false;
+            }
+            reserved_++;
+            return true;
+        }
+        
+        // Takes a reserved wrapper whose handle was made strong again.
+        void Give(v8::Persistent<v8::Value> handle, C *native)
+        {
+            reserved_--;
+            native->Recycle();
+            Entry entry = { v8::Persistent<v8::Object>::Cast(handle), native };
+            entries_.push_back(entry);
+        }
+        
+        // A recycled wrapper, weak again, or an empty handle when the pool
+        // has none to give. |pristine| is a fresh instance of the class;
+        // only wrappers with its hidden class and no indexed properties are
+        // reused, which a script adding, deleting or redefining a property,
+        // swapping __proto__ or preventing extensions rules out. Those are
+        // evicted instead. The check reads two heap words, and Recycle has
+        // already reset the native side and the geometry slot.
+        v8::Local<v8::Object> Take(v8::Handle<v8::Object> pristine)
+        {
+            while (!entries_.empty()) {
+                Entry entry = entries_.back();
+                entries_.pop_back();
+                v8::Local<v8::Object> object = v8::Local<v8::Object>::New(entry.handle);
+                if (!tagged::SameShape(object, pristine)) {
+                    delete entry.native;
+                    entry.handle.Dispose();
+                    stats_.rejections++;
+                    continue;
+                }
+                stats_.hits++;
+                entry.handle.MakeWeak(entry.native, C::Dispose);
+                return object;
+            }
+            stats_.misses++;
+            return v8::Local<v8::Object>();
+        }
+        
+        void set_budget(size_t budget)
+        {
+            budget_ = budget;
+            while (entries_.size() > budget_) {
+                Evict();
+            }
+        }
+        
+        void Dispose()
+        {
+            while (!entries_.empty()) {
+                Evict();
+            }
+        }
+        
+        size_t budget() const { return budget_; }
+        size_t size() const { return entries_.size(); }
+        const Stats &stats() const { return stats_; }
+    private:
+        struct Entry {
+            v8::Persistent<v8::Object> handle;
+            C *native;
+        };
+        
+        void Evict()
+        {
+            Entry entry = entries_.back();
+            entries_.pop_back();
+            delete entry.native;
+            entry.handle.Dispose();
+            stats_.evictions++;
+        }
+        
+        std::vector<Entry> entries_;
+        size_t budget_;
+        size_t reserved_;
+        Stats stats_;
+    };
+}
+
+#endif  // ZB_WRAPPER_POOL_H_
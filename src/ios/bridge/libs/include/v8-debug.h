@@ -339,6 +339,11 @@ class EXPORT Debug {
   static bool EnableAgent(const char* name, int port,
                           bool wait_for_connection = false);
 
+  /**
+    * Disable the V8 builtin debug agent. The TCP/IP connection will be closed.
+    */
+  static void DisableAgent();
+
   /**
    * Makes V8 process all pending debug messages.
    *
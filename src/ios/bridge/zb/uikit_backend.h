@@ -0,0 +1,31 @@
+//
+//  uikit_backend.h
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#include "backend.h"
+
+namespace zb {
+    class UIKitBackend : public Backend {
+    public:
+        UIKitBackend();
+        virtual void BeginCommit();
+        virtual void EndCommit();
+        virtual NativeView CreateView();
+        virtual void DestroyView(NativeView view);
+        virtual void RecycleView(NativeView view);
+        virtual Frame GetFrame(NativeView view);
+        virtual void SetFrame(NativeView view, const Frame &frame);
+        virtual float GetAlpha(NativeView view);
+        virtual void SetAlpha(NativeView view, float alpha);
+        virtual void AddSubview(NativeView parent, NativeView child);
+        virtual void RemoveFromSuperview(NativeView view);
+        virtual void Log(const char *message);
+    private:
+        BOOL animationsEnabled_;
+    };
+}
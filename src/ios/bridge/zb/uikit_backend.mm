@@ -0,0 +1,88 @@
+//
+//  uikit_backend.mm
+//  zb
+//
+//  Created by  on 12/02/22.
+//  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
+//
+
+#include "uikit_backend.h"
+
+zb::UIKitBackend::UIKitBackend()
+    : animationsEnabled_(YES)
+{
+}
+
+// A commit applies model state that scripts already consider current, so it
+// must not pick up an enclosing animation block.
+void zb::UIKitBackend::BeginCommit()
+{
+    animationsEnabled_ = [UIView areAnimationsEnabled];
+    [UIView setAnimationsEnabled:NO];
+}
+
+void zb::UIKitBackend::EndCommit()
+{
+    [UIView setAnimationsEnabled:animationsEnabled_];
+}
+
+zb::NativeView zb::UIKitBackend::CreateView()
+{
+    UIView *view = [[UIView alloc] init];
+    return (__bridge_retained void *)view;
+}
+
+void zb::UIKitBackend::DestroyView(NativeView native)
+{
+    UIView *view = (__bridge_transfer UIView *)native;
+    [view removeFromSuperview];
+}
+
+void zb::UIKitBackend::RecycleView(NativeView native)
+{
+    UIView *view = (__bridge UIView *)native;
+    [view removeFromSuperview];
+    [view.subviews makeObjectsPerformSelector:@selector(removeFromSuperview)];
+    view.frame = CGRectZero;
+    view.alpha = 1;
+}
+
+zb::Frame zb::UIKitBackend::GetFrame(NativeView native)
+{
+    const UIView *view = (__bridge UIView *)native;
+    Frame frame = { view.frame.origin.x, view.frame.origin.y, view.frame.size.width, view.frame.size.height };
+    return frame;
+}
+
+void zb::UIKitBackend::SetFrame(NativeView native, const Frame &frame)
+{
+    UIView *view = (__bridge UIView *)native;
+    view.frame = CGRectMake(frame.x, frame.y, frame.width, frame.height);
+}
+
+float zb::UIKitBackend::GetAlpha(NativeView native)
+{
+    const UIView *view = (__bridge UIView *)native;
+    return view.alpha;
+}
+
+void zb::UIKitBackend::SetAlpha(NativeView native, float alpha)
+{
+    UIView *view = (__bridge UIView *)native;
+    view.alpha = alpha;
+}
+
+void zb::UIKitBackend::AddSubview(NativeView parent, NativeView child)
+{
+    [(__bridge UIView *)parent addSubview:(__bridge UIView *)child];
+}
+
+void zb::UIKitBackend::RemoveFromSuperview(NativeView native)
+{
+    [(__bridge UIView *)native removeFromSuperview];
+}
+
+void zb::UIKitBackend::Log(const char *message)
+{
+    NSLog(@"%s", message);
+}
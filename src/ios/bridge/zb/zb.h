@@ -7,12 +7,28 @@
 //
 #include "v8.h"
 #include "v8stdint.h"
-#include "invoke.h"
+#include "script_thread.h"
 
 namespace zb {
+    // Scripts run on the shared ScriptThread; their view mutations are
+    // drained into UIKit on the main queue.
     class Zb {
     public:
-        static bool Run(NSString *s);
-        static v8::Handle<v8::Value> Log(const v8::Arguments& args);
+        // Queue the script for the script thread and return at once;
+        // compile and runtime errors go to the log. RunFile only fails
+        // when the file cannot be read.
+        static void Run(NSString *s);
+        static bool RunFile(NSString *path);
+        static void PostEvent(const Event &event);
+        // Calls the global |function| with |argument|, an NSDictionary,
+        // NSArray, NSString, NSNumber or NSNull tree, and passes what it
+        // returns, converted the same way, to |completion| on the main queue.
+        static void Call(NSString *function, id argument, void (^completion)(id result));
+        static void HandleMemoryWarning();
+        static void EnableTracing();
+        static bool WriteTrace(NSString *path);
+        static bool StartRecording(NSString *path);
+        static void StopRecording();
+        static ScriptThread *Shared();
     };
 }
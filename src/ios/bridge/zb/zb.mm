@@ -6,34 +6,336 @@
 //  Copyright (c) 2012年 __MyCompanyName__. All rights reserved.
 //
 
+#include <unistd.h>
+#include <atomic>
+
+#import <QuartzCore/QuartzCore.h>
+
 #include "zb.h"
-#include "view.h"
+#include "animator.h"
+#include "log_channel.h"
+#include "marshal.h"
+#include "recorder.h"
+#include "trace.h"
+#include "uikit_backend.h"
+#include "worker.h"
 
 using namespace v8;
 
-bool zb::Zb::Run(NSString *s)
-{
-    HandleScope handle_scope;
+// Drives the animator from the display refresh, and only while something
+// is animating.
+@interface ZBAnimationTicker : NSObject
+@property (nonatomic, strong) CADisplayLink *link;
+- (void)wake;
+- (void)tick:(CADisplayLink *)link;
+@end
+
+namespace {
+    zb::UIKitBackend *backend;
+    zb::Animator *animator;
+    ZBAnimationTicker *ticker;
+    std::atomic<bool> drainScheduled(false);
+    
+    // Keep the NSString alive and let V8 read its buffer in place. Only
+    // used when CoreFoundation hands out a direct pointer to the contents.
+    class StringAsciiSource : public v8::String::ExternalAsciiStringResource {
+    public:
+        StringAsciiSource(NSString *string, const char *data) : string_(string), data_(data), length_([string length]) {}
+        virtual const char *data() const { return data_; }
+        virtual size_t length() const { return length_; }
+    private:
+        NSString *string_;
+        const char *data_;
+        size_t length_;
+    };
+    
+    class StringUTF16Source : public v8::String::ExternalStringResource {
+    public:
+        StringUTF16Source(NSString *string, const UniChar *data) : string_(string), data_(data), length_([string length]) {}
+        virtual const uint16_t *data() const { return data_; }
+        virtual size_t length() const { return length_; }
+    private:
+        NSString *string_;
+        const uint16_t *data_;
+        size_t length_;
+    };
+    
+    // One NSLog per batch from the log channel's writer thread, instead of
+    // one per script call.
+    void LogToConsole(void *data, const char *text, size_t length)
+    {
+        if (length > 0 && text[length - 1] == '\n') {
+            length--;
+        }
+        NSLog(@"%.*s", static_cast<int>(length), text);
+    }
+    
+    bool IsASCII(const char *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++) {
+            if (static_cast<unsigned char>(data[i]) >= 0x80) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Arrays of at least this many NSNumbers go over as a Numbers buffer.
+    const NSUInteger kMinNumbers = 16;
+    
+    bool IsBoolean(id value)
+    {
+        return CFGetTypeID((__bridge CFTypeRef)value) == CFBooleanGetTypeID();
+    }
+    
+    bool IsNumbers(NSArray *array)
+    {
+        if ([array count] < kMinNumbers) {
+            return false;
+        }
+        for (id item in array) {
+            if (![item isKindOfClass:[NSNumber class]] || IsBoolean(item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Anything that is not a plist-like type becomes its description.
+    void ToVariant(id value, zb::Variant *out)
+    {
+        if (value == nil) {
+            *out = zb::Variant();
+        } else if (value == [NSNull null]) {
+            *out = zb::Variant::Null();
+        } else if ([value isKindOfClass:[NSNumber class]]) {
+            *out = IsBoolean(value) ? zb::Variant(static_cast<bool>([value boolValue])) : zb::Variant([value doubleValue]);
+        } else if ([value isKindOfClass:[NSString class]]) {
+            *out = zb::Variant([value UTF8String]);
+        } else if ([value isKindOfClass:[NSArray class]] && IsNumbers(value)) {
+            *out = zb::Variant::Numbers();
+            std::vector<double> *numbers = out->mutable_numbers();
+            numbers->reserve([value count]);
+            for (NSNumber *item in value) {
+                numbers->push_back([item doubleValue]);
+            }
+        } else if ([value isKindOfClass:[NSArray class]]) {
+            *out = zb::Variant::Array();
+            for (id item in value) {
+                ToVariant(item, out->Append());
+            }
+        } else if ([value isKindOfClass:[NSDictionary class]]) {
+            *out = zb::Variant::Object();
+            [value enumerateKeysAndObjectsUsingBlock:^(id key, id item, BOOL *stop) {
+                ToVariant(item, out->Set([[key description] UTF8String]));
+            }];
+        } else {
+            *out = zb::Variant([[value description] UTF8String]);
+        }
+    }
     
-    v8::Handle<v8::ObjectTemplate> global = v8::ObjectTemplate::New();                                                                                                  
-    zb::View::InitializeTemplate(global);
+    id FromVariant(const zb::Variant &value)
+    {
+        switch (value.type()) {
+            case zb::Variant::kUndefined:
+                return nil;
+            case zb::Variant::kNull:
+                return [NSNull null];
+            case zb::Variant::kBoolean:
+                return [NSNumber numberWithBool:value.boolean()];
+            case zb::Variant::kNumber:
+                return [NSNumber numberWithDouble:value.number()];
+            case zb::Variant::kString:
+                return [[NSString alloc] initWithBytes:value.string().data() length:value.string().size() encoding:NSUTF8StringEncoding];
+            case zb::Variant::kArray: {
+                NSMutableArray *array = [NSMutableArray arrayWithCapacity:value.items().size()];
+                for (size_t i = 0; i < value.items().size(); i++) {
+                    id item = FromVariant(value.items()[i]);
+                    [array addObject:item != nil ? item : [NSNull null]];
+                }
+                return array;
+            }
+            case zb::Variant::kObject: {
+                NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:value.fields().size()];
+                for (size_t i = 0; i < value.fields().size(); i++) {
+                    const zb::Variant::Field &field = value.fields()[i];
+                    id item = FromVariant(field.second);
+                    if (item != nil) {
+                        [dictionary setObject:item forKey:[NSString stringWithUTF8String:field.first.c_str()]];
+                    }
+                }
+                return dictionary;
+            }
+            case zb::Variant::kNumbers: {
+                NSMutableArray *array = [NSMutableArray arrayWithCapacity:value.numbers().size()];
+                for (size_t i = 0; i < value.numbers().size(); i++) {
+                    [array addObject:[NSNumber numberWithDouble:value.numbers()[i]]];
+                }
+                return array;
+            }
+        }
+        return nil;
+    }
     
-    global->Set(v8::String::New("Log"), v8::FunctionTemplate::New(Zb::Log));
-    Handle<Context> context = v8::Context::New(NULL, global);
+    // Converts on the script thread, then hands the result to the
+    // completion on the main queue. |data| holds the retained block.
+    void CallDone(void *data, bool ok, zb::Variant *result)
+    {
+        void (^completion)(id) = (__bridge_transfer void (^)(id))data;
+        id value = ok && result != NULL ? FromVariant(*result) : nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(value);
+        });
+    }
     
-    Context::Scope context_scope(context); 
-    Handle<String> source = String::New((char *) [s UTF8String]);
-    Handle<Script> script = Script::Compile(source);
-    Handle<Value> result = script->Run(); 
-    String::AsciiValue ascii(result);
+    void DrainOnMainQueue(void *data)
+    {
+        drainScheduled.store(false);
+        static_cast<zb::ScriptThread *>(data)->BeginFrame();
+        static_cast<zb::ScriptThread *>(data)->Drain(animator);
+        if (animator->active()) {
+            [ticker wake];
+        }
+    }
+    
+    void PostCompletion(void *data, int id, bool finished)
+    {
+        zb::Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = finished ? zb::Event::kAnimationFinished : zb::Event::kAnimationInterrupted;
+        event.animation = id;
+        static_cast<zb::ScriptThread *>(data)->PostEvent(event);
+    }
+    
+    // Runs on the script thread; at most one drain is queued at a time.
+    void RequestDrain(void *data)
+    {
+        if (!drainScheduled.exchange(true)) {
+            dispatch_async_f(dispatch_get_main_queue(), data, DrainOnMainQueue);
+        }
+    }
+}
+
+zb::ScriptThread *zb::Zb::Shared()
+{
+    static ScriptThread *shared = NULL;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        LogChannel::Shared()->SetSink(LogToConsole, NULL);
+        backend = new UIKitBackend();
+        animator = new Animator(backend);
+        ticker = [[ZBAnimationTicker alloc] init];
+        shared = new ScriptThread();
+        animator->SetCompletion(PostCompletion, shared);
+        shared->SetDrainRequest(RequestDrain, shared);
+        shared->Start();
+    });
+    return shared;
+}
+
+// Immutable strings whose contents CoreFoundation exposes directly go to
+// V8 without a copy; anything else is copied out as UTF-8.
+void zb::Zb::Run(NSString *s)
+{
+    NSString *string = [s copy];
+    CFStringRef ref = (__bridge CFStringRef)string;
+    const char *ascii = CFStringGetCStringPtr(ref, kCFStringEncodingASCII);
+    if (ascii != NULL && IsASCII(ascii, [string length])) {
+        Shared()->Post(new StringAsciiSource(string, ascii));
+    } else if (const UniChar *utf16 = CFStringGetCharactersPtr(ref)) {
+        Shared()->Post(new StringUTF16Source(string, utf16));
+    } else {
+        Shared()->Post([string UTF8String]);
+    }
+}
+
+// The file is mapped on the script thread, next to the preparse data
+// zb_preparse left in the bundle.
+bool zb::Zb::RunFile(NSString *path)
+{
+    const char *file = [path fileSystemRepresentation];
+    if (access(file, R_OK) != 0) {
+        return false;
+    }
+    Shared()->PostFile(file);
     return true;
 }
 
-v8::Handle<v8::Value> zb::Zb::Log(const v8::Arguments &args)
+void zb::Zb::PostEvent(const Event &event)
 {
-    v8::Local<v8::Object> thisObject = args.This();
-    if (args.Length() > 0) {
-        NSLog(@"%s", *v8::String::Utf8Value(args[0]));
+    Shared()->PostEvent(event);
+}
+
+// The argument is converted here, so later changes to it do not reach the
+// script. A failed call completes with nil.
+void zb::Zb::Call(NSString *function, id argument, void (^completion)(id result))
+{
+    Variant *variant = new Variant();
+    ToVariant(argument, variant);
+    if (completion == nil) {
+        Shared()->PostCall([function UTF8String], variant);
+        return;
     }
-    return thisObject;
-}
\ No newline at end of file
+    void *data = (__bridge_retained void *)[completion copy];
+    Shared()->PostCall([function UTF8String], variant, CallDone, data);
+}
+
+// Collections run on the script and worker threads, after whatever they
+// are doing now.
+void zb::Zb::HandleMemoryWarning()
+{
+    Shared()->PostLowMemory();
+    WorkerPool::Shared()->LowMemory();
+}
+
+// Only affects the runtime if called before the first Run.
+void zb::Zb::EnableTracing()
+{
+    Tracer::Enable();
+}
+
+bool zb::Zb::WriteTrace(NSString *path)
+{
+    FILE *out = fopen([path fileSystemRepresentation], "w");
+    if (out == NULL) {
+        return false;
+    }
+    Tracer::WriteCSV(out);
+    fclose(out);
+    return true;
+}
+
+// Like tracing, only records a runtime created after it, so call it before
+// the first Run. The trace replays with zb_replay.
+bool zb::Zb::StartRecording(NSString *path)
+{
+    return Recorder::Start([path fileSystemRepresentation]);
+}
+
+void zb::Zb::StopRecording()
+{
+    Recorder::Stop();
+}
+
+@implementation ZBAnimationTicker
+
+@synthesize link = _link;
+
+- (void)wake
+{
+    if (_link == nil) {
+        _link = [CADisplayLink displayLinkWithTarget:self selector:@selector(tick:)];
+        [_link addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    _link.paused = NO;
+}
+
+- (void)tick:(CADisplayLink *)link
+{
+    zb::Zb::Shared()->BeginFrame();
+    if (!animator->Tick(link.timestamp)) {
+        link.paused = YES;
+    }
+}
+
+@end